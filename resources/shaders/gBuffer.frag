@@ -1,9 +1,9 @@
 #version 400 core
 
-layout (location = 0) out vec4 gPosition;
-layout (location = 1) out vec4 gAlbedo;
-layout (location = 2) out vec4 gNormal;
-layout (location = 3) out vec3 gEffects;
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec3 gEffects;
+layout (location = 3) out vec4 gPosition;     // Not attached with the compact layout
 
 in vec3 viewPos;
 in vec2 TexCoords;
@@ -14,6 +14,7 @@ in vec4 fragPrevPosition;
 const float nearPlane = 1.0f;
 const float farPlane = 1000.0f;
 
+uniform bool gBufferCompact;
 uniform vec3 albedoColor;
 uniform sampler2D texAlbedo;
 uniform sampler2D texNormal;
@@ -23,6 +24,7 @@ uniform sampler2D texAO;
 
 float LinearizeDepth(float depth);
 vec3 computeTexNormal(vec3 viewNormal, vec3 texNormal);
+vec2 encodeOctahedral(vec3 normal);
 
 
 void main()
@@ -33,15 +35,31 @@ void main()
     vec2 fragPosA = (fragPosition.xy / fragPosition.w) * 0.5f + 0.5f;
     vec2 fragPosB = (fragPrevPosition.xy / fragPrevPosition.w) * 0.5f + 0.5f;
 
-    gPosition = vec4(viewPos, LinearizeDepth(gl_FragCoord.z));
     gAlbedo.rgb = vec3(texture(texAlbedo, TexCoords));
 //    gAlbedo.rgb = vec3(albedoColor);
     gAlbedo.a =  vec3(texture(texRoughness, TexCoords)).r;
-    gNormal.rgb = computeTexNormal(normal, texNormal);
-//    gNormal.rgb = normalize(normal);
-    gNormal.a = vec3(texture(texMetalness, TexCoords)).r;
-    gEffects.r = vec3(texture(texAO, TexCoords)).r;
-    gEffects.gb = fragPosA - fragPosB;
+
+    vec3 viewNormal = computeTexNormal(normal, texNormal);
+//    vec3 viewNormal = normalize(normal);
+    float metalness = vec3(texture(texMetalness, TexCoords)).r;
+    float ao = vec3(texture(texAO, TexCoords)).r;
+
+    if (gBufferCompact)
+    {
+        // No position target, it is rebuilt from the depth buffer. The RG16 normal target holds the octahedral normal
+        // on the 11 high bits of each channel, metalness and AO on the 5 low ones
+        uvec2 normalBits = (uvec2(round(encodeOctahedral(viewNormal) * 2047.0f)) << 5u) | uvec2(round(vec2(metalness, ao) * 31.0f));
+
+        gNormal = vec4(vec2(normalBits) / 65535.0f, 0.0f, 0.0f);
+        gEffects = vec3(fragPosA - fragPosB, 0.0f);
+    }
+
+    else
+    {
+        gPosition = vec4(viewPos, LinearizeDepth(gl_FragCoord.z));
+        gNormal = vec4(viewNormal, metalness);
+        gEffects = vec3(ao, fragPosA - fragPosB);
+    }
 }
 
 
@@ -67,3 +85,14 @@ vec3 computeTexNormal(vec3 viewNormal, vec3 texNormal)
 
     return normalize(TBN * texNormal);
 }
+
+
+// Octahedral mapping of the unit sphere onto the [0, 1] square, the lower hemisphere being folded over the diagonals
+vec2 encodeOctahedral(vec3 normal)
+{
+    normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+
+    vec2 octNormal = normal.z >= 0.0f ? normal.xy : (1.0f - abs(normal.yx)) * vec2(normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f);
+
+    return octNormal * 0.5f + 0.5f;
+}
@@ -0,0 +1,163 @@
+#version 430 core
+
+// Clustered forward+ shading : the fragment finds its froxel from its screen tile and view depth,
+// then only loops over the point lights binned into it on the CPU
+in vec3 viewPos;
+in vec3 viewNormal;
+
+out vec4 colorOutput;
+
+struct LightPoint
+{
+    vec4 positionRadius;    // View-space position + radius
+    vec4 color;
+};
+
+layout (std430, binding = 0) readonly buffer LightPointBuffer
+{
+    LightPoint lightPoints[];
+};
+
+layout (std430, binding = 1) readonly buffer ClusterGridBuffer
+{
+    uvec2 clusterOffsetCount[];
+};
+
+layout (std430, binding = 2) readonly buffer ClusterIndexBuffer
+{
+    uint clusterLightIndices[];
+};
+
+const float PI = 3.14159265359f;
+
+uniform bool pointMode;
+uniform bool clusterDebug;
+uniform int attenuationMode;
+uniform uvec3 clusterGridSize;
+uniform vec2 clusterDepth;     // Near plane + slices / log(far / near)
+uniform vec2 viewportSize;
+uniform vec3 albedoColor;
+uniform vec3 materialF0;
+uniform float materialRoughness;
+uniform float materialMetallicity;
+uniform float materialOpacity;
+uniform float ambientIntensity;
+
+vec3 colorLinear(vec3 colorVector);
+float saturate(float f);
+vec3 computeFresnelSchlick(float NdotV, vec3 F0);
+float computeDistributionGGX(vec3 N, vec3 H, float roughness);
+float computeGeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughness);
+
+
+void main()
+{
+    uvec2 clusterTile = min(uvec2(gl_FragCoord.xy / viewportSize * vec2(clusterGridSize.xy)), clusterGridSize.xy - 1u);
+    uint clusterSlice = uint(clamp(log(-viewPos.z / clusterDepth.x) * clusterDepth.y, 0.0f, float(clusterGridSize.z - 1u)));
+    uint clusterIndex = (clusterSlice * clusterGridSize.y + clusterTile.y) * clusterGridSize.x + clusterTile.x;
+
+    uvec2 clusterLights = pointMode ? clusterOffsetCount[clusterIndex] : uvec2(0u);
+
+    if (clusterDebug)
+    {
+        colorOutput = vec4(mix(vec3(0.0f, 0.0f, 1.0f), vec3(1.0f, 0.0f, 0.0f), saturate(float(clusterLights.y) / 32.0f)), materialOpacity);
+        return;
+    }
+
+    vec3 albedo = colorLinear(albedoColor);
+    float roughness = materialRoughness;
+    float metalness = materialMetallicity;
+
+    vec3 V = normalize(- viewPos);
+    vec3 N = normalize(viewNormal);
+
+    float NdotV = max(dot(N, V), 0.0001f);
+
+    vec3 F0 = mix(materialF0, albedo, metalness);
+    vec3 F = computeFresnelSchlick(NdotV, F0);
+
+    vec3 kS = F;
+    vec3 kD = vec3(1.0f) - kS;
+    kD *= 1.0f - metalness;
+
+    vec3 diffuse = albedo / PI;
+    vec3 color = albedo * vec3(ambientIntensity);
+
+    for (uint i = 0u; i < clusterLights.y; ++i)
+    {
+        LightPoint lightPoint = lightPoints[clusterLightIndices[clusterLights.x + i]];
+        vec3 lightPosition = lightPoint.positionRadius.xyz;
+
+        vec3 L = normalize(lightPosition - viewPos);
+        vec3 H = normalize(L + V);
+
+        vec3 lightColor = colorLinear(lightPoint.color.rgb);
+        float distanceL = length(lightPosition - viewPos);
+        float attenuation;
+
+        if (attenuationMode == 1)
+            attenuation = 1.0f / (distanceL * distanceL); // Quadratic attenuation, binned up to the light radius all the same
+        else
+            attenuation = pow(saturate(1 - pow(distanceL / lightPoint.positionRadius.w, 4)), 2) / (distanceL * distanceL + 1); // UE4 attenuation
+
+        float NdotL = saturate(dot(N, L));
+
+        float D = computeDistributionGGX(N, H, roughness);
+        float G = computeGeometryAttenuationGGXSmith(NdotL, NdotV, roughness);
+        vec3 specular = (F * D * G) / (4.0f * NdotL * NdotV + 0.0001f);
+
+        color += (diffuse * kD + specular) * lightColor * attenuation * NdotL;
+    }
+
+    // Drawn on top of the post-processed image, so tonemapped (Reinhard) and gamma corrected here
+    color = color / (color + vec3(1.0f));
+    color = pow(color, vec3(1.0f / 2.2f));
+
+    colorOutput = vec4(color, materialOpacity);
+}
+
+
+
+vec3 colorLinear(vec3 colorVector)
+{
+    vec3 linearColor = pow(colorVector.rgb, vec3(2.2f));
+
+    return linearColor;
+}
+
+
+float saturate(float f)
+{
+    return clamp(f, 0.0f, 1.0f);
+}
+
+
+vec3 computeFresnelSchlick(float NdotV, vec3 F0)
+{
+    return F0 + (1.0f - F0) * pow(1.0f - NdotV, 5.0f);
+}
+
+
+float computeDistributionGGX(vec3 N, vec3 H, float roughness)
+{
+    float alpha = roughness * roughness;
+    float alpha2 = alpha * alpha;
+
+    float NdotH = saturate(dot(N, H));
+    float NdotH2 = NdotH * NdotH;
+
+    return (alpha2) / (PI * (NdotH2 * (alpha2 - 1.0f) + 1.0f) * (NdotH2 * (alpha2 - 1.0f) + 1.0f));
+}
+
+
+float computeGeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughness)
+{
+    float NdotL2 = NdotL * NdotL;
+    float NdotV2 = NdotV * NdotV;
+    float kRough2 = roughness * roughness + 0.0001f;
+
+    float ggxL = (2.0f * NdotL) / (NdotL + sqrt(NdotL2 + kRough2 * (1.0f - NdotL2)));
+    float ggxV = (2.0f * NdotV) / (NdotV + sqrt(NdotV2 + kRough2 * (1.0f - NdotV2)));
+
+    return ggxL * ggxV;
+}
@@ -0,0 +1,22 @@
+#version 430 core
+
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec3 normal;
+
+out vec3 viewPos;
+out vec3 viewNormal;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+
+void main()
+{
+    vec4 viewPosition = view * model * vec4(position, 1.0f);
+
+    viewPos = viewPosition.xyz;
+    viewNormal = mat3(transpose(inverse(view * model))) * normal;
+
+    gl_Position = projection * viewPosition;
+}
@@ -8,32 +8,45 @@ out vec4 colorOutput;
 const float PI = 3.14159265359f;
 const float prefilterLODLevel = 4.0f;
 
-// Light source(s) informations
-struct LightObject
+// Light source(s) informations, kept up to date by the light system in a persistent uniform buffer
+layout (std140) uniform LightBlock
 {
-    vec3 position;
-    vec3 direction;
-    vec4 color;
-    float radius;
+    vec4 lightPointPositionRadius[3];       // View-space position, radius in w
+    vec4 lightPointColor[3];
+    ivec4 lightPointShadow[3];              // Cube of the point shadow array in x, -1 when the light casts no shadow
+    vec4 lightDirectionalDirection[1];      // View-space direction
+    vec4 lightDirectionalColor[1];
+    ivec4 lightCounters;                    // Point light count in x, directional light count in y
 };
 
-uniform int lightPointCounter = 3;
-uniform int lightDirectionalCounter = 1;
-uniform LightObject lightPointArray[3];
-uniform LightObject lightDirectionalArray[1];
-
-// G-Buffer
+// G-Buffer, gPosition being the depth buffer and gNormal the packed octahedral normals with the compact layout
 uniform sampler2D gPosition;
 uniform sampler2D gAlbedo;
 uniform sampler2D gNormal;
 uniform sampler2D gEffects;
+uniform bool gBufferCompact;
 
 uniform sampler2D sao;
 uniform sampler2D envMap;
-uniform samplerCube envMapIrradiance;
+uniform vec3 shIrradiance[9];       // Diffuse irradiance SH coefficients, pre-convolved and divided by PI
 uniform samplerCube envMapPrefilter;
 uniform sampler2D envMapLUT;
 
+// Cascaded shadow maps of the first directional light, packed in a 2x2 atlas
+uniform sampler2DShadow shadowMap;
+uniform mat4 shadowMatrices[4];     // View-space to atlas coordinates
+uniform vec4 shadowSplits;          // Far view distance of each cascade
+uniform int shadowCascadeCount;
+uniform float shadowTexelSize;
+uniform float shadowBias;
+uniform bool shadowMode;
+
+// Point light shadows, one cube per shadowed light in a cube-map array, storing the distance to the light over its radius
+uniform samplerCubeArrayShadow pointShadowMap;
+uniform float pointShadowTexelSize;
+uniform float pointShadowBias;
+uniform bool pointShadowMode;
+
 uniform int gBufferView;
 uniform bool pointMode;
 uniform bool directionalMode;
@@ -44,6 +57,7 @@ uniform float materialMetallicity;
 uniform float ambientIntensity;
 uniform vec3 materialF0;
 uniform mat4 view;
+uniform mat4 inverseProj;
 
 vec3 colorLinear(vec3 colorVector);
 float saturate(float f);
@@ -54,19 +68,45 @@ vec3 computeFresnelSchlick(float NdotV, vec3 F0);
 vec3 computeFresnelSchlickRoughness(float NdotV, vec3 F0, float roughness);
 float computeDistributionGGX(vec3 N, vec3 H, float roughness);
 float computeGeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughness);
+int computeShadowCascade(vec3 viewPos);
+float computeShadow(vec3 viewPos, float NdotL);
+float computePointShadow(vec3 viewPos, vec3 lightPos, float lightRadius, int cubeIndex, float NdotL);
+vec3 computeIrradianceSH(vec3 N);
+vec3 computeViewPosition(vec2 texCoords, float depth);
+vec3 decodeOctahedral(vec2 octNormal);
 
 
 void main()
 {
     // Retrieve G-Buffer informations
-    vec3 viewPos = texture(gPosition, TexCoords).rgb;
     vec3 albedo = colorLinear(texture(gAlbedo, TexCoords).rgb);
-    vec3 normal = texture(gNormal, TexCoords).rgb;
     float roughness = texture(gAlbedo, TexCoords).a;
-    float metalness = texture(gNormal, TexCoords).a;
-    float ao = texture(gEffects, TexCoords).r;
-    vec2 velocity = texture(gEffects, TexCoords).gb;
-    float depth = texture(gPosition, TexCoords).a;
+    vec3 viewPos, normal;
+    vec2 velocity;
+    float metalness, ao, depth;
+
+    if (gBufferCompact)
+    {
+        float hardwareDepth = texture(gPosition, TexCoords).r;
+        uvec2 normalBits = uvec2(round(texture(gNormal, TexCoords).rg * 65535.0f));
+
+        viewPos = computeViewPosition(TexCoords, hardwareDepth);
+        normal = decodeOctahedral(vec2(normalBits >> 5u) / 2047.0f);
+        metalness = float(normalBits.x & 31u) / 31.0f;
+        ao = float(normalBits.y & 31u) / 31.0f;
+        velocity = gBufferView == 9 ? texture(gEffects, TexCoords).rg : vec2(0.0f);    // The velocity target is only read by its debug view
+        depth = hardwareDepth == 1.0f ? 1.0f : -viewPos.z;
+    }
+
+    else
+    {
+        viewPos = texture(gPosition, TexCoords).rgb;
+        normal = texture(gNormal, TexCoords).rgb;
+        metalness = texture(gNormal, TexCoords).a;
+        ao = texture(gEffects, TexCoords).r;
+        velocity = texture(gEffects, TexCoords).gb;
+        depth = texture(gPosition, TexCoords).a;
+    }
 
     float sao = texture(sao, TexCoords).r;
     vec3 envColor = texture(envMap, getSphericalCoord(normalize(envMapCoords))).rgb;
@@ -100,25 +140,26 @@ void main()
         if (pointMode)
         {
             // Point light(s) computation
-            for (int i = 0; i < lightPointCounter; i++)
+            for (int i = 0; i < lightCounters.x; i++)
             {
-                vec3 L = normalize(lightPointArray[i].position - viewPos);
+                vec3 L = normalize(lightPointPositionRadius[i].xyz - viewPos);
                 vec3 H = normalize(L + V);
 
-                vec3 lightColor = colorLinear(lightPointArray[i].color.rgb);
-                float distanceL = length(lightPointArray[i].position - viewPos);
+                vec3 lightColor = colorLinear(lightPointColor[i].rgb);
+                float distanceL = length(lightPointPositionRadius[i].xyz - viewPos);
                 float attenuation;
 
                 if(attenuationMode == 1)
                     attenuation = 1.0f / (distanceL * distanceL); // Quadratic attenuation
                 else if(attenuationMode == 2)
-                    attenuation = pow(saturate(1 - pow(distanceL / lightPointArray[i].radius, 4)), 2) / (distanceL * distanceL + 1); // UE4 attenuation
+                    attenuation = pow(saturate(1 - pow(distanceL / lightPointPositionRadius[i].w, 4)), 2) / (distanceL * distanceL + 1); // UE4 attenuation
 
                 // Light source dependent BRDF term(s)
                 float NdotL = saturate(dot(N, L));
 
                 // Radiance computation
-                vec3 kRadiance = lightColor * attenuation;
+                float shadow = pointShadowMode ? computePointShadow(viewPos, lightPointPositionRadius[i].xyz, lightPointPositionRadius[i].w, lightPointShadow[i].x, NdotL) : 1.0f;
+                vec3 kRadiance = lightColor * attenuation * shadow;
 
                 // Diffuse component computation
                 diffuse = albedo / PI;
@@ -141,12 +182,12 @@ void main()
 
         if (directionalMode)
         {
-            for (int i = 0; i < lightDirectionalCounter; i++)
+            for (int i = 0; i < lightCounters.y; i++)
             {
-                vec3 L = normalize(- lightDirectionalArray[i].direction);
+                vec3 L = normalize(- lightDirectionalDirection[i].xyz);
                 vec3 H = normalize(L + V);
 
-                vec3 lightColor = colorLinear(lightDirectionalArray[i].color.rgb);
+                vec3 lightColor = colorLinear(lightDirectionalColor[i].rgb);
 
                 // Light source dependent BRDF term(s)
                 float NdotL = saturate(dot(N, L));
@@ -166,7 +207,9 @@ void main()
                 // Specular component computation
                 specular = (F * D * G) / (4.0f * NdotL * NdotV + 0.0001f);
 
-                color += (diffuse * kD + specular) * lightColor * NdotL;
+                float shadow = (i == 0 && shadowMode) ? computeShadow(viewPos, NdotL) : 1.0f;
+
+                color += (diffuse * kD + specular) * lightColor * NdotL * shadow;
             }
         }
 
@@ -179,7 +222,7 @@ void main()
             kD *= 1.0f - metalness;
 
             // Diffuse irradiance computation
-            vec3 diffuseIrradiance = texture(envMapIrradiance, N * mat3(view)).rgb;
+            vec3 diffuseIrradiance = computeIrradianceSH(N * mat3(view));
             diffuseIrradiance *= albedo;
 
             // Specular radiance computation
@@ -233,6 +276,15 @@ void main()
     // Velocity buffer
     else if (gBufferView == 9)
         colorOutput = vec4(velocity, 0.0f, 1.0f);
+
+    // Shadow cascades
+    else if (gBufferView == 10)
+    {
+        vec3 cascadeColors[5] = vec3[](vec3(1.0f, 0.2f, 0.2f), vec3(0.2f, 1.0f, 0.2f), vec3(0.2f, 0.2f, 1.0f), vec3(1.0f, 1.0f, 0.2f), vec3(0.2f));
+        float NdotL = saturate(dot(normalize(normal), normalize(- lightDirectionalDirection[0].xyz)));
+
+        colorOutput = vec4(cascadeColors[computeShadowCascade(viewPos)] * (0.25f + 0.75f * computeShadow(viewPos, NdotL)), 1.0f);
+    }
 }
 
 
@@ -307,3 +359,109 @@ float computeGeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughne
 
     return ggxL * ggxV;
 }
+
+
+// Index of the cascade covering a view-space position, shadowCascadeCount when it lies beyond the last one
+int computeShadowCascade(vec3 viewPos)
+{
+    int cascade = 0;
+
+    while (cascade < shadowCascadeCount && -viewPos.z > shadowSplits[cascade])
+        cascade++;
+
+    return cascade;
+}
+
+
+float computeShadow(vec3 viewPos, float NdotL)
+{
+    int cascade = computeShadowCascade(viewPos);
+
+    if (cascade >= shadowCascadeCount)
+        return 1.0f;
+
+    vec3 shadowCoords = (shadowMatrices[cascade] * vec4(viewPos, 1.0f)).xyz;
+
+    // The PCF taps are kept inside the cell of the cascade, so they never read a neighbouring cascade of the atlas
+    vec2 cellMin = vec2(cascade & 1, cascade >> 1) * 0.5f + vec2(shadowTexelSize);
+    vec2 cellMax = cellMin + vec2(0.5f - 2.0f * shadowTexelSize);
+
+    // Slope-scaled bias, on top of the polygon offset used when rendering the cascades
+    float bias = clamp(shadowBias * tan(acos(NdotL)), 0.0f, 10.0f * shadowBias);
+    float shadow = 0.0f;
+
+    // 3x3 PCF, each tap being itself bilinearly filtered by the hardware comparison
+    for (int x = -1; x <= 1; ++x)
+    {
+        for (int y = -1; y <= 1; ++y)
+        {
+            vec2 tapCoords = clamp(shadowCoords.xy + vec2(x, y) * shadowTexelSize, cellMin, cellMax);
+            shadow += texture(shadowMap, vec3(tapCoords, shadowCoords.z - bias));
+        }
+    }
+
+    return shadow / 9.0f;
+}
+
+
+// The cube faces are world-aligned, so only the rotation of the view matrix has to be undone to get the lookup direction
+float computePointShadow(vec3 viewPos, vec3 lightPos, float lightRadius, int cubeIndex, float NdotL)
+{
+    if (cubeIndex < 0)
+        return 1.0f;
+
+    vec3 lightToFrag = (viewPos - lightPos) * mat3(view);
+    float fragDistance = length(lightToFrag);
+
+    if (fragDistance >= lightRadius)
+        return 1.0f;
+
+    float bias = clamp(pointShadowBias * tan(acos(NdotL)), 0.0f, 10.0f * pointShadowBias);
+    float compareDistance = fragDistance / lightRadius - bias;
+
+    // Center tap plus 4 taps spread over the plane orthogonal to the lookup, about a texel apart at the fragment distance
+    vec3 lookupDir = lightToFrag / fragDistance;
+    vec3 tangent = normalize(cross(lookupDir, abs(lookupDir.y) < 0.9f ? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f)));
+    vec3 bitangent = cross(lookupDir, tangent);
+    float tapSpread = 1.5f * pointShadowTexelSize;
+
+    float shadow = texture(pointShadowMap, vec4(lookupDir, cubeIndex), compareDistance);
+    shadow += texture(pointShadowMap, vec4(lookupDir + tangent * tapSpread, cubeIndex), compareDistance);
+    shadow += texture(pointShadowMap, vec4(lookupDir - tangent * tapSpread, cubeIndex), compareDistance);
+    shadow += texture(pointShadowMap, vec4(lookupDir + bitangent * tapSpread, cubeIndex), compareDistance);
+    shadow += texture(pointShadowMap, vec4(lookupDir - bitangent * tapSpread, cubeIndex), compareDistance);
+
+    return shadow / 5.0f;
+}
+
+
+// Order 2 SH evaluation in world-space, the coefficients carrying all the constants so that only the basis polynomials remain
+vec3 computeIrradianceSH(vec3 N)
+{
+    vec3 irradiance = shIrradiance[0]
+                    + shIrradiance[1] * N.y + shIrradiance[2] * N.z + shIrradiance[3] * N.x
+                    + shIrradiance[4] * (N.x * N.y) + shIrradiance[5] * (N.y * N.z) + shIrradiance[6] * (3.0f * N.z * N.z - 1.0f)
+                    + shIrradiance[7] * (N.x * N.z) + shIrradiance[8] * (N.x * N.x - N.y * N.y);
+
+    return max(irradiance, vec3(0.0f));
+}
+
+
+vec3 computeViewPosition(vec2 texCoords, float depth)
+{
+    vec4 viewPos = inverseProj * vec4(vec3(texCoords, depth) * 2.0f - 1.0f, 1.0f);
+
+    return viewPos.xyz / viewPos.w;
+}
+
+
+vec3 decodeOctahedral(vec2 octNormal)
+{
+    octNormal = octNormal * 2.0f - 1.0f;
+
+    vec3 normal = vec3(octNormal, 1.0f - abs(octNormal.x) - abs(octNormal.y));
+    float fold = max(-normal.z, 0.0f);
+    normal.xy -= vec2(normal.x >= 0.0f ? fold : -fold, normal.y >= 0.0f ? fold : -fold);
+
+    return normalize(normal);
+}
@@ -1,205 +1,151 @@
 #version 400 core
 
-in vec2 TexCoords;
-in vec3 envMapCoords;
 out vec4 colorOutput;
 
-
-struct LightObject
-{
-    vec3 position;
-    vec4 color;
-    float radius;
-};
-
 float PI  = 3.14159265359f;
 
-// Light source(s) informations
-uniform int lightPointCounter = 3;
-uniform LightObject lightPointArray[3];
+// Light source informations, view-space position + radius
+uniform vec4 lightPositionRadius;
+uniform vec4 lightColor;
+uniform int lightShadowLayer;
 
 // G-Buffer
 uniform sampler2D gPosition;
 uniform sampler2D gAlbedo;
 uniform sampler2D gNormal;
 uniform sampler2D gEffects;
+uniform bool gBufferCompact;
 
-uniform sampler2D sao;
-uniform sampler2D envMap;
+// Point light shadows, see lightingBRDF.frag
+uniform samplerCubeArrayShadow pointShadowMap;
+uniform float pointShadowTexelSize;
+uniform float pointShadowBias;
+uniform bool pointShadowMode;
 
-uniform int gBufferView;
 uniform int attenuationMode;
-uniform float materialRoughness;
-uniform float materialMetallicity;
-uniform float ambientIntensity;
+uniform vec2 viewportSize;
 uniform vec3 materialF0;
+uniform mat4 view;
+uniform mat4 inverseProj;
 
-float Fd90(float NoL, float roughness);
-float KDisneyTerm(float NoL, float NoV, float roughness);
-vec3 FresnelSchlick(float NdotV, vec3 F0);
-vec3 FresnelSchlick(float NdotV, vec3 F0, float roughness);
-float DistributionGGX(vec3 N, vec3 H, float roughness);
-float GeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughness);
 vec3 colorLinear(vec3 colorVector);
 float saturate(float f);
-vec2 saturate(vec2 vec);
-vec3 saturate(vec3 vec);
-vec2 getSphericalCoord(vec3 normalCoord);
+vec3 computeFresnelSchlick(float NdotV, vec3 F0);
+float computeDistributionGGX(vec3 N, vec3 H, float roughness);
+float computeGeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughness);
+float computePointShadow(vec3 viewPos, vec3 lightPos, float lightRadius, int cubeIndex, float NdotL);
+vec3 computeViewPosition(vec2 texCoords, float depth);
+vec3 decodeOctahedral(vec2 octNormal);
 
 
 void main()
 {
+    // Only the pixels marked in the stencil pass reach this point, and the output is blended additively
+    vec2 TexCoords = gl_FragCoord.xy / viewportSize;
+
     // Retrieve G-Buffer informations
-    vec3 viewPos = texture(gPosition, TexCoords).rgb;
     vec3 albedo = colorLinear(texture(gAlbedo, TexCoords).rgb);
-    vec3 normal = texture(gNormal, TexCoords).rgb;
     float roughness = texture(gAlbedo, TexCoords).a;
-    float metalness = texture(gNormal, TexCoords).a;
-    float ao = texture(gEffects, TexCoords).r;
-    vec2 velocity = texture(gEffects, TexCoords).gb;
-    float depth = texture(gPosition, TexCoords).a;
-
-    float sao = texture(sao, TexCoords).r;
-    vec3 envColor = texture(envMap, getSphericalCoord(normalize(envMapCoords))).rgb;
-
-    vec3 color = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
+    vec3 viewPos, normal;
+    float metalness, ao, depth;
 
-    if(depth == 1.0f)
+    // With the compact layout, gPosition is the depth buffer also bound for the stencil test : it is only read, never written
+    if (gBufferCompact)
     {
-        color = envColor;
+        uvec2 normalBits = uvec2(round(texture(gNormal, TexCoords).rg * 65535.0f));
+
+        depth = texture(gPosition, TexCoords).r;
+        viewPos = computeViewPosition(TexCoords, depth);
+        normal = decodeOctahedral(vec2(normalBits >> 5u) / 2047.0f);
+        metalness = float(normalBits.x & 31u) / 31.0f;
+        ao = float(normalBits.y & 31u) / 31.0f;
     }
 
     else
     {
-        vec3 V = normalize(- viewPos);
-        vec3 N = normalize(normal);
-        vec3 R = normalize(reflect(- V, N));
-
-        // Ambient component computation
-        vec3 ambient = ao * albedo * vec3(ambientIntensity);
-
-        // Light source independent BRDF term(s)
-        float NdotV = saturate(dot(N, V));
-
-        // Fresnel (Schlick) computation (F term)
-        vec3 F0 = mix(materialF0, albedo, metalness);
-        vec3 F = FresnelSchlick(NdotV, F0, roughness);
-
-        // Energy conservation
-        vec3 kS = F;
-        vec3 kD = vec3(1.0f) - kS;
-        kD *= 1.0f - metalness;
-
-        for (int i = 0; i < lightPointCounter; i++)
-        {
-            vec3 L = normalize(lightPointArray[i].position - viewPos);
-            vec3 H = normalize(L + V);
-
-            vec3 lightColor = colorLinear(lightPointArray[i].color.rgb);
-            float distanceL = length(lightPointArray[i].position - viewPos);
-            float attenuation;
-
-            if(attenuationMode == 1)
-                attenuation = 1.0 / (distanceL * distanceL);    // Quadratic attenuation
-            else if(attenuationMode == 2)
-                attenuation = pow(saturate(1 - pow(distanceL / lightPointArray[i].radius, 4)), 2) / (distanceL * distanceL + 1); // UE4 attenuation
-
-            // Light source dependent BRDF term(s)
-            float NdotL = saturate(dot(N, L));
-
-            // Radiance computation
-            vec3 kRadiance = lightColor * attenuation;
-
-            // Diffuse component computation
-            diffuse = albedo/PI;
+        viewPos = texture(gPosition, TexCoords).rgb;
+        normal = texture(gNormal, TexCoords).rgb;
+        metalness = texture(gNormal, TexCoords).a;
+        ao = texture(gEffects, TexCoords).r;
+        depth = texture(gPosition, TexCoords).a;
+    }
 
-            // Disney diffuse term
-            float kDisney = KDisneyTerm(NdotL, NdotV, roughness);
+    if(depth == 1.0f)
+        discard;
 
-            // Distribution (GGX) computation (D term)
-            float D = DistributionGGX(N, H, roughness);
+    vec3 V = normalize(- viewPos);
+    vec3 N = normalize(normal);
 
-            // Geometry attenuation (GGX-Smith) computation (G term)
-            float G = GeometryAttenuationGGXSmith(NdotL, NdotV, roughness);
+    float NdotV = max(dot(N, V), 0.0001f);
 
-            // Specular component computation
-            specular = (F * D * G) / (4 * NdotL * NdotV + 0.0001f);
+    // Fresnel (Schlick) computation (F term)
+    vec3 F0 = mix(materialF0, albedo, metalness);
+    vec3 F = computeFresnelSchlick(NdotV, F0);
 
+    // Energy conservation
+    vec3 kS = F;
+    vec3 kD = vec3(1.0f) - kS;
+    kD *= 1.0f - metalness;
 
-            color += (diffuse * kDisney * kD + specular) * kRadiance * NdotL;
-        }
+    vec3 L = normalize(lightPositionRadius.xyz - viewPos);
+    vec3 H = normalize(L + V);
 
-        color += ambient;
-    }
+    vec3 radianceColor = colorLinear(lightColor.rgb);
+    float distanceL = length(lightPositionRadius.xyz - viewPos);
+    float attenuation;
 
+    if(attenuationMode == 1)
+        attenuation = 1.0f / (distanceL * distanceL);    // Quadratic attenuation, clipped at the volume boundary
+    else
+        attenuation = pow(saturate(1 - pow(distanceL / lightPositionRadius.w, 4)), 2) / (distanceL * distanceL + 1); // UE4 attenuation
 
-    // Switching between the different buffers
-    // Final buffer
-    if(gBufferView == 1)
-        colorOutput = vec4(color, 1.0f);
-
-    // Position buffer
-    else if (gBufferView == 2)
-        colorOutput = vec4(viewPos, 1.0f);
+    // Light source dependent BRDF term(s)
+    float NdotL = saturate(dot(N, L));
 
-    // World Normal buffer
-    else if (gBufferView == 3)
-        colorOutput = vec4(normal, 1.0f);
+    // Radiance computation
+    float shadow = pointShadowMode ? computePointShadow(viewPos, lightPositionRadius.xyz, lightPositionRadius.w, lightShadowLayer, NdotL) : 1.0f;
+    vec3 kRadiance = radianceColor * attenuation * shadow;
 
-    // Color buffer
-    else if (gBufferView == 4)
-        colorOutput = vec4(albedo, 1.0f);
+    // Diffuse component computation
+    vec3 diffuse = albedo / PI;
 
-    // Roughness buffer
-    else if (gBufferView == 5)
-        colorOutput = vec4(vec3(roughness), 1.0f);
+    // Distribution (GGX) computation (D term)
+    float D = computeDistributionGGX(N, H, roughness);
 
-    // Metalness buffer
-    else if (gBufferView == 6)
-        colorOutput = vec4(vec3(metalness), 1.0f);
+    // Geometry attenuation (GGX-Smith) computation (G term)
+    float G = computeGeometryAttenuationGGXSmith(NdotL, NdotV, roughness);
 
-    // Depth buffer
-    else if (gBufferView == 7)
-        colorOutput = vec4(vec3(depth/1000.0f), 1.0f);
+    // Specular component computation
+    vec3 specular = (F * D * G) / (4.0f * NdotL * NdotV + 0.0001f);
 
-    // SAO buffer
-    else if (gBufferView == 8)
-        colorOutput = vec4(vec3(sao), 1.0f);
+    vec3 color = (diffuse * kD + specular) * kRadiance * NdotL;
 
-    // Velocity buffer
-    else if (gBufferView == 9)
-        colorOutput = vec4(velocity, 0.0f, 1.0f);
+    colorOutput = vec4(color * ao, 0.0f);
 }
 
 
 
-float Fd90(float NoL, float roughness)
+vec3 colorLinear(vec3 colorVector)
 {
-    return (2.0f * NoL * roughness) + 0.4f;
-}
-
+    vec3 linearColor = pow(colorVector.rgb, vec3(2.2f));
 
-float KDisneyTerm(float NoL, float NoV, float roughness)
-{
-    return (1.0f + Fd90(NoL, roughness) * pow(1.0f - NoL, 5.0f)) * (1.0f + Fd90(NoV, roughness) * pow(1.0f - NoV, 5.0f));
+    return linearColor;
 }
 
 
-vec3 FresnelSchlick(float NdotV, vec3 F0)
+float saturate(float f)
 {
-    return F0 + (1.0f - F0) * pow(1.0f - NdotV, 5.0f);
+    return clamp(f, 0.0, 1.0);
 }
 
 
-vec3 FresnelSchlick(float NdotV, vec3 F0, float roughness)
+vec3 computeFresnelSchlick(float NdotV, vec3 F0)
 {
-    return F0 + (max(vec3(1.0f - roughness), F0) - F0) * pow(1.0f - NdotV, 5.0f);
+    return F0 + (1.0f - F0) * pow(1.0f - NdotV, 5.0f);
 }
 
 
-float DistributionGGX(vec3 N, vec3 H, float roughness)
+float computeDistributionGGX(vec3 N, vec3 H, float roughness)
 {
     float alpha = roughness * roughness;
     float alpha2 = alpha * alpha;
@@ -211,7 +157,7 @@ float DistributionGGX(vec3 N, vec3 H, float roughness)
 }
 
 
-float GeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughness)
+float computeGeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughness)
 {
     float NdotL2 = NdotL * NdotL;
     float NdotV2 = NdotV * NdotV;
@@ -224,36 +170,52 @@ float GeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughness)
 }
 
 
-vec3 colorLinear(vec3 colorVector)
+// The cube faces are world-aligned, so only the rotation of the view matrix has to be undone to get the lookup direction
+float computePointShadow(vec3 viewPos, vec3 lightPos, float lightRadius, int cubeIndex, float NdotL)
 {
-    vec3 linearColor = pow(colorVector.rgb, vec3(2.2f));
+    if (cubeIndex < 0)
+        return 1.0f;
 
-    return linearColor;
-}
+    vec3 lightToFrag = (viewPos - lightPos) * mat3(view);
+    float fragDistance = length(lightToFrag);
 
+    if (fragDistance >= lightRadius)
+        return 1.0f;
 
-float saturate(float f)
-{
-    return clamp(f, 0.0, 1.0);
-}
+    float bias = clamp(pointShadowBias * tan(acos(NdotL)), 0.0f, 10.0f * pointShadowBias);
+    float compareDistance = fragDistance / lightRadius - bias;
 
+    // Center tap plus 4 taps spread over the plane orthogonal to the lookup, about a texel apart at the fragment distance
+    vec3 lookupDir = lightToFrag / fragDistance;
+    vec3 tangent = normalize(cross(lookupDir, abs(lookupDir.y) < 0.9f ? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f)));
+    vec3 bitangent = cross(lookupDir, tangent);
+    float tapSpread = 1.5f * pointShadowTexelSize;
 
-vec2 saturate(vec2 vec)
-{
-    return clamp(vec, 0.0, 1.0);
+    float shadow = texture(pointShadowMap, vec4(lookupDir, cubeIndex), compareDistance);
+    shadow += texture(pointShadowMap, vec4(lookupDir + tangent * tapSpread, cubeIndex), compareDistance);
+    shadow += texture(pointShadowMap, vec4(lookupDir - tangent * tapSpread, cubeIndex), compareDistance);
+    shadow += texture(pointShadowMap, vec4(lookupDir + bitangent * tapSpread, cubeIndex), compareDistance);
+    shadow += texture(pointShadowMap, vec4(lookupDir - bitangent * tapSpread, cubeIndex), compareDistance);
+
+    return shadow / 5.0f;
 }
 
 
-vec3 saturate(vec3 vec)
+vec3 computeViewPosition(vec2 texCoords, float depth)
 {
-    return clamp(vec, 0.0, 1.0);
+    vec4 viewPos = inverseProj * vec4(vec3(texCoords, depth) * 2.0f - 1.0f, 1.0f);
+
+    return viewPos.xyz / viewPos.w;
 }
 
 
-vec2 getSphericalCoord(vec3 normalCoord)
+vec3 decodeOctahedral(vec2 octNormal)
 {
-    float phi = acos(-normalCoord.y);
-    float theta = atan(1.0f * normalCoord.x, -normalCoord.z) + PI;
+    octNormal = octNormal * 2.0f - 1.0f;
+
+    vec3 normal = vec3(octNormal, 1.0f - abs(octNormal.x) - abs(octNormal.y));
+    float fold = max(-normal.z, 0.0f);
+    normal.xy -= vec2(normal.x >= 0.0f ? fold : -fold, normal.y >= 0.0f ? fold : -fold);
 
-    return vec2(theta / (2.0f * PI), phi / PI);
+    return normalize(normal);
 }
@@ -1,19 +1,18 @@
 #version 400 core
 
 layout (location = 0) in vec3 position;
-layout (location = 1) in vec2 texCoords;
 
-out vec2 TexCoords;
-out vec3 envMapCoords;
+// Bounding volume of a single point light, the unit sphere is stretched to its radius in view-space
+uniform vec4 lightPositionRadius;
+uniform mat4 projection;
+
+// The tessellated sphere is inscribed in the true one, scaling it up makes it cover the whole light radius
+const float volumeScale = 1.03f;
 
-uniform mat4 inverseView;
-uniform mat4 inverseProj;
 
 void main()
 {
-    TexCoords = texCoords;
-    vec4 unprojCoords = (inverseProj * vec4(position, vec2(1.0f)));
-    envMapCoords = (inverseView * unprojCoords).xyz;
+    vec3 viewPos = lightPositionRadius.xyz + position * lightPositionRadius.w * volumeScale;
 
-    gl_Position = vec4(position, 1.0f);
+    gl_Position = projection * vec4(viewPos, 1.0f);
 }
@@ -0,0 +1,13 @@
+#version 400 core
+
+in vec3 fragWorldPos;
+
+uniform vec3 lightPosition;
+uniform float lightRadius;
+
+
+void main()
+{
+    // Linear distance to the light, normalized by its radius, so that the lookup does not depend on the face it lands on
+    gl_FragDepth = length(fragWorldPos - lightPosition) / lightRadius;
+}
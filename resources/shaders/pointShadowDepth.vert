@@ -0,0 +1,12 @@
+#version 400 core
+
+layout (location = 0) in vec3 position;
+
+uniform mat4 model;
+
+
+void main()
+{
+    // World-space, the geometry shader projects the triangle on each cube face
+    gl_Position = model * vec4(position, 1.0f);
+}
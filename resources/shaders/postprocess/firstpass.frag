@@ -3,26 +3,25 @@
 in vec2 TexCoords;
 out vec4 colorOutput;
 
-float FXAA_SPAN_MAX = 8.0f;
-float FXAA_REDUCE_MUL = 1.0f/8.0f;
-float FXAA_REDUCE_MIN = 1.0f/128.0f;
 float middleGrey = 0.18f;
 
 uniform sampler2D screenTexture;
 uniform sampler2D sao;
-uniform sampler2D gEffects;
+uniform sampler2D gEffects;     // AO + velocity, velocity alone with the compact G-Buffer layout
+uniform sampler2D gPosition;    // View-space position, or the depth buffer with the compact G-Buffer layout
+uniform sampler2D velocityNeighborMax;
+uniform bool gBufferCompact;
 
 uniform int gBufferView;
 uniform int motionBlurMaxSamples;
 uniform int tonemappingMode;
 uniform bool saoMode;
-uniform bool fxaaMode;
 uniform bool motionBlurMode;
 uniform float cameraAperture;
 uniform float cameraShutterSpeed;
 uniform float cameraISO;
 uniform float motionBlurScale;
-uniform vec2 screenTextureSize;
+uniform vec2 cameraClip;
 
 
 vec3 colorLinear(vec3 colorVector);
@@ -31,8 +30,9 @@ vec3 ReinhardTM(vec3 color);
 vec3 FilmicTM(vec3 color);
 vec3 UnchartedTM(vec3 color);
 float computeSOBExposure(float aperture, float shutterSpeed, float iso);
-vec3 computeFxaa();
 vec3 computeMotionBlur(vec3 colorVector);
+vec2 fetchVelocity(vec2 texCoords);
+float fetchDistance(vec2 texCoords);
 
 
 void main()
@@ -41,11 +41,8 @@ void main()
 
     if(gBufferView == 1)
     {
-        // FXAA computation
-        if(fxaaMode)
-            color = computeFxaa();  // Don't know if applying FXAA first is a good idea, especially with effects such as motion blur and DoF...
-        else
-            color = texture(screenTexture, TexCoords).rgb;
+        // Already anti-aliased by the TAA pass when enabled
+        color = texture(screenTexture, TexCoords).rgb;
 
         // Motion Blur computation
         if(motionBlurMode)
@@ -92,64 +89,73 @@ void main()
 
 
 
-vec3 computeFxaa()
+// Reconstruction filter (McGuire et al. 2012) : every pixel of a tile gathers the same number of samples along the longest velocity
+// around it, so neighbouring pixels run the same loop, and tiles with nothing moving nearby leave right away. Each sample counts where
+// either its own blur or the blur of the center reaches the other one, the one in front deciding
+vec3 computeMotionBlur(vec3 colorVector)
 {
-    vec2 screenTextureOffset = screenTextureSize;
-    vec3 luma = vec3(0.299f, 0.587f, 0.114f);
+    vec2 texelSize = 1.0f / vec2(textureSize(gEffects, 0));
 
-    vec3 offsetNW = texture(screenTexture, TexCoords.xy + (vec2(-1.0f, -1.0f) * screenTextureOffset)).xyz;
-    vec3 offsetNE = texture(screenTexture, TexCoords.xy + (vec2(1.0f, -1.0f) * screenTextureOffset)).xyz;
-    vec3 offsetSW = texture(screenTexture, TexCoords.xy + (vec2(-1.0f, 1.0f) * screenTextureOffset)).xyz;
-    vec3 offsetSE = texture(screenTexture, TexCoords.xy + (vec2(1.0f, 1.0f) * screenTextureOffset)).xyz;
-    vec3 offsetM  = texture(screenTexture, TexCoords.xy).xyz;
+    vec2 neighborVelocity = texture(velocityNeighborMax, TexCoords).rg * motionBlurScale;
+    float neighborSpeed = length(neighborVelocity / texelSize);
 
-    float lumaNW = dot(luma, offsetNW);
-    float lumaNE = dot(luma, offsetNE);
-    float lumaSW = dot(luma, offsetSW);
-    float lumaSE = dot(luma, offsetSE);
-    float lumaM  = dot(luma, offsetNW);
+    if (neighborSpeed < 0.5f)
+        return colorVector;
 
-    vec2 dir = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)),
-                     ((lumaNW + lumaSW) - (lumaNE + lumaSE)));
+    int numSamples = clamp(int(neighborSpeed), 2, motionBlurMaxSamples);
 
-    float dirReduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * (FXAA_REDUCE_MUL * 0.25f), FXAA_REDUCE_MIN);
-    float dirCorrection = 1.0f / (min(abs(dir.x), abs(dir.y)) + dirReduce);
+    float centerSpeed = max(length(fetchVelocity(TexCoords) * motionBlurScale / texelSize), 1.0f);
+    float centerDistance = fetchDistance(TexCoords);
 
-    dir = min(vec2(FXAA_SPAN_MAX), max(vec2(-FXAA_SPAN_MAX), dir * dirCorrection)) * screenTextureOffset;
+    float weightTotal = 1.0f / centerSpeed;
+    vec3 colorTotal = colorVector * weightTotal;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        float sampleOffset = (float(i) + 0.5f) / float(numSamples) - 0.5f;
+        vec2 sampleCoords = TexCoords + neighborVelocity * sampleOffset;
+        float samplePixels = abs(sampleOffset) * neighborSpeed;
 
-    vec3 resultA = 0.5f * (texture(screenTexture, TexCoords.xy + (dir * vec2(1.0f / 3.0f - 0.5f))).xyz +
-                                    texture(screenTexture, TexCoords.xy + (dir * vec2(2.0f / 3.0f - 0.5f))).xyz);
+        float sampleSpeed = max(length(fetchVelocity(sampleCoords) * motionBlurScale / texelSize), 1.0f);
+        float sampleDistance = fetchDistance(sampleCoords);
 
-    vec3 resultB = resultA * 0.5f + 0.25f * (texture(screenTexture, TexCoords.xy + (dir * vec2(0.0f / 3.0f - 0.5f))).xyz +
-                                             texture(screenTexture, TexCoords.xy + (dir * vec2(3.0f / 3.0f - 0.5f))).xyz);
+        float depthExtent = 0.05f * min(centerDistance, sampleDistance);
+        float sampleFront = clamp(1.0f - (sampleDistance - centerDistance) / depthExtent, 0.0f, 1.0f);
+        float centerFront = clamp(1.0f - (centerDistance - sampleDistance) / depthExtent, 0.0f, 1.0f);
 
-    float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));
-    float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));
-    float lumaResultB = dot(luma, resultB);
+        float sampleCone = clamp(1.0f - samplePixels / sampleSpeed, 0.0f, 1.0f);
+        float centerCone = clamp(1.0f - samplePixels / centerSpeed, 0.0f, 1.0f);
+        float cylinders = (1.0f - smoothstep(0.95f * sampleSpeed, 1.05f * sampleSpeed, samplePixels)) * (1.0f - smoothstep(0.95f * centerSpeed, 1.05f * centerSpeed, samplePixels));
+
+        float sampleWeight = sampleFront * sampleCone + centerFront * centerCone + 2.0f * cylinders;
+
+        colorTotal += texture(screenTexture, sampleCoords).rgb * sampleWeight;
+        weightTotal += sampleWeight;
+    }
 
-    if(lumaResultB < lumaMin || lumaResultB > lumaMax)
-        return vec3(resultA);
-    else
-        return vec3(resultB);
+    return colorTotal / weightTotal;
 }
 
-vec3 computeMotionBlur(vec3 colorVector)
-{
-    vec2 texelSize = 1.0f / vec2(textureSize(screenTexture, 0));
 
-    vec2 velocity = texture(gEffects, TexCoords).gb;
-    velocity *= motionBlurScale;
+vec2 fetchVelocity(vec2 texCoords)
+{
+    return gBufferCompact ? texture(gEffects, texCoords).rg : texture(gEffects, texCoords).gb;
+}
 
-    float fragSpeed = length(velocity / texelSize);
-    int numSamples = clamp(int(fragSpeed), 1, motionBlurMaxSamples);
 
-    for (int i = 1; i < numSamples; ++i)
+// Linear distance along the view axis, the cleared background of the full layout being pushed to the far plane
+float fetchDistance(vec2 texCoords)
+{
+    if (gBufferCompact)
     {
-        vec2 blurOffset = velocity * (float(i) / float(numSamples - 1) - 0.5f);
-        colorVector += texture(screenTexture, TexCoords + blurOffset).rgb;
+        float depth = texture(gPosition, texCoords).r;
+
+        return cameraClip.x * cameraClip.y / (cameraClip.y - depth * (cameraClip.y - cameraClip.x));
     }
 
-    return colorVector /= float(numSamples);
+    float viewDistance = -texture(gPosition, texCoords).z;
+
+    return viewDistance > 0.0f ? viewDistance : cameraClip.y;
 }
 
 
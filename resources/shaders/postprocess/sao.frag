@@ -1,55 +1,107 @@
 #version 430 core
 
-out float saoOutput;
+out vec2 saoOutput;     // SAO and view-space depth, packed for the blur
 in vec2 TexCoords;
 
 int saoQ = 4;
 float PI  = 3.14159265359f;
 float saoEpsilon = 0.01f;
 
-uniform sampler2D gPosition;
+uniform sampler2D saoDepth;
 uniform sampler2D gNormal;
+uniform bool gBufferCompact;
+uniform vec4 projInfo;
+uniform int saoLevel;
 
 uniform int viewportWidth;
 uniform int viewportHeight;
 uniform int saoSamples;
+uniform int saoSampleStride;
+uniform int saoSamplePhase;
 uniform int saoTurns;
 uniform float saoRadius;
 uniform float saoBias;
 uniform float saoScale;
 uniform float saoContrast;
 
+vec3 fetchPosition(ivec2 pixel, int mipLevel);
+ivec2 fetchSourcePixel(ivec2 pixel, int mipLevel);
+vec3 decodeOctahedral(vec2 octNormal);
+
 
 void main(void){
-    vec3 fragPos = texture(gPosition, TexCoords).xyz;
-    vec3 normal = normalize(texture(gNormal, TexCoords).rgb);
+    // At half or quarter resolution, the fragment stands for the full resolution pixel its pyramid depth was taken from,
+    // so that its normal matches its depth, the taps staying in full resolution pixels
+    ivec2 saoPixel = ivec2(gl_FragCoord.xy);
+    ivec2 saoOffset = fetchSourcePixel(saoPixel, saoLevel);
+
+    vec3 fragPos = fetchPosition(saoOffset, saoLevel);
+    vec3 normal = gBufferCompact ? decodeOctahedral(vec2(uvec2(round(texelFetch(gNormal, saoOffset, 0).rg * 65535.0f)) >> 5u) / 2047.0f) : normalize(texelFetch(gNormal, saoOffset, 0).rgb);
 
     float saoOcclusion = 0.0f;
 
     // AlchemyAO XOR hash to randomize our sample offset rotation
-    ivec2 saoOffset = ivec2(gl_FragCoord.xy);
-    float saoPhi = (30 * saoOffset.x ^ saoOffset.y + 10 * saoOffset.x * saoOffset.y);
+    float saoPhi = (30 * saoPixel.x ^ saoPixel.y + 10 * saoPixel.x * saoPixel.y);
 
     const float saoScreenRadius = -saoRadius * 3500.0f / fragPos.z;   // Kinda hard to properly define the pixel-size of a 1m object at z = −1m, sooo...
-    int saoMaxMipLevel = textureQueryLevels(gPosition) - 1;
+    int saoMaxMipLevel = textureQueryLevels(saoDepth) - 1;
+
+    // Temporal mode : every frame only takes one tap out of saoSampleStride along the spiral, the phase cycling through them
+    int saoTaps = 0;
 
-    for (int i = 0; i < saoSamples; ++i)
+    for (int i = saoSamplePhase; i < saoSamples; i += saoSampleStride)
     {
+        saoTaps++;
+
         float saoAlpha = 1.0f / saoSamples * (i + 0.5f);
         float saoH = saoScreenRadius * saoAlpha;
         float saoTetha = 2.0f * PI * saoAlpha * saoTurns + saoPhi;
         vec2 saoU = vec2(cos(saoTetha), sin(saoTetha));
 
-        int saoM = clamp(findMSB(int(saoH)) - 4, 0, saoMaxMipLevel);
-        vec3 saoSampleOffset = texelFetch(gPosition, ivec2(saoH * saoU + saoOffset) >> saoM, saoM).xyz;
+        int saoM = clamp(findMSB(int(saoH)) - 4, saoLevel, saoMaxMipLevel);
+        vec3 saoSampleOffset = fetchPosition(ivec2(saoH * saoU + saoOffset), saoM);
         vec3 saoV = saoSampleOffset - fragPos;
 
         // AlchemyAO obscurance estimator
         saoOcclusion += max(0.0f, dot(saoV, normal) + (fragPos.z * saoBias)) / (dot(saoV, saoV) + saoEpsilon);
     }
 
-    saoOcclusion = max(0, 1.0f - 2.0f * saoScale / saoSamples * saoOcclusion);
+    saoOcclusion = max(0, 1.0f - 2.0f * saoScale / max(saoTaps, 1) * saoOcclusion);
     saoOcclusion = pow(saoOcclusion, saoContrast);
 
-    saoOutput = saoOcclusion;
+    saoOutput = vec2(saoOcclusion, fragPos.z);
+}
+
+
+
+// View-space position rebuilt from the Z pyramid level picked from the tap distance,
+// projInfo turning the pixel coordinates into view-space x and y per unit of depth
+vec3 fetchPosition(ivec2 pixel, int mipLevel)
+{
+    ivec2 levelPixel = clamp(pixel >> mipLevel, ivec2(0), textureSize(saoDepth, mipLevel) - 1);
+    float viewZ = texelFetch(saoDepth, levelPixel, mipLevel).r;
+
+    return vec3((vec2(pixel) + 0.5f) * projInfo.xy + projInfo.zw, 1.0f) * viewZ;
+}
+
+
+// Full resolution pixel whose depth ended up in the given pyramid texel, following the rotated grid of each downsample
+ivec2 fetchSourcePixel(ivec2 pixel, int mipLevel)
+{
+    for (int level = mipLevel; level > 0; --level)
+        pixel = min(pixel * 2 + ivec2(pixel.y & 1, pixel.x & 1), textureSize(saoDepth, level - 1) - 1);
+
+    return pixel;
+}
+
+
+vec3 decodeOctahedral(vec2 octNormal)
+{
+    octNormal = octNormal * 2.0f - 1.0f;
+
+    vec3 normal = vec3(octNormal, 1.0f - abs(octNormal.x) - abs(octNormal.y));
+    float fold = max(-normal.z, 0.0f);
+    normal.xy -= vec2(normal.x >= 0.0f ? fold : -fold, normal.y >= 0.0f ? fold : -fold);
+
+    return normalize(normal);
 }
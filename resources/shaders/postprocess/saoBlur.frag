@@ -1,25 +1,47 @@
 #version 400 core
 
 in vec2 TexCoords;
-out float saoBlurOutput;
+out vec2 saoBlurOutput;
 
 uniform sampler2D saoInput;
 uniform int saoBlurSize;
+uniform float saoBlurSharpness;
+uniform ivec2 saoBlurAxis;
 
 
+// One axis of a separable bilateral blur, run horizontally then vertically : the input packs the SAO along with its view-space depth,
+// so every tap is a single fetch. Taps are weighted by a gaussian and by how far their depth lies from the plane of the center pixel,
+// whose slope along the axis is taken from its closest neighbour so that AO neither bleeds across silhouettes nor fades on slanted surfaces
 void main()
 {
-   vec2 texelSize = 1.0 / vec2(textureSize(saoInput, 0));
-   float result = 0.0;
-
-   for (int x = 0; x < saoBlurSize; ++x)
-   {
-      for (int y = 0; y < saoBlurSize; ++y)
-      {
-         vec2 offset = (vec2(-2.0) + vec2(float(x), float(y))) * texelSize;
-         result += texture(saoInput, TexCoords + offset).r;
-      }
-   }
-
-   saoBlurOutput = result / float(saoBlurSize * saoBlurSize);
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 saoSize = textureSize(saoInput, 0);
+
+    vec2 centerSample = texelFetch(saoInput, pixel, 0).rg;
+    float centerZ = centerSample.g;
+
+    float prevZ = texelFetch(saoInput, clamp(pixel - saoBlurAxis, ivec2(0), saoSize - 1), 0).g;
+    float nextZ = texelFetch(saoInput, clamp(pixel + saoBlurAxis, ivec2(0), saoSize - 1), 0).g;
+    float slopeZ = abs(nextZ - centerZ) < abs(centerZ - prevZ) ? nextZ - centerZ : centerZ - prevZ;
+
+    float saoTotal = centerSample.r;
+    float weightTotal = 1.0f;
+
+    float sigma = max(float(saoBlurSize) * 0.5f, 0.5f);
+
+    for (int i = -saoBlurSize; i <= saoBlurSize; ++i)
+    {
+        if (i == 0)
+            continue;
+
+        vec2 tapSample = texelFetch(saoInput, clamp(pixel + saoBlurAxis * i, ivec2(0), saoSize - 1), 0).rg;
+
+        float depthDelta = abs(tapSample.g - (centerZ + slopeZ * i)) / max(abs(centerZ), 1e-4f);
+        float tapWeight = exp(-float(i * i) / (2.0f * sigma * sigma)) * max(0.0f, 1.0f - depthDelta * saoBlurSharpness);
+
+        saoTotal += tapSample.r * tapWeight;
+        weightTotal += tapWeight;
+    }
+
+    saoBlurOutput = vec2(saoTotal / weightTotal, centerZ);
 }
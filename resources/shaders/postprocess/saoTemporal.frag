@@ -0,0 +1,50 @@
+#version 400 core
+
+in vec2 TexCoords;
+out vec4 saoTemporalOutput;     // SAO, view-space depth and accumulated frame count
+
+uniform sampler2D saoInput;
+uniform sampler2D saoHistory;
+uniform sampler2D gEffects;     // AO + velocity, velocity alone with the compact G-Buffer layout
+uniform bool gBufferCompact;
+uniform bool saoHistoryValid;
+
+uniform float saoTemporalFeedback;
+uniform float saoTemporalDepthThreshold;
+uniform int saoTemporalFrames;
+
+
+// Accumulation of the few SAO taps of each frame : the previous result is reprojected with the G-Buffer velocity and averaged
+// with the new one over the frames of a whole sample cycle, then kept as an exponential average. The history is dropped where
+// its depth disagrees with the current one (disocclusion) or when it comes from off-screen
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec2 currentSample = texelFetch(saoInput, pixel, 0).rg;
+
+    vec2 velocity = gBufferCompact ? texture(gEffects, TexCoords).rg : texture(gEffects, TexCoords).gb;
+    vec2 historyCoords = TexCoords - velocity;
+
+    if (!saoHistoryValid || any(lessThan(historyCoords, vec2(0.0f))) || any(greaterThan(historyCoords, vec2(1.0f))))
+    {
+        saoTemporalOutput = vec4(currentSample, 1.0f, 0.0f);
+        return;
+    }
+
+    // Nearest fetch, a bilinear one would blend the depths of both sides of a silhouette, clamped since historyCoords can reach 1
+    ivec2 historySize = textureSize(saoHistory, 0);
+    vec3 historySample = texelFetch(saoHistory, clamp(ivec2(historyCoords * vec2(historySize)), ivec2(0), historySize - 1), 0).rgb;
+
+    float depthDelta = abs(historySample.g - currentSample.g) / max(abs(currentSample.g), 1e-4f);
+
+    if (depthDelta > saoTemporalDepthThreshold)
+    {
+        saoTemporalOutput = vec4(currentSample, 1.0f, 0.0f);
+        return;
+    }
+
+    float historyFrames = min(historySample.b, float(saoTemporalFrames));
+    float currentWeight = max(1.0f / (historyFrames + 1.0f), saoTemporalFeedback);
+
+    saoTemporalOutput = vec4(mix(historySample.r, currentSample.r, currentWeight), currentSample.g, historyFrames + 1.0f, 0.0f);
+}
@@ -0,0 +1,97 @@
+#version 430 core
+
+in vec2 TexCoords;
+out float saoUpsampleOutput;
+
+uniform sampler2D saoInput;
+uniform sampler2D saoDepth;
+uniform sampler2D gNormal;
+uniform bool gBufferCompact;
+
+uniform int saoLevel;
+uniform float saoUpsampleDepthSharpness;
+uniform float saoUpsampleNormalSharpness;
+
+vec3 fetchNormal(ivec2 pixel);
+ivec2 fetchSourcePixel(ivec2 pixel, int mipLevel);
+vec3 decodeOctahedral(vec2 octNormal);
+
+
+// Joint bilateral upsample of the half or quarter resolution SAO : the bilinear weights of the 4 nearest low resolution
+// texels are scaled down by how far their depth and normal lie from the full resolution ones, so that the AO stops at silhouettes
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 saoSize = textureSize(saoInput, 0);
+
+    float fullZ = texelFetch(saoDepth, pixel, 0).r;
+    vec3 fullNormal = fetchNormal(pixel);
+
+    vec2 saoCoords = (vec2(pixel) + 0.5f) / float(1 << saoLevel) - 0.5f;
+    ivec2 saoBase = ivec2(floor(saoCoords));
+    vec2 saoFract = saoCoords - vec2(saoBase);
+
+    float saoTotal = 0.0f;
+    float weightTotal = 0.0f;
+
+    // Nearest texel in depth, kept for the pixels whose 4 neighbours all got rejected
+    float nearestSAO = 1.0f;
+    float nearestDepth = 1e30f;
+
+    for (int i = 0; i < 4; ++i)
+    {
+        ivec2 tapOffset = ivec2(i & 1, i >> 1);
+        ivec2 tapPixel = clamp(saoBase + tapOffset, ivec2(0), saoSize - 1);
+
+        float tapSAO = texelFetch(saoInput, tapPixel, 0).r;
+        float tapZ = texelFetch(saoDepth, tapPixel, saoLevel).r;
+        vec3 tapNormal = fetchNormal(fetchSourcePixel(tapPixel, saoLevel));
+
+        vec2 bilinear = mix(1.0f - saoFract, saoFract, vec2(tapOffset));
+        float depthDelta = abs(tapZ - fullZ) / max(abs(fullZ), 1e-4f);
+        float depthWeight = 1.0f / (1.0f + depthDelta * saoUpsampleDepthSharpness);
+        float normalWeight = pow(max(dot(tapNormal, fullNormal), 0.0f), saoUpsampleNormalSharpness);
+
+        float tapWeight = bilinear.x * bilinear.y * depthWeight * normalWeight;
+
+        saoTotal += tapSAO * tapWeight;
+        weightTotal += tapWeight;
+
+        if (abs(tapZ - fullZ) < nearestDepth)
+        {
+            nearestDepth = abs(tapZ - fullZ);
+            nearestSAO = tapSAO;
+        }
+    }
+
+    saoUpsampleOutput = weightTotal > 1e-4f ? saoTotal / weightTotal : nearestSAO;
+}
+
+
+
+vec3 fetchNormal(ivec2 pixel)
+{
+    return gBufferCompact ? decodeOctahedral(vec2(uvec2(round(texelFetch(gNormal, pixel, 0).rg * 65535.0f)) >> 5u) / 2047.0f) : normalize(texelFetch(gNormal, pixel, 0).rgb);
+}
+
+
+// Full resolution pixel whose depth ended up in the given pyramid texel, the low resolution normals being read there
+ivec2 fetchSourcePixel(ivec2 pixel, int mipLevel)
+{
+    for (int level = mipLevel; level > 0; --level)
+        pixel = min(pixel * 2 + ivec2(pixel.y & 1, pixel.x & 1), textureSize(saoDepth, level - 1) - 1);
+
+    return pixel;
+}
+
+
+vec3 decodeOctahedral(vec2 octNormal)
+{
+    octNormal = octNormal * 2.0f - 1.0f;
+
+    vec3 normal = vec3(octNormal, 1.0f - abs(octNormal.x) - abs(octNormal.y));
+    float fold = max(-normal.z, 0.0f);
+    normal.xy -= vec2(normal.x >= 0.0f ? fold : -fold, normal.y >= 0.0f ? fold : -fold);
+
+    return normalize(normal);
+}
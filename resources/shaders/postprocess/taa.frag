@@ -0,0 +1,130 @@
+#version 400 core
+
+in vec2 TexCoords;
+out vec4 taaOutput;
+
+uniform sampler2D taaInput;
+uniform sampler2D taaHistory;
+uniform sampler2D gEffects;     // AO + velocity, velocity alone with the compact G-Buffer layout
+uniform sampler2D gPosition;    // View-space position, or the depth buffer with the compact G-Buffer layout
+uniform bool gBufferCompact;
+uniform bool taaHistoryValid;
+
+uniform float taaFeedback;
+uniform float taaClipGamma;
+
+vec3 RGBToYCoCg(vec3 color);
+vec3 YCoCgToRGB(vec3 color);
+vec3 clipHistory(vec3 history, vec3 boxMin, vec3 boxMax);
+float fetchDepth(ivec2 pixel);
+
+
+// Temporal anti-aliasing : the jittered frames are accumulated into a history reprojected with the G-Buffer velocity. The history is
+// clipped to the color box of the current 3x3 neighbourhood (its mean and variance, in YCoCg), and dropped when it falls off-screen,
+// the velocity being taken from the closest neighbour so that silhouettes keep the motion of the foreground
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 inputSize = textureSize(taaInput, 0);
+
+    vec3 currentColor = RGBToYCoCg(texelFetch(taaInput, pixel, 0).rgb);
+    vec3 colorMean = vec3(0.0f);
+    vec3 colorSquared = vec3(0.0f);
+    vec3 colorMin = currentColor;
+    vec3 colorMax = currentColor;
+
+    ivec2 closestPixel = pixel;
+    float closestDepth = fetchDepth(pixel);
+
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            ivec2 tapPixel = clamp(pixel + ivec2(x, y), ivec2(0), inputSize - 1);
+            vec3 tapColor = RGBToYCoCg(texelFetch(taaInput, tapPixel, 0).rgb);
+
+            colorMean += tapColor;
+            colorSquared += tapColor * tapColor;
+            colorMin = min(colorMin, tapColor);
+            colorMax = max(colorMax, tapColor);
+
+            float tapDepth = fetchDepth(tapPixel);
+
+            if (tapDepth < closestDepth)
+            {
+                closestDepth = tapDepth;
+                closestPixel = tapPixel;
+            }
+        }
+    }
+
+    colorMean /= 9.0f;
+    vec3 colorSigma = sqrt(max(colorSquared / 9.0f - colorMean * colorMean, 0.0f));
+
+    vec2 velocity = gBufferCompact ? texelFetch(gEffects, closestPixel, 0).rg : texelFetch(gEffects, closestPixel, 0).gb;
+    vec2 historyCoords = TexCoords - velocity;
+
+    // History rejection : nothing to accumulate yet, or a pixel coming from off-screen
+    if (!taaHistoryValid || any(lessThan(historyCoords, vec2(0.0f))) || any(greaterThan(historyCoords, vec2(1.0f))))
+    {
+        taaOutput = vec4(YCoCgToRGB(currentColor), 1.0f);
+        return;
+    }
+
+    vec3 historyColor = RGBToYCoCg(texture(taaHistory, historyCoords).rgb);
+
+    vec3 boxMin = max(colorMin, colorMean - taaClipGamma * colorSigma);
+    vec3 boxMax = min(colorMax, colorMean + taaClipGamma * colorSigma);
+    historyColor = clipHistory(historyColor, boxMin, boxMax);
+
+    // Faster moving pixels trust their history less, its bilinear fetch blurring a little more every frame
+    float velocityPixels = length(velocity * vec2(inputSize));
+    float currentWeight = mix(taaFeedback, 0.5f, clamp(velocityPixels / 32.0f, 0.0f, 1.0f));
+
+    // Weighted by the inverse luma so that a few bright pixels do not flicker through the whole accumulation
+    float historyWeight = (1.0f - currentWeight) / (1.0f + historyColor.x);
+    currentWeight /= 1.0f + currentColor.x;
+
+    vec3 resolvedColor = (currentColor * currentWeight + historyColor * historyWeight) / (currentWeight + historyWeight);
+
+    taaOutput = vec4(YCoCgToRGB(resolvedColor), 1.0f);
+}
+
+
+
+vec3 RGBToYCoCg(vec3 color)
+{
+    return vec3(dot(color, vec3(0.25f, 0.5f, 0.25f)), dot(color, vec3(0.5f, 0.0f, -0.5f)), dot(color, vec3(-0.25f, 0.5f, -0.25f)));
+}
+
+
+vec3 YCoCgToRGB(vec3 color)
+{
+    return vec3(color.x + color.y - color.z, color.x + color.z, color.x - color.y - color.z);
+}
+
+
+// Moves the history towards the box center until it lies inside of it, which keeps its hue unlike a per-channel clamp
+vec3 clipHistory(vec3 history, vec3 boxMin, vec3 boxMax)
+{
+    vec3 boxCenter = 0.5f * (boxMax + boxMin);
+    vec3 boxExtent = 0.5f * (boxMax - boxMin) + 1e-5f;
+
+    vec3 historyOffset = history - boxCenter;
+    vec3 offsetUnits = abs(historyOffset / boxExtent);
+    float offsetMax = max(offsetUnits.x, max(offsetUnits.y, offsetUnits.z));
+
+    return offsetMax > 1.0f ? boxCenter + historyOffset / offsetMax : history;
+}
+
+
+// Smaller is closer for both layouts : raw depth buffer value, or distance along the view axis (the cleared background being at 0)
+float fetchDepth(ivec2 pixel)
+{
+    if (gBufferCompact)
+        return texelFetch(gPosition, pixel, 0).r;
+
+    float viewDistance = -texelFetch(gPosition, pixel, 0).z;
+
+    return viewDistance > 0.0f ? viewDistance : 1e30f;
+}
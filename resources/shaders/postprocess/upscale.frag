@@ -0,0 +1,83 @@
+#version 400 core
+
+in vec2 TexCoords;
+out vec4 upscaleOutput;
+
+uniform sampler2D upscaleInput;
+uniform float upscaleSharpness;
+
+float computeLuma(vec3 color);
+float computeLanczos2(float distance2);
+
+
+// Edge-aware spatial upscale of the lighting rendered at a lower resolution (along the lines of AMD FSR 1 EASU) : a 4x4 Lanczos
+// kernel is squeezed across the local edge and stretched along it, so that edges stay sharp without stair-stepping, then the result
+// is clamped to the 2x2 texels around the pixel to get rid of the ringing
+void main()
+{
+    ivec2 inputSize = textureSize(upscaleInput, 0);
+    vec2 inputCoords = TexCoords * vec2(inputSize) - 0.5f;
+    ivec2 inputBase = ivec2(floor(inputCoords));
+    vec2 inputFract = inputCoords - vec2(inputBase);
+
+    vec3 quadA = texelFetch(upscaleInput, clamp(inputBase, ivec2(0), inputSize - 1), 0).rgb;
+    vec3 quadB = texelFetch(upscaleInput, clamp(inputBase + ivec2(1, 0), ivec2(0), inputSize - 1), 0).rgb;
+    vec3 quadC = texelFetch(upscaleInput, clamp(inputBase + ivec2(0, 1), ivec2(0), inputSize - 1), 0).rgb;
+    vec3 quadD = texelFetch(upscaleInput, clamp(inputBase + ivec2(1, 1), ivec2(0), inputSize - 1), 0).rgb;
+
+    // Edge direction and contrast, from the luma gradient of the 2x2 quad
+    float lumaA = computeLuma(quadA);
+    float lumaB = computeLuma(quadB);
+    float lumaC = computeLuma(quadC);
+    float lumaD = computeLuma(quadD);
+
+    vec2 lumaGradient = vec2(lumaB - lumaA + lumaD - lumaC, lumaC - lumaA + lumaD - lumaB);
+    float gradientLength = length(lumaGradient);
+    vec2 edgeAcross = gradientLength > 1e-5f ? lumaGradient / gradientLength : vec2(1.0f, 0.0f);
+    vec2 edgeAlong = vec2(-edgeAcross.y, edgeAcross.x);
+
+    float lumaMax = max(max(lumaA, lumaB), max(lumaC, lumaD));
+    float edgeStrength = clamp(gradientLength / (lumaMax + 1e-4f), 0.0f, 1.0f) * upscaleSharpness;
+
+    vec3 colorTotal = vec3(0.0f);
+    float weightTotal = 0.0f;
+
+    for (int y = -1; y <= 2; ++y)
+    {
+        for (int x = -1; x <= 2; ++x)
+        {
+            vec3 tapColor = texelFetch(upscaleInput, clamp(inputBase + ivec2(x, y), ivec2(0), inputSize - 1), 0).rgb;
+
+            vec2 tapOffset = vec2(x, y) - inputFract;
+            vec2 edgeOffset = vec2(dot(tapOffset, edgeAcross) * (1.0f + edgeStrength), dot(tapOffset, edgeAlong) / (1.0f + edgeStrength));
+            float tapWeight = computeLanczos2(dot(edgeOffset, edgeOffset));
+
+            colorTotal += tapColor * tapWeight;
+            weightTotal += tapWeight;
+        }
+    }
+
+    vec3 colorMin = min(min(quadA, quadB), min(quadC, quadD));
+    vec3 colorMax = max(max(quadA, quadB), max(quadC, quadD));
+
+    upscaleOutput = vec4(clamp(colorTotal / max(weightTotal, 1e-4f), colorMin, colorMax), 1.0f);
+}
+
+
+
+float computeLuma(vec3 color)
+{
+    return dot(color, vec3(0.2126f, 0.7152f, 0.0722f));
+}
+
+
+// Polynomial approximation of the windowed Lanczos 2 kernel, from the squared distance
+float computeLanczos2(float distance2)
+{
+    distance2 = min(distance2, 4.0f);
+
+    float window = 0.25f * distance2 - 1.0f;
+    float base = 0.4f * distance2 - 1.0f;
+
+    return (25.0f / 16.0f * base * base - (25.0f / 16.0f - 1.0f)) * window * window;
+}
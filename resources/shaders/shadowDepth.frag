@@ -0,0 +1,7 @@
+#version 400 core
+
+
+void main()
+{
+    // Depth only, written by the fixed-function pipeline
+}
@@ -12,7 +12,9 @@
 Camera::Camera(glm::vec3 position, glm::vec3 up, GLfloat yaw, GLfloat pitch) :  cameraFront(glm::vec3(0.0f, 0.0f, -1.0f)),
                                                                                 cameraSpeed(defaultCameraSpeed),
                                                                                 cameraSensitivity(defaultCameraSensitivity),
-                                                                                cameraFOV(defaultCameraFOV)
+                                                                                cameraFOV(defaultCameraFOV),
+                                                                                cameraJitter(glm::vec2(0.0f)),
+                                                                                cameraJitterIndex(0)
 {
     this->cameraPosition = position;
     this->worldUp = up;
@@ -34,6 +36,36 @@ glm::mat4 Camera::GetViewMatrix()
 }
 
 
+// The jitter moves the whole image, the unjittered matrix being kept for everything else (velocity, reconstruction...)
+glm::mat4 Camera::GetJitteredProjection(glm::mat4 projection)
+{
+    // Perspective divide by -z : the z column terms end up as minus the NDC offset
+    projection[2][0] -= this->cameraJitter.x;
+    projection[2][1] -= this->cameraJitter.y;
+
+    return projection;
+}
+
+
+// Next sub-pixel offset of a Halton (2, 3) sequence, cycled every cameraJitterCount frames for the temporal anti-aliasing
+void Camera::updateJitter(GLuint width, GLuint height)
+{
+    this->cameraJitterIndex = (this->cameraJitterIndex + 1) % cameraJitterCount;
+
+    GLfloat jitterX = this->computeHalton(this->cameraJitterIndex + 1, 2) - 0.5f;
+    GLfloat jitterY = this->computeHalton(this->cameraJitterIndex + 1, 3) - 0.5f;
+
+    this->cameraJitter = glm::vec2(jitterX * 2.0f / width, jitterY * 2.0f / height);
+}
+
+
+void Camera::resetJitter()
+{
+    this->cameraJitter = glm::vec2(0.0f);
+    this->cameraJitterIndex = 0;
+}
+
+
 void Camera::keyboardCall(Camera_Movement direction, GLfloat deltaTime)
 {
     GLfloat cameraVelocity = this->cameraSpeed * deltaTime;
@@ -90,3 +122,19 @@ void Camera::updateCameraVectors()
     this->cameraRight = glm::normalize(glm::cross(this->cameraFront, this->worldUp));
     this->cameraUp = glm::normalize(glm::cross(this->cameraRight, this->cameraFront));
 }
+
+
+GLfloat Camera::computeHalton(GLuint index, GLuint base)
+{
+    GLfloat haltonValue = 0.0f;
+    GLfloat haltonFraction = 1.0f;
+
+    while (index > 0)
+    {
+        haltonFraction /= base;
+        haltonValue += haltonFraction * (index % base);
+        index /= base;
+    }
+
+    return haltonValue;
+}
@@ -15,6 +15,7 @@ const GLfloat defaultCameraPitch = 0.0f;
 const GLfloat defaultCameraSpeed = 4.0f;
 const GLfloat defaultCameraSensitivity = 0.10f;
 const GLfloat defaultCameraFOV = glm::radians(45.0f);
+const GLuint cameraJitterCount = 8;
 
 enum Camera_Movement {
     FORWARD,
@@ -37,16 +38,22 @@ class Camera
         GLfloat cameraSpeed;
         GLfloat cameraSensitivity;
         GLfloat cameraFOV;
+        glm::vec2 cameraJitter;     // Sub-pixel offset of the projection, in NDC
+        GLuint cameraJitterIndex;
 
         Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), GLfloat yaw = defaultCameraYaw, GLfloat pitch = defaultCameraPitch);
         ~Camera();
         glm::mat4 GetViewMatrix();
+        glm::mat4 GetJitteredProjection(glm::mat4 projection);
+        void updateJitter(GLuint width, GLuint height);
+        void resetJitter();
         void keyboardCall(Camera_Movement direction, GLfloat deltaTime);
         void mouseCall(GLfloat xoffset, GLfloat yoffset, GLboolean constrainPitch = true);
         void scrollCall(GLfloat yoffset);
 
     private:
         void updateCameraVectors();
+        GLfloat computeHalton(GLuint index, GLuint base);
 };
 
 #endif
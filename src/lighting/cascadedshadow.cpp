@@ -0,0 +1,302 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "cascadedshadow.h"
+
+
+// Casters lying between the light and a cascade volume, up to this distance, still make it into the cascade
+const GLfloat shadowCasterDistance = 20.0f;
+
+// Extra coverage given to the cached cascades, which is what lets them stay put while the camera moves a bit
+const GLfloat shadowCachedSlack = 1.25f;
+
+
+CascadedShadow::CascadedShadow()
+{
+    for (GLuint i = 0; i < cascadeMax; ++i)
+    {
+        this->cascadeRadius[i] = 0.0f;
+        this->cascadeSplit[i] = 0.0f;
+        this->cascadeDirty[i] = true;
+        this->cascadeUpdated[i] = false;
+    }
+}
+
+
+CascadedShadow::~CascadedShadow()
+{
+
+}
+
+
+void CascadedShadow::setShadowMap(GLuint resolution)
+{
+    this->cascadeResolution = resolution;
+
+    if (!this->shadowFBO)
+    {
+        glGenFramebuffers(1, &this->shadowFBO);
+        glGenTextures(1, &this->shadowAtlas);
+    }
+
+    // 2x2 atlas, cascade i lives in the cell (i & 1, i >> 1)
+    glBindTexture(GL_TEXTURE_2D, this->shadowAtlas);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, 2 * resolution, 2 * resolution, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->shadowFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->shadowAtlas, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Shadow Framebuffer not complete !" << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    this->invalidateCascades();
+}
+
+
+// Practical split scheme (blend of the logarithmic and uniform distributions), each slice being enclosed in a sphere.
+// The sphere does not depend on the camera orientation, and its center is snapped to the shadow texel grid,
+// so the cascades do not shimmer when the camera rotates or moves
+void CascadedShadow::updateCascades(const glm::mat4& view, GLfloat fov, GLfloat aspect, GLfloat zNear, GLfloat shadowDistance, GLfloat splitLambda, glm::vec3 lightDirection)
+{
+    lightDirection = glm::normalize(lightDirection);
+
+    if (lightDirection != this->cascadeLightDirection)
+    {
+        this->cascadeLightDirection = lightDirection;
+        this->invalidateCascades();
+    }
+
+    glm::vec3 lightUp = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    this->cascadeLightView = glm::lookAt(glm::vec3(0.0f), lightDirection, lightUp);
+
+    glm::mat4 viewToLight = this->cascadeLightView * glm::inverse(view);
+    GLfloat tanHalfFov = std::tan(fov * 0.5f);
+    GLfloat splitNear = zNear;
+
+    for (GLuint i = 0; i < this->cascadeCount; ++i)
+    {
+        GLfloat splitRatio = GLfloat(i + 1) / this->cascadeCount;
+        GLfloat splitLog = zNear * std::pow(shadowDistance / zNear, splitRatio);
+        GLfloat splitUniform = zNear + (shadowDistance - zNear) * splitRatio;
+        GLfloat splitFar = splitLambda * splitLog + (1.0f - splitLambda) * splitUniform;
+
+        // View-space bounding sphere of the slice
+        glm::vec3 sliceCorners[8];
+        glm::vec3 sliceCenter = glm::vec3(0.0f);
+
+        for (GLuint corner = 0; corner < 8; ++corner)
+        {
+            GLfloat depth = (corner & 4) ? splitFar : splitNear;
+            GLfloat halfHeight = depth * tanHalfFov;
+            GLfloat halfWidth = halfHeight * aspect;
+
+            sliceCorners[corner] = glm::vec3((corner & 1) ? halfWidth : -halfWidth, (corner & 2) ? halfHeight : -halfHeight, -depth);
+            sliceCenter += sliceCorners[corner] / 8.0f;
+        }
+
+        GLfloat sliceRadius = 0.0f;
+
+        for (GLuint corner = 0; corner < 8; ++corner)
+            sliceRadius = std::max(sliceRadius, glm::length(sliceCorners[corner] - sliceCenter));
+
+        bool cascadeCached = i >= this->cascadeFirstCached;
+        GLfloat radius = std::ceil(sliceRadius * (cascadeCached ? shadowCachedSlack : 1.0f) * 16.0f) / 16.0f;
+        glm::vec3 lightCenter = glm::vec3(viewToLight * glm::vec4(sliceCenter, 1.0f));
+
+        GLfloat texelSize = 2.0f * radius / this->cascadeResolution;
+        lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+        lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+        this->cascadeSplit[i] = splitFar;
+        splitNear = splitFar;
+
+        // A cached cascade keeps its previous fit for as long as it still encloses the whole slice
+        if (cascadeCached && !this->cascadeDirty[i])
+        {
+            glm::vec3 centerOffset = glm::abs(lightCenter - this->cascadeCenter[i]);
+
+            if (std::max(centerOffset.x, std::max(centerOffset.y, centerOffset.z)) + sliceRadius <= this->cascadeRadius[i])
+                continue;
+        }
+
+        if (lightCenter != this->cascadeCenter[i] || radius != this->cascadeRadius[i])
+        {
+            this->cascadeCenter[i] = lightCenter;
+            this->cascadeRadius[i] = radius;
+            this->cascadeDirty[i] = true;
+        }
+
+        glm::mat4 lightProjection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius, lightCenter.y + radius,
+                                               -lightCenter.z - radius - shadowCasterDistance, -lightCenter.z + radius);
+
+        this->cascadeViewProj[i] = lightProjection * this->cascadeLightView;
+    }
+}
+
+
+void CascadedShadow::invalidateCascades()
+{
+    for (GLuint i = 0; i < cascadeMax; ++i)
+        this->cascadeDirty[i] = true;
+}
+
+
+// Marks the cascades whose volume overlaps a world-space sphere, typically the old and new bounds of a moving object
+void CascadedShadow::invalidateBounds(glm::vec3 center, GLfloat radius)
+{
+    glm::vec3 lightCenter = glm::vec3(this->cascadeLightView * glm::vec4(center, 1.0f));
+
+    for (GLuint i = 0; i < this->cascadeCount; ++i)
+    {
+        glm::vec3 cascadeCenter = this->cascadeCenter[i];
+        GLfloat cascadeExtent = this->cascadeRadius[i] + radius;
+
+        bool cascadeOverlap = std::abs(lightCenter.x - cascadeCenter.x) <= cascadeExtent && std::abs(lightCenter.y - cascadeCenter.y) <= cascadeExtent
+                              && lightCenter.z + radius >= cascadeCenter.z - this->cascadeRadius[i]
+                              && lightCenter.z - radius <= cascadeCenter.z + this->cascadeRadius[i] + shadowCasterDistance;
+
+        if (cascadeOverlap)
+            this->cascadeDirty[i] = true;
+    }
+}
+
+
+// Returns false, and leaves the atlas untouched, when the cached cascade content is still valid
+bool CascadedShadow::beginCascade(GLuint cascade)
+{
+    this->cascadeUpdated[cascade] = false;
+
+    if (!this->cascadeDirty[cascade])
+        return false;
+
+    GLint cellX = (cascade & 1) * this->cascadeResolution;
+    GLint cellY = (cascade >> 1) * this->cascadeResolution;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->shadowFBO);
+    glViewport(cellX, cellY, this->cascadeResolution, this->cascadeResolution);
+    glScissor(cellX, cellY, this->cascadeResolution, this->cascadeResolution);
+    glEnable(GL_SCISSOR_TEST);
+    glClear(GL_DEPTH_BUFFER_BIT);
+
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    return true;
+}
+
+
+void CascadedShadow::endCascade(GLuint cascade)
+{
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    this->cascadeDirty[cascade] = false;
+    this->cascadeUpdated[cascade] = true;
+}
+
+
+void CascadedShadow::useShadowMap()
+{
+    glBindTexture(GL_TEXTURE_2D, this->shadowAtlas);
+}
+
+
+// The lighting pass works in view-space, so the matrices go straight from view-space to the atlas cell of each cascade
+void CascadedShadow::renderToShader(Shader& shader, const glm::mat4& view)
+{
+    shader.useShader();
+
+    glm::mat4 inverseView = glm::inverse(view);
+    GLfloat cascadeSplits[cascadeMax];
+
+    for (GLuint i = 0; i < cascadeMax; ++i)
+    {
+        GLuint cascade = std::min(i, this->cascadeCount - 1);
+
+        glm::mat4 atlasMatrix;
+        atlasMatrix = glm::translate(atlasMatrix, glm::vec3((cascade & 1) * 0.5f, (cascade >> 1) * 0.5f, 0.0f));
+        atlasMatrix = glm::scale(atlasMatrix, glm::vec3(0.5f, 0.5f, 1.0f));
+        atlasMatrix = glm::translate(atlasMatrix, glm::vec3(0.5f));
+        atlasMatrix = glm::scale(atlasMatrix, glm::vec3(0.5f));
+
+        glm::mat4 shadowMatrix = atlasMatrix * this->cascadeViewProj[cascade] * inverseView;
+        std::string shadowUniform = "shadowMatrices[" + std::to_string(i) + "]";
+
+        glUniformMatrix4fv(glGetUniformLocation(shader.Program, shadowUniform.c_str()), 1, GL_FALSE, glm::value_ptr(shadowMatrix));
+        cascadeSplits[i] = this->cascadeSplit[cascade];
+    }
+
+    glUniform4f(glGetUniformLocation(shader.Program, "shadowSplits"), cascadeSplits[0], cascadeSplits[1], cascadeSplits[2], cascadeSplits[3]);
+    glUniform1i(glGetUniformLocation(shader.Program, "shadowCascadeCount"), this->cascadeCount);
+    glUniform1f(glGetUniformLocation(shader.Program, "shadowTexelSize"), 1.0f / (2 * this->cascadeResolution));
+}
+
+
+glm::mat4 CascadedShadow::getCascadeMatrix(GLuint cascade)
+{
+    return this->cascadeViewProj[cascade];
+}
+
+
+GLfloat CascadedShadow::getCascadeSplit(GLuint cascade)
+{
+    return this->cascadeSplit[cascade];
+}
+
+
+bool CascadedShadow::isCascadeUpdated(GLuint cascade)
+{
+    return this->cascadeUpdated[cascade];
+}
+
+
+GLuint CascadedShadow::getCascadeCount()
+{
+    return this->cascadeCount;
+}
+
+
+GLuint CascadedShadow::getResolution()
+{
+    return this->cascadeResolution;
+}
+
+
+void CascadedShadow::setCascadeCount(GLuint count)
+{
+    count = std::max(1u, std::min(count, cascadeMax));
+
+    if (count != this->cascadeCount)
+    {
+        this->cascadeCount = count;
+        this->invalidateCascades();
+    }
+}
+
+
+void CascadedShadow::setCachedCascades(GLuint firstCached)
+{
+    this->cascadeFirstCached = firstCached;
+}
@@ -0,0 +1,60 @@
+#ifndef CASCADEDSHADOW_H
+#define CASCADEDSHADOW_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "shader.h"
+
+
+// Cascaded shadow maps of a directional light, all the cascades live in a single 2x2 depth atlas.
+// A cascade is only re-rendered when its fitted projection changes, or when something it covers has been invalidated
+class CascadedShadow
+{
+    public:
+        static const GLuint cascadeMax = 4;
+
+        CascadedShadow();
+        ~CascadedShadow();
+        void setShadowMap(GLuint resolution);
+        void updateCascades(const glm::mat4& view, GLfloat fov, GLfloat aspect, GLfloat zNear, GLfloat shadowDistance, GLfloat splitLambda, glm::vec3 lightDirection);
+        void invalidateCascades();
+        void invalidateBounds(glm::vec3 center, GLfloat radius);
+        bool beginCascade(GLuint cascade);
+        void endCascade(GLuint cascade);
+        void useShadowMap();
+        void renderToShader(Shader& shader, const glm::mat4& view);
+        glm::mat4 getCascadeMatrix(GLuint cascade);
+        GLfloat getCascadeSplit(GLuint cascade);
+        bool isCascadeUpdated(GLuint cascade);
+        GLuint getCascadeCount();
+        GLuint getResolution();
+        void setCascadeCount(GLuint count);
+        void setCachedCascades(GLuint firstCached);
+
+    private:
+        GLuint shadowFBO = 0;
+        GLuint shadowAtlas = 0;
+        GLuint cascadeResolution = 0;
+        GLuint cascadeCount = cascadeMax;
+        GLuint cascadeFirstCached = 2;      // Cascades from this one on are fitted loosely so that they survive small camera moves
+        glm::vec3 cascadeLightDirection;
+
+        glm::mat4 cascadeLightView;
+        glm::mat4 cascadeViewProj[cascadeMax];
+        glm::vec3 cascadeCenter[cascadeMax];        // Light-space, snapped to the texel grid
+        GLfloat cascadeRadius[cascadeMax];
+        GLfloat cascadeSplit[cascadeMax];           // Far view distance of each cascade
+        bool cascadeDirty[cascadeMax];
+        bool cascadeUpdated[cascadeMax];
+};
+
+#endif
@@ -0,0 +1,464 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CLUSTERGRID_SSE
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "clustergrid.h"
+
+
+// Padding lights sit far behind the camera with a null radius, so they fail every depth and box test
+const float clusterPaddingDepth = 1e30f;
+
+
+static void clearCandidates(ClusterGrid::ClusterCandidates& candidates)
+{
+    candidates.x.clear();
+    candidates.y.clear();
+    candidates.z.clear();
+    candidates.radius.clear();
+    candidates.index.clear();
+}
+
+
+static void appendCandidate(ClusterGrid::ClusterCandidates& candidates, float x, float y, float z, float radius, unsigned int index)
+{
+    candidates.x.push_back(x);
+    candidates.y.push_back(y);
+    candidates.z.push_back(z);
+    candidates.radius.push_back(radius);
+    candidates.index.push_back(index);
+}
+
+
+// Pads the SoA arrays up to a multiple of 4 for the SIMD loop, returns the actual candidate count
+static unsigned int padCandidates(ClusterGrid::ClusterCandidates& candidates)
+{
+    unsigned int candidateCount = (unsigned int)candidates.index.size();
+
+    while (candidates.x.size() & 3)
+    {
+        candidates.x.push_back(0.0f);
+        candidates.y.push_back(0.0f);
+        candidates.z.push_back(clusterPaddingDepth);
+        candidates.radius.push_back(0.0f);
+    }
+
+    return candidateCount;
+}
+
+
+// Calls hitFunction with the index of every candidate sphere touching the box
+template <typename HitFunction>
+static void testSphereBox(const ClusterGrid::ClusterCandidates& candidates, unsigned int candidateCount, const float* boxMin, const float* boxMax, HitFunction hitFunction)
+{
+    unsigned int j = 0;
+
+#ifdef CLUSTERGRID_SSE
+    const unsigned int candidatePadded = (unsigned int)candidates.x.size();
+    const __m128 zeroV = _mm_setzero_ps();
+    const __m128 boxMinX = _mm_set1_ps(boxMin[0]), boxMaxX = _mm_set1_ps(boxMax[0]);
+    const __m128 boxMinY = _mm_set1_ps(boxMin[1]), boxMaxY = _mm_set1_ps(boxMax[1]);
+    const __m128 boxMinZ = _mm_set1_ps(boxMin[2]), boxMaxZ = _mm_set1_ps(boxMax[2]);
+
+    for (; j < candidatePadded; j += 4)
+    {
+        __m128 x = _mm_loadu_ps(&candidates.x[j]);
+        __m128 y = _mm_loadu_ps(&candidates.y[j]);
+        __m128 z = _mm_loadu_ps(&candidates.z[j]);
+        __m128 radius = _mm_loadu_ps(&candidates.radius[j]);
+
+        // Distance from the sphere center to the box, per axis
+        __m128 dx = _mm_add_ps(_mm_max_ps(zeroV, _mm_sub_ps(boxMinX, x)), _mm_max_ps(zeroV, _mm_sub_ps(x, boxMaxX)));
+        __m128 dy = _mm_add_ps(_mm_max_ps(zeroV, _mm_sub_ps(boxMinY, y)), _mm_max_ps(zeroV, _mm_sub_ps(y, boxMaxY)));
+        __m128 dz = _mm_add_ps(_mm_max_ps(zeroV, _mm_sub_ps(boxMinZ, z)), _mm_max_ps(zeroV, _mm_sub_ps(z, boxMaxZ)));
+        __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        int hitMask = _mm_movemask_ps(_mm_cmple_ps(distance2, _mm_mul_ps(radius, radius)));
+
+        for (unsigned int k = 0; hitMask && k < 4; ++k)
+        {
+            if (hitMask & (1 << k))
+                hitFunction(j + k);
+        }
+    }
+#endif
+
+    for (; j < candidateCount; ++j)
+    {
+        float dx = std::max(0.0f, boxMin[0] - candidates.x[j]) + std::max(0.0f, candidates.x[j] - boxMax[0]);
+        float dy = std::max(0.0f, boxMin[1] - candidates.y[j]) + std::max(0.0f, candidates.y[j] - boxMax[1]);
+        float dz = std::max(0.0f, boxMin[2] - candidates.z[j]) + std::max(0.0f, candidates.z[j] - boxMax[2]);
+
+        if (dx * dx + dy * dy + dz * dz <= candidates.radius[j] * candidates.radius[j])
+            hitFunction(j);
+    }
+}
+
+
+ClusterGrid::ClusterGrid()
+{
+
+}
+
+
+ClusterGrid::~ClusterGrid()
+{
+
+}
+
+
+void ClusterGrid::setGrid(unsigned int tilesX, unsigned int tilesY, unsigned int slices)
+{
+    this->gridTilesX = std::max(tilesX, 1u);
+    this->gridTilesY = std::max(tilesY, 1u);
+    this->gridSlices = std::max(slices, 1u);
+
+    if (this->frustumReady)
+        this->computeClusters();
+}
+
+
+// The cluster boxes only depend on the projection, they are rebuilt when it actually changes
+void ClusterGrid::setFrustum(const glm::mat4& projection, float zNear, float zFar)
+{
+    if (this->frustumReady && projection == this->frustumProjection && zNear == this->frustumNear && zFar == this->frustumFar)
+        return;
+
+    this->frustumProjection = projection;
+    this->frustumNear = zNear;
+    this->frustumFar = zFar;
+    this->frustumReady = true;
+
+    this->computeClusters();
+}
+
+
+void ClusterGrid::computeClusters()
+{
+    const unsigned int tileCount = this->gridTilesX * this->gridTilesY;
+    const unsigned int clusterCount = this->getClusterCount();
+
+    this->clusterMinX.resize(clusterCount);
+    this->clusterMinY.resize(clusterCount);
+    this->clusterMinZ.resize(clusterCount);
+    this->clusterMaxX.resize(clusterCount);
+    this->clusterMaxY.resize(clusterCount);
+    this->clusterMaxZ.resize(clusterCount);
+    this->rowMin.assign(3 * this->gridSlices * this->gridTilesY, clusterPaddingDepth);
+    this->rowMax.assign(3 * this->gridSlices * this->gridTilesY, -clusterPaddingDepth);
+    this->sliceNear.resize(this->gridSlices);
+    this->sliceFar.resize(this->gridSlices);
+    this->sliceIndices.resize(this->gridSlices);
+    this->sliceCounts.resize(this->gridSlices);
+
+    // Exponential slicing, matching the slice lookup done in the shaders : slice = log(depth / near) * slices / log(far / near)
+    for (unsigned int slice = 0; slice < this->gridSlices; ++slice)
+    {
+        this->sliceNear[slice] = this->frustumNear * std::pow(this->frustumFar / this->frustumNear, float(slice) / this->gridSlices);
+        this->sliceFar[slice] = this->frustumNear * std::pow(this->frustumFar / this->frustumNear, float(slice + 1) / this->gridSlices);
+        this->sliceCounts[slice].resize(tileCount);
+    }
+
+    glm::mat4 inverseProj = glm::inverse(this->frustumProjection);
+
+    for (unsigned int tileY = 0; tileY < this->gridTilesY; ++tileY)
+    {
+        for (unsigned int tileX = 0; tileX < this->gridTilesX; ++tileX)
+        {
+            // Rays through the tile corners, scaled so that they reach a view depth of 1
+            glm::vec3 cornerRays[4];
+
+            for (unsigned int corner = 0; corner < 4; ++corner)
+            {
+                float ndcX = -1.0f + 2.0f * float(tileX + (corner & 1)) / this->gridTilesX;
+                float ndcY = -1.0f + 2.0f * float(tileY + (corner >> 1)) / this->gridTilesY;
+                glm::vec4 farCorner = inverseProj * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+                glm::vec3 cornerPosition = glm::vec3(farCorner) / farCorner.w;
+
+                cornerRays[corner] = cornerPosition / -cornerPosition.z;
+            }
+
+            for (unsigned int slice = 0; slice < this->gridSlices; ++slice)
+            {
+                glm::vec3 boxMin = glm::vec3(clusterPaddingDepth);
+                glm::vec3 boxMax = glm::vec3(-clusterPaddingDepth);
+
+                for (unsigned int corner = 0; corner < 4; ++corner)
+                {
+                    boxMin = glm::min(boxMin, glm::min(cornerRays[corner] * this->sliceNear[slice], cornerRays[corner] * this->sliceFar[slice]));
+                    boxMax = glm::max(boxMax, glm::max(cornerRays[corner] * this->sliceNear[slice], cornerRays[corner] * this->sliceFar[slice]));
+                }
+
+                unsigned int cluster = slice * tileCount + tileY * this->gridTilesX + tileX;
+
+                this->clusterMinX[cluster] = boxMin.x;
+                this->clusterMinY[cluster] = boxMin.y;
+                this->clusterMinZ[cluster] = boxMin.z;
+                this->clusterMaxX[cluster] = boxMax.x;
+                this->clusterMaxY[cluster] = boxMax.y;
+                this->clusterMaxZ[cluster] = boxMax.z;
+
+                unsigned int row = slice * this->gridTilesY + tileY;
+
+                for (unsigned int axis = 0; axis < 3; ++axis)
+                {
+                    this->rowMin[3 * row + axis] = std::min(this->rowMin[3 * row + axis], boxMin[axis]);
+                    this->rowMax[3 * row + axis] = std::max(this->rowMax[3 * row + axis], boxMax[axis]);
+                }
+            }
+        }
+    }
+}
+
+
+// Lights are read with a stride, the first 4 floats of each being its view-space position and radius
+void ClusterGrid::binLights(const float* lightPositionRadius, unsigned int lightStride, unsigned int lightCount, unsigned int threadCount)
+{
+    std::chrono::high_resolution_clock::time_point binningStart = std::chrono::high_resolution_clock::now();
+
+    const unsigned int tileCount = this->gridTilesX * this->gridTilesY;
+    const unsigned int lightPadded = (lightCount + 3) & ~3u;
+
+    this->clusterOffsetCount.assign(this->getClusterCount() * 2, 0);
+    this->clusterLightIndices.clear();
+
+    if (!this->frustumReady)
+        return;
+
+    this->lightX.resize(lightPadded);
+    this->lightY.resize(lightPadded);
+    this->lightZ.resize(lightPadded);
+    this->lightRadius.resize(lightPadded);
+
+    for (unsigned int i = 0; i < lightCount; ++i)
+    {
+        const float* lightData = lightPositionRadius + i * lightStride;
+
+        this->lightX[i] = lightData[0];
+        this->lightY[i] = lightData[1];
+        this->lightZ[i] = lightData[2];
+        this->lightRadius[i] = lightData[3];
+    }
+
+    for (unsigned int i = lightCount; i < lightPadded; ++i)
+    {
+        this->lightX[i] = 0.0f;
+        this->lightY[i] = 0.0f;
+        this->lightZ[i] = clusterPaddingDepth;
+        this->lightRadius[i] = 0.0f;
+    }
+
+    // Slices are handed out dynamically, the near ones being much thinner than the far ones
+    if (!threadCount)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    threadCount = std::min(threadCount, this->gridSlices);
+
+    std::atomic<unsigned int> nextSlice(0);
+
+    auto binWorker = [this, &nextSlice, lightPadded]()
+    {
+        ClusterCandidates candidates, rowCandidates;
+
+        for (unsigned int slice = nextSlice++; slice < this->gridSlices; slice = nextSlice++)
+            this->binSlice(slice, lightPadded, candidates, rowCandidates);
+    };
+
+    std::vector<std::thread> binThreads;
+
+    for (unsigned int i = 1; i < threadCount; ++i)
+        binThreads.push_back(std::thread(binWorker));
+
+    binWorker();
+
+    for (std::thread& binThread : binThreads)
+        binThread.join();
+
+    // Merge of the per-slice lists into a single compact index list
+    size_t indexTotal = 0;
+
+    for (unsigned int slice = 0; slice < this->gridSlices; ++slice)
+        indexTotal += this->sliceIndices[slice].size();
+
+    this->clusterLightIndices.reserve(indexTotal);
+
+    for (unsigned int slice = 0; slice < this->gridSlices; ++slice)
+    {
+        unsigned int clusterOffset = (unsigned int)this->clusterLightIndices.size();
+
+        for (unsigned int tile = 0; tile < tileCount; ++tile)
+        {
+            unsigned int cluster = slice * tileCount + tile;
+
+            this->clusterOffsetCount[2 * cluster] = clusterOffset;
+            this->clusterOffsetCount[2 * cluster + 1] = this->sliceCounts[slice][tile];
+            clusterOffset += this->sliceCounts[slice][tile];
+        }
+
+        this->clusterLightIndices.insert(this->clusterLightIndices.end(), this->sliceIndices[slice].begin(), this->sliceIndices[slice].end());
+    }
+
+    this->binningTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - binningStart).count();
+    this->binningThreads = threadCount;
+}
+
+
+void ClusterGrid::binSlice(unsigned int slice, unsigned int lightCount, ClusterCandidates& candidates, ClusterCandidates& rowCandidates)
+{
+    const unsigned int tileCount = this->gridTilesX * this->gridTilesY;
+    const float depthNear = this->sliceNear[slice];
+    const float depthFar = this->sliceFar[slice];
+
+    std::vector<unsigned int>& indices = this->sliceIndices[slice];
+    std::vector<unsigned int>& counts = this->sliceCounts[slice];
+
+    indices.clear();
+    clearCandidates(candidates);
+
+    // 1. Depth rejection, keeping the lights whose [depth - radius, depth + radius] range overlaps the slice
+    unsigned int i = 0;
+
+#ifdef CLUSTERGRID_SSE
+    const __m128 sliceNearV = _mm_set1_ps(depthNear);
+    const __m128 sliceFarV = _mm_set1_ps(depthFar);
+    const __m128 zeroV = _mm_setzero_ps();
+
+    for (; i + 4 <= lightCount; i += 4)
+    {
+        __m128 depth = _mm_sub_ps(zeroV, _mm_loadu_ps(&this->lightZ[i]));
+        __m128 radius = _mm_loadu_ps(&this->lightRadius[i]);
+        int overlapMask = _mm_movemask_ps(_mm_and_ps(_mm_cmpge_ps(_mm_add_ps(depth, radius), sliceNearV), _mm_cmple_ps(_mm_sub_ps(depth, radius), sliceFarV)));
+
+        for (unsigned int k = 0; overlapMask && k < 4; ++k)
+        {
+            if (overlapMask & (1 << k))
+                appendCandidate(candidates, this->lightX[i + k], this->lightY[i + k], this->lightZ[i + k], this->lightRadius[i + k], i + k);
+        }
+    }
+#endif
+
+    for (; i < lightCount; ++i)
+    {
+        float depth = -this->lightZ[i];
+
+        if (depth + this->lightRadius[i] >= depthNear && depth - this->lightRadius[i] <= depthFar)
+            appendCandidate(candidates, this->lightX[i], this->lightY[i], this->lightZ[i], this->lightRadius[i], i);
+    }
+
+    unsigned int candidateCount = padCandidates(candidates);
+
+    // 2. Sphere vs AABB, first against the box of a whole tile row, then against each cluster of the row with the survivors only.
+    //    One cluster is tested against 4 lights at a time so that each cluster list is written in order
+    for (unsigned int tileY = 0; tileY < this->gridTilesY; ++tileY)
+    {
+        unsigned int row = slice * this->gridTilesY + tileY;
+
+        clearCandidates(rowCandidates);
+
+        testSphereBox(candidates, candidateCount, &this->rowMin[3 * row], &this->rowMax[3 * row], [&](unsigned int j)
+        {
+            appendCandidate(rowCandidates, candidates.x[j], candidates.y[j], candidates.z[j], candidates.radius[j], candidates.index[j]);
+        });
+
+        unsigned int rowCandidateCount = padCandidates(rowCandidates);
+
+        for (unsigned int tileX = 0; tileX < this->gridTilesX; ++tileX)
+        {
+            unsigned int tile = tileY * this->gridTilesX + tileX;
+            unsigned int cluster = slice * tileCount + tile;
+            size_t clusterStart = indices.size();
+
+            float boxMin[3] = { this->clusterMinX[cluster], this->clusterMinY[cluster], this->clusterMinZ[cluster] };
+            float boxMax[3] = { this->clusterMaxX[cluster], this->clusterMaxY[cluster], this->clusterMaxZ[cluster] };
+
+            testSphereBox(rowCandidates, rowCandidateCount, boxMin, boxMax, [&](unsigned int j)
+            {
+                indices.push_back(rowCandidates.index[j]);
+            });
+
+            counts[tile] = (unsigned int)(indices.size() - clusterStart);
+        }
+    }
+}
+
+
+unsigned int ClusterGrid::getClusterCount()
+{
+    return this->gridTilesX * this->gridTilesY * this->gridSlices;
+}
+
+
+// View-space AABB of a cluster, as tested by the binning (reference checks of ClusterBench)
+void ClusterGrid::getClusterBounds(unsigned int cluster, float* boxMin, float* boxMax)
+{
+    boxMin[0] = this->clusterMinX[cluster];
+    boxMin[1] = this->clusterMinY[cluster];
+    boxMin[2] = this->clusterMinZ[cluster];
+    boxMax[0] = this->clusterMaxX[cluster];
+    boxMax[1] = this->clusterMaxY[cluster];
+    boxMax[2] = this->clusterMaxZ[cluster];
+}
+
+
+// View depths bounding a slice, as built by computeClusters (slice checks of ClusterBench)
+void ClusterGrid::getSliceBounds(unsigned int slice, float* depthNear, float* depthFar)
+{
+    *depthNear = this->sliceNear[slice];
+    *depthFar = this->sliceFar[slice];
+}
+
+
+unsigned int ClusterGrid::getTilesX()
+{
+    return this->gridTilesX;
+}
+
+
+unsigned int ClusterGrid::getTilesY()
+{
+    return this->gridTilesY;
+}
+
+
+unsigned int ClusterGrid::getSlices()
+{
+    return this->gridSlices;
+}
+
+
+float ClusterGrid::getZNear()
+{
+    return this->frustumNear;
+}
+
+
+float ClusterGrid::getZFar()
+{
+    return this->frustumFar;
+}
+
+
+float ClusterGrid::getBinningTime()
+{
+    return this->binningTime;
+}
+
+
+unsigned int ClusterGrid::getBinningThreads()
+{
+    return this->binningThreads;
+}
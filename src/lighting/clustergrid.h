@@ -0,0 +1,76 @@
+#ifndef CLUSTERGRID_H
+#define CLUSTERGRID_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+
+// View frustum sliced in tilesX * tilesY screen tiles and exponentially distributed depth slices (froxels),
+// point lights are binned into the froxels on the CPU. Deliberately free of any GL call,
+// so the binning can be driven and timed from plain arrays without a context
+class ClusterGrid
+{
+    public:
+        // Binning output, ready to be uploaded as-is :
+        // an (offset, count) pair per cluster into the compact light index list
+        std::vector<unsigned int> clusterOffsetCount;
+        std::vector<unsigned int> clusterLightIndices;
+
+        ClusterGrid();
+        ~ClusterGrid();
+        void setGrid(unsigned int tilesX, unsigned int tilesY, unsigned int slices);
+        void setFrustum(const glm::mat4& projection, float zNear, float zFar);
+        void binLights(const float* lightPositionRadius, unsigned int lightStride, unsigned int lightCount, unsigned int threadCount = 0);
+        unsigned int getClusterCount();
+        void getClusterBounds(unsigned int cluster, float* boxMin, float* boxMax);
+        void getSliceBounds(unsigned int slice, float* depthNear, float* depthFar);
+        unsigned int getTilesX();
+        unsigned int getTilesY();
+        unsigned int getSlices();
+        float getZNear();
+        float getZFar();
+        float getBinningTime();
+        unsigned int getBinningThreads();
+
+        // Lights overlapping the depth range of a slice, SoA and padded to a multiple of 4
+        struct ClusterCandidates
+        {
+            std::vector<float> x, y, z, radius;
+            std::vector<unsigned int> index;
+        };
+
+    private:
+        unsigned int gridTilesX = 16;
+        unsigned int gridTilesY = 9;
+        unsigned int gridSlices = 24;
+        float frustumNear = 0.0f;
+        float frustumFar = 0.0f;
+        glm::mat4 frustumProjection;
+        bool frustumReady = false;
+        float binningTime = 0.0f;
+        unsigned int binningThreads = 0;
+
+        // Cluster view-space AABBs, slice-major, plus the union of each tile row (xyz interleaved)
+        std::vector<float> clusterMinX, clusterMinY, clusterMinZ, clusterMaxX, clusterMaxY, clusterMaxZ;
+        std::vector<float> rowMin, rowMax;
+        std::vector<float> sliceNear, sliceFar;
+
+        // Lights transposed to SoA and padded to a multiple of 4
+        std::vector<float> lightX, lightY, lightZ, lightRadius;
+
+        // Per-slice results, filled by whichever worker grabbed the slice, merged in slice order afterwards
+        std::vector<std::vector<unsigned int>> sliceIndices;
+        std::vector<std::vector<unsigned int>> sliceCounts;
+
+        void computeClusters();
+        void binSlice(unsigned int slice, unsigned int lightCount, ClusterCandidates& candidates, ClusterCandidates& rowCandidates);
+};
+
+#endif
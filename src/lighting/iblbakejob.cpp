@@ -0,0 +1,545 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <utility>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "stb_image.h"
+#include "iblbakejob.h"
+#include "profiler.h"
+
+
+// Rows of the latlong map uploaded per step
+const GLuint bakeHDRBandRows = 64;
+
+// Same face projection and orientations as envMapProjection/envMapView in iblSetup()
+const glm::mat4 bakeFaceProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+const glm::mat4 bakeFaceView[6] =
+{
+    glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
+    glm::lookAt(glm::vec3(0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
+    glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
+    glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
+    glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
+    glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f))
+};
+
+
+IBLBakeJob::IBLBakeJob() : decodeDone(false)
+{
+    std::fill(this->stepCost, this->stepCost + BAKE_STEP_TYPE_COUNT, -1.0f);
+    std::fill(this->queryPending, this->queryPending + queryCount, false);
+}
+
+
+IBLBakeJob::~IBLBakeJob()
+{
+    if (this->decodeThread.joinable())
+        this->decodeThread.join();
+
+    if (this->writeThread.joinable())
+        this->writeThread.join();
+}
+
+
+// The pending set mirrors the formats of the bound environment textures created in main()
+void IBLBakeJob::setTargets(GLuint cubeSize, GLuint prefilterSize, GLuint prefilterMips, GLuint sampleCount)
+{
+    this->cubeSize = cubeSize;
+    this->prefilterSize = prefilterSize;
+    this->prefilterMips = prefilterMips;
+    this->sampleCount = sampleCount;
+
+    this->pendingCube.setTextureCube(cubeSize, GL_RGB, GL_RGB16F, GL_FLOAT, GL_LINEAR_MIPMAP_LINEAR);
+    this->pendingPrefilter.setTextureCube(prefilterSize, GL_RGB, GL_RGB16F, GL_FLOAT, GL_LINEAR_MIPMAP_LINEAR);
+    this->pendingPrefilter.computeTexMipmap();
+
+    this->pendingHDR.texType = GL_TEXTURE_2D;
+    glGenTextures(1, &this->pendingHDR.texID);
+
+    glGenFramebuffers(1, &this->bakeFBO);
+    glGenQueries(queryCount, this->stepQueries);
+
+    GLsizeiptr readbackSize = (IBLFile::computeTexelCount(cubeSize, 1, 6, 3) + IBLFile::computeTexelCount(prefilterSize, prefilterMips, 6, 3)) * sizeof(GLushort);
+
+    glGenBuffers(1, &this->readbackPBO);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, this->readbackPBO);
+    glBufferData(GL_PIXEL_PACK_BUFFER, readbackSize, NULL, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+
+// Only the latest request is kept, it is started as soon as the decoding worker is free
+void IBLBakeJob::requestEnvironment(const std::string& hdrPath, const std::string& hdrName)
+{
+    this->requestedPath = hdrPath;
+    this->requestedName = hdrName;
+    this->requestPending = true;
+}
+
+
+// Returns true on the frame the new environment gets bound. Runs at least one step per frame so that the bake always progresses,
+// then keeps going while the estimated GPU time of the next step fits in the budget (in ms)
+bool IBLBakeJob::updateJob(GLfloat frameBudget, Shader& latlongToCubeShader, Shader& prefilterShader, Shape& cubeShape, IBLCache& iblCache,
+                           Texture& envMapHDR, Texture& envMapCube, Texture& envMapPrefilter, IrradianceSH& irradianceSH)
+{
+    this->frameSteps = 0;
+    this->frameEstimate = 0.0f;
+
+    this->pollQueries();
+    this->pollReadback();
+
+    if (this->decodeRunning)
+    {
+        if (!this->decodeDone)
+            return false;
+
+        this->decodeThread.join();
+        this->decodeRunning = false;
+
+        if (this->hdrTexels.empty())
+            std::cerr << "HDR TEXTURE - FAILED LOADING : " << this->bakePath << std::endl;
+        else if (!this->requestPending)
+            this->buildSteps();
+    }
+
+    // A newer request drops the bake in progress, the bound environment simply stays in place
+    if (this->requestPending)
+    {
+        this->requestPending = false;
+        this->bakeSteps.clear();
+        this->bakeStepIndex = 0;
+
+        this->bakePath = this->requestedPath;
+        this->bakeName = this->requestedName;
+        this->decodeDone = false;
+        this->decodeRunning = true;
+        this->decodeThread = std::thread(&IBLBakeJob::decodeEnvironment, this, this->bakePath, &iblCache);
+
+        return false;
+    }
+
+    if (this->bakeStepIndex >= this->bakeSteps.size())
+        return false;
+
+    while (this->bakeStepIndex < this->bakeSteps.size())
+    {
+        const IBLBakeStep& step = this->bakeSteps[this->bakeStepIndex];
+        GLfloat stepEstimate = this->estimateStep(step, frameBudget);
+
+        if (this->frameSteps > 0 && this->frameEstimate + stepEstimate > frameBudget)
+            break;
+
+        // The readback buffer is still in use by the previous write-back
+        if (step.stepType == BAKE_READBACK && this->writePending)
+            break;
+
+        this->runStep(step, latlongToCubeShader, prefilterShader, cubeShape);
+
+        this->frameEstimate += stepEstimate;
+        this->frameSteps++;
+        this->bakeStepIndex++;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (this->bakeStepIndex < this->bakeSteps.size())
+        return false;
+
+    // Complete set : swapped with the bound one, whose textures are reused by the next switch
+    this->swapTextures(envMapHDR, this->pendingHDR);
+    this->swapTextures(envMapCube, this->pendingCube);
+    this->swapTextures(envMapPrefilter, this->pendingPrefilter);
+    irradianceSH.setCoefficients(this->pendingSH.getCoefficients());
+
+    this->bakeSteps.clear();
+    this->bakeStepIndex = 0;
+    std::vector<GLfloat>().swap(this->hdrTexels);
+    std::vector<GLushort>().swap(this->cubeTexels);
+    std::vector<GLushort>().swap(this->prefilterTexels);
+
+    return true;
+}
+
+
+bool IBLBakeJob::isBusy()
+{
+    return this->decodeRunning || this->requestPending || this->bakeStepIndex < this->bakeSteps.size();
+}
+
+
+GLfloat IBLBakeJob::getProgress()
+{
+    if (this->bakeSteps.empty())
+        return this->isBusy() ? 0.0f : 1.0f;
+
+    return GLfloat(this->bakeStepIndex) / GLfloat(this->bakeSteps.size());
+}
+
+
+GLuint IBLBakeJob::getFrameSteps()
+{
+    return this->frameSteps;
+}
+
+
+GLfloat IBLBakeJob::getFrameEstimate()
+{
+    return this->frameEstimate;
+}
+
+
+std::string IBLBakeJob::getEnvironmentName()
+{
+    return this->bakeName;
+}
+
+
+// Worker thread : cache lookup, HDR decoding and SH projection, nothing touching GL
+void IBLBakeJob::decodeEnvironment(std::string hdrPath, IBLCache* iblCache)
+{
+    Profiler::setThreadName("IBL Decode");
+    ProfilerScope decodeScope("Decode Environment");
+
+    std::string cacheKey = IBLFile::computeKey(hdrPath, this->cubeSize, this->prefilterSize, this->prefilterMips, this->sampleCount);
+    GLfloat shCoefficients[IBLFile::shFloatCount];
+
+    this->bakeCachePath = cacheKey.empty() ? std::string() : iblCache->getCachePath(cacheKey);
+    this->cacheHit = !cacheKey.empty() && IBLFile::readEnvironment(this->bakeCachePath, this->cubeSize, this->prefilterSize, this->prefilterMips, 3,
+                                                                   this->cubeTexels, shCoefficients, this->prefilterTexels);
+
+    // Every texture of the engine is loaded flipped, so setting the shared stb flag from this thread cannot change what the others read
+    int width, height, numComponents;
+    stbi_set_flip_vertically_on_load(true);
+    GLfloat* texData = stbi_loadf(hdrPath.c_str(), &width, &height, &numComponents, 0);
+
+    this->hdrTexels.clear();
+
+    if (texData && numComponents >= 3)
+    {
+        this->hdrTexels.assign(texData, texData + size_t(width) * height * numComponents);
+        this->hdrWidth = width;
+        this->hdrHeight = height;
+        this->hdrComponents = numComponents;
+
+        if (this->cacheHit)
+            this->pendingSH.setCoefficients(shCoefficients);
+        else
+            this->pendingSH.computeCoefficients(this->hdrTexels.data(), width, height, numComponents);
+    }
+
+    stbi_image_free(texData);
+
+    this->decodeDone = true;
+}
+
+
+// The latlong map is always uploaded (it is also the background of the lighting pass), then either the cached textures
+// are uploaded or the cube and prefilter passes run, followed by the cache readback
+void IBLBakeJob::buildSteps()
+{
+    this->bakeSteps.clear();
+    this->bakeStepIndex = 0;
+
+    for (GLuint band = 0; band * bakeHDRBandRows < this->hdrHeight; ++band)
+    {
+        GLuint bandRows = std::min(bakeHDRBandRows, this->hdrHeight - band * bakeHDRBandRows);
+        this->bakeSteps.push_back({ BAKE_UPLOAD_HDR, 0, band, GLuint(bandRows * this->hdrWidth * this->hdrComponents * sizeof(GLfloat)) });
+    }
+
+    if (this->cacheHit)
+    {
+        for (GLuint face = 0; face < 6; ++face)
+            this->bakeSteps.push_back({ BAKE_UPLOAD_CUBE_FACE, face, 0, GLuint(this->cubeSize * this->cubeSize * 3 * sizeof(GLushort)) });
+
+        this->bakeSteps.push_back({ BAKE_CUBE_MIPMAP, 0, 0, this->cubeSize * this->cubeSize });
+
+        for (GLuint mip = 0; mip < this->prefilterMips; ++mip)
+            this->bakeSteps.push_back({ BAKE_UPLOAD_PREFILTER_MIP, 0, mip, GLuint(IBLFile::computeTexelCount(this->prefilterSize >> mip, 1, 6, 3) * sizeof(GLushort)) });
+    }
+
+    else
+    {
+        for (GLuint face = 0; face < 6; ++face)
+            this->bakeSteps.push_back({ BAKE_CUBE_FACE, face, 0, this->cubeSize * this->cubeSize });
+
+        this->bakeSteps.push_back({ BAKE_CUBE_MIPMAP, 0, 0, this->cubeSize * this->cubeSize });
+
+        for (GLuint mip = 0; mip < this->prefilterMips; ++mip)
+        {
+            for (GLuint face = 0; face < 6; ++face)
+                this->bakeSteps.push_back({ BAKE_PREFILTER_FACE, face, mip, (this->prefilterSize >> mip) * (this->prefilterSize >> mip) });
+        }
+
+        if (!this->bakeCachePath.empty())
+            this->bakeSteps.push_back({ BAKE_READBACK, 0, 0, GLuint(IBLFile::computeTexelCount(this->cubeSize, 1, 6, 3) * sizeof(GLushort)) });
+    }
+}
+
+
+void IBLBakeJob::runStep(const IBLBakeStep& step, Shader& latlongToCubeShader, Shader& prefilterShader, Shape& cubeShape)
+{
+    GLint query = -1;
+
+    for (GLuint i = 0; i < queryCount && query < 0; ++i)
+    {
+        if (!this->queryPending[i])
+            query = i;
+    }
+
+    if (query >= 0)
+    {
+        glBeginQuery(GL_TIME_ELAPSED, this->stepQueries[query]);
+        this->queryStep[query] = step;
+        this->queryPending[query] = true;
+    }
+
+    switch (step.stepType)
+    {
+        case BAKE_UPLOAD_HDR:
+        {
+            GLuint firstRow = step.stepMip * bakeHDRBandRows;
+            GLuint bandRows = std::min(bakeHDRBandRows, this->hdrHeight - firstRow);
+
+            glBindTexture(GL_TEXTURE_2D, this->pendingHDR.texID);
+
+            if (step.stepMip == 0)
+            {
+                this->pendingHDR.texWidth = this->hdrWidth;
+                this->pendingHDR.texHeight = this->hdrHeight;
+                this->pendingHDR.texComponents = this->hdrComponents;
+                this->pendingHDR.texInternalFormat = this->hdrComponents == 4 ? GL_RGBA32F : GL_RGB32F;
+                this->pendingHDR.texFormat = this->hdrComponents == 4 ? GL_RGBA : GL_RGB;
+                this->pendingHDR.texName = this->bakeName;
+                this->pendingHDR.texPath = this->bakePath;
+
+                glTexImage2D(GL_TEXTURE_2D, 0, this->pendingHDR.texInternalFormat, this->hdrWidth, this->hdrHeight, 0, this->pendingHDR.texFormat, GL_FLOAT, NULL);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            }
+
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, this->hdrWidth, bandRows, this->pendingHDR.texFormat, GL_FLOAT,
+                            this->hdrTexels.data() + size_t(firstRow) * this->hdrWidth * this->hdrComponents);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            break;
+        }
+
+        case BAKE_CUBE_FACE:
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, this->bakeFBO);
+            glViewport(0, 0, this->cubeSize, this->cubeSize);
+
+            latlongToCubeShader.useShader();
+            glUniformMatrix4fv(glGetUniformLocation(latlongToCubeShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(bakeFaceProjection));
+            glUniformMatrix4fv(glGetUniformLocation(latlongToCubeShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(bakeFaceView[step.stepFace]));
+            glActiveTexture(GL_TEXTURE0);
+            this->pendingHDR.useTexture();
+
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + step.stepFace, this->pendingCube.getTexID(), 0);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            cubeShape.drawShape();
+            break;
+        }
+
+        case BAKE_CUBE_MIPMAP:
+            this->pendingCube.computeTexMipmap();
+            break;
+
+        case BAKE_PREFILTER_FACE:
+        {
+            GLuint mipSize = this->prefilterSize >> step.stepMip;
+
+            glBindFramebuffer(GL_FRAMEBUFFER, this->bakeFBO);
+            glViewport(0, 0, mipSize, mipSize);
+
+            prefilterShader.useShader();
+            glUniformMatrix4fv(glGetUniformLocation(prefilterShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(bakeFaceProjection));
+            glUniformMatrix4fv(glGetUniformLocation(prefilterShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(bakeFaceView[step.stepFace]));
+            glUniform1f(glGetUniformLocation(prefilterShader.Program, "roughness"), GLfloat(step.stepMip) / GLfloat(this->prefilterMips - 1));
+            glUniform1f(glGetUniformLocation(prefilterShader.Program, "cubeResolutionWidth"), this->prefilterSize);
+            glUniform1f(glGetUniformLocation(prefilterShader.Program, "cubeResolutionHeight"), this->prefilterSize);
+            glActiveTexture(GL_TEXTURE0);
+            this->pendingCube.useTexture();
+
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + step.stepFace, this->pendingPrefilter.getTexID(), step.stepMip);
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            cubeShape.drawShape();
+            break;
+        }
+
+        case BAKE_UPLOAD_CUBE_FACE:
+        {
+            glBindTexture(GL_TEXTURE_CUBE_MAP, this->pendingCube.getTexID());
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + step.stepFace, 0, this->pendingCube.texInternalFormat, this->cubeSize, this->cubeSize, 0, GL_RGB, GL_HALF_FLOAT,
+                         this->cubeTexels.data() + size_t(step.stepFace) * this->cubeSize * this->cubeSize * 3);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+            break;
+        }
+
+        case BAKE_UPLOAD_PREFILTER_MIP:
+        {
+            GLuint mipSize = this->prefilterSize >> step.stepMip;
+            const GLushort* texelData = this->prefilterTexels.data() + IBLFile::computeTexelCount(this->prefilterSize, step.stepMip, 6, 3);
+
+            glBindTexture(GL_TEXTURE_CUBE_MAP, this->pendingPrefilter.getTexID());
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+            for (GLuint face = 0; face < 6; ++face)
+            {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, step.stepMip, this->pendingPrefilter.texInternalFormat, mipSize, mipSize, 0, GL_RGB, GL_HALF_FLOAT, texelData);
+                texelData += size_t(mipSize) * mipSize * 3;
+            }
+
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+            break;
+        }
+
+        case BAKE_READBACK:
+        {
+            // Copies into the pixel pack buffer are queued without waiting, pollReadback() maps it once the fence has passed
+            GLintptr readbackOffset = 0;
+
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, this->readbackPBO);
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, this->pendingCube.getTexID());
+
+            for (GLuint face = 0; face < 6; ++face)
+            {
+                glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB, GL_HALF_FLOAT, reinterpret_cast<void*>(readbackOffset));
+                readbackOffset += this->cubeSize * this->cubeSize * 3 * sizeof(GLushort);
+            }
+
+            glBindTexture(GL_TEXTURE_CUBE_MAP, this->pendingPrefilter.getTexID());
+
+            for (GLuint mip = 0; mip < this->prefilterMips; ++mip)
+            {
+                for (GLuint face = 0; face < 6; ++face)
+                {
+                    glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGB, GL_HALF_FLOAT, reinterpret_cast<void*>(readbackOffset));
+                    readbackOffset += (this->prefilterSize >> mip) * (this->prefilterSize >> mip) * 3 * sizeof(GLushort);
+                }
+            }
+
+            glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            this->readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            this->writePending = true;
+            this->writePath = this->bakeCachePath;
+            std::copy(this->pendingSH.getCoefficients(), this->pendingSH.getCoefficients() + IBLFile::shFloatCount, this->writeSH);
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    if (query >= 0)
+        glEndQuery(GL_TIME_ELAPSED);
+}
+
+
+// Results are only read once available, a step type costing the measured time per texel or byte (smoothed)
+void IBLBakeJob::pollQueries()
+{
+    for (GLuint i = 0; i < queryCount; ++i)
+    {
+        if (!this->queryPending[i])
+            continue;
+
+        GLint resultAvailable = 0;
+        glGetQueryObjectiv(this->stepQueries[i], GL_QUERY_RESULT_AVAILABLE, &resultAvailable);
+
+        if (!resultAvailable)
+            continue;
+
+        GLuint64 elapsedTime;
+        glGetQueryObjectui64v(this->stepQueries[i], GL_QUERY_RESULT, &elapsedTime);
+
+        GLfloat unitCost = GLfloat(elapsedTime / 1000000.0) / GLfloat(std::max(this->queryStep[i].stepUnits, 1u));
+        GLfloat& typeCost = this->stepCost[this->queryStep[i].stepType];
+
+        typeCost = typeCost < 0.0f ? unitCost : 0.75f * typeCost + 0.25f * unitCost;
+        this->queryPending[i] = false;
+    }
+}
+
+
+void IBLBakeJob::pollReadback()
+{
+    if (!this->writePending || glClientWaitSync(this->readbackFence, 0, 0) == GL_TIMEOUT_EXPIRED)
+        return;
+
+    glDeleteSync(this->readbackFence);
+    this->readbackFence = 0;
+
+    if (this->writeThread.joinable())
+        this->writeThread.join();
+
+    size_t cubeTexelCount = IBLFile::computeTexelCount(this->cubeSize, 1, 6, 3);
+    size_t prefilterTexelCount = IBLFile::computeTexelCount(this->prefilterSize, this->prefilterMips, 6, 3);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, this->readbackPBO);
+    const GLushort* readbackData = static_cast<const GLushort*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (cubeTexelCount + prefilterTexelCount) * sizeof(GLushort), GL_MAP_READ_BIT));
+
+    if (readbackData)
+    {
+        this->writeCubeTexels.assign(readbackData, readbackData + cubeTexelCount);
+        this->writePrefilterTexels.assign(readbackData + cubeTexelCount, readbackData + cubeTexelCount + prefilterTexelCount);
+
+        this->writeThread = std::thread([this]()
+        {
+            Profiler::setThreadName("IBL Cache Write");
+            ProfilerScope writeScope("Write Cache");
+
+            if (!IBLFile::writeEnvironment(this->writePath, this->cubeSize, this->prefilterSize, this->prefilterMips, 3, this->writeCubeTexels, this->writeSH, this->writePrefilterTexels))
+                std::cerr << "IBL CACHE - FAILED WRITING : " << this->writePath << std::endl;
+        });
+    }
+
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    this->writePending = false;
+}
+
+
+// Unmeasured step types are assumed to take the whole budget, so they run alone in their frame until a first timing came back
+GLfloat IBLBakeJob::estimateStep(const IBLBakeStep& step, GLfloat frameBudget)
+{
+    if (this->stepCost[step.stepType] < 0.0f)
+        return frameBudget;
+
+    return this->stepCost[step.stepType] * step.stepUnits;
+}
+
+
+// GL objects and their description are exchanged, the Texture objects themselves (and their destructors) staying in place
+void IBLBakeJob::swapTextures(Texture& texture, Texture& pendingTexture)
+{
+    std::swap(texture.texID, pendingTexture.texID);
+    std::swap(texture.texWidth, pendingTexture.texWidth);
+    std::swap(texture.texHeight, pendingTexture.texHeight);
+    std::swap(texture.texComponents, pendingTexture.texComponents);
+    std::swap(texture.texInternalFormat, pendingTexture.texInternalFormat);
+    std::swap(texture.texFormat, pendingTexture.texFormat);
+    std::swap(texture.texName, pendingTexture.texName);
+    std::swap(texture.texPath, pendingTexture.texPath);
+}
@@ -0,0 +1,122 @@
+#ifndef IBLBAKEJOB_H
+#define IBLBAKEJOB_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "shader.h"
+#include "shape.h"
+#include "texture.h"
+#include "iblcache.h"
+#include "irradiancesh.h"
+
+
+enum IBLBakeStepType
+{
+    BAKE_UPLOAD_HDR,
+    BAKE_CUBE_FACE,
+    BAKE_CUBE_MIPMAP,
+    BAKE_PREFILTER_FACE,
+    BAKE_UPLOAD_CUBE_FACE,
+    BAKE_UPLOAD_PREFILTER_MIP,
+    BAKE_READBACK,
+    BAKE_STEP_TYPE_COUNT
+};
+
+
+// One GPU pass of the re-bake, with its size in texels or bytes from which its cost is estimated
+struct IBLBakeStep
+{
+    IBLBakeStepType stepType;
+    GLuint stepFace;
+    GLuint stepMip;
+    GLuint stepUnits;
+};
+
+
+// Environment map switch spread over frames : the HDR file is decoded, hashed and projected on SH on a worker thread,
+// then the bake runs one face or mip per step, as many steps per frame as fit in a GPU time budget (step costs are measured
+// with non-blocking timer queries). The new set is built in textures of its own, the previous environment staying bound
+// until the set is complete, when both are swapped. Fresh bakes are written back to the IBL cache through an asynchronous readback
+class IBLBakeJob
+{
+    public:
+        IBLBakeJob();
+        ~IBLBakeJob();
+        void setTargets(GLuint cubeSize, GLuint prefilterSize, GLuint prefilterMips, GLuint sampleCount);
+        void requestEnvironment(const std::string& hdrPath, const std::string& hdrName);
+        bool updateJob(GLfloat frameBudget, Shader& latlongToCubeShader, Shader& prefilterShader, Shape& cubeShape, IBLCache& iblCache,
+                       Texture& envMapHDR, Texture& envMapCube, Texture& envMapPrefilter, IrradianceSH& irradianceSH);
+        bool isBusy();
+        GLfloat getProgress();
+        GLuint getFrameSteps();
+        GLfloat getFrameEstimate();
+        std::string getEnvironmentName();
+
+    private:
+        GLuint cubeSize = 0;
+        GLuint prefilterSize = 0;
+        GLuint prefilterMips = 0;
+        GLuint sampleCount = 0;
+        GLuint bakeFBO = 0;
+        GLuint readbackPBO = 0;
+        GLsync readbackFence = 0;
+
+        // Second set of textures the new environment is built in
+        Texture pendingHDR;
+        Texture pendingCube;
+        Texture pendingPrefilter;
+        IrradianceSH pendingSH;
+
+        // Request waiting for the decoding worker, then the worker output
+        std::string requestedPath, requestedName, bakePath, bakeName, bakeCachePath;
+        bool requestPending = false;
+        std::thread decodeThread;
+        std::atomic<bool> decodeDone;
+        bool decodeRunning = false;
+        bool cacheHit = false;
+        std::vector<GLfloat> hdrTexels;
+        GLuint hdrWidth = 0;
+        GLuint hdrHeight = 0;
+        GLuint hdrComponents = 0;
+        std::vector<GLushort> cubeTexels, prefilterTexels;
+
+        std::vector<IBLBakeStep> bakeSteps;
+        GLuint bakeStepIndex = 0;
+        GLuint frameSteps = 0;
+        GLfloat frameEstimate = 0.0f;
+
+        // Measured GPU milliseconds per texel or byte of each step type, negative until a first query came back
+        GLfloat stepCost[BAKE_STEP_TYPE_COUNT];
+        static const GLuint queryCount = 8;
+        GLuint stepQueries[queryCount];
+        IBLBakeStep queryStep[queryCount];
+        bool queryPending[queryCount];
+
+        // Readback of a fresh bake, written to the cache by a thread of its own once the fence has passed
+        std::thread writeThread;
+        bool writePending = false;
+        std::string writePath;
+        std::vector<GLushort> writeCubeTexels, writePrefilterTexels;
+        GLfloat writeSH[IBLFile::shFloatCount];
+
+        void decodeEnvironment(std::string hdrPath, IBLCache* iblCache);
+        void buildSteps();
+        void runStep(const IBLBakeStep& step, Shader& latlongToCubeShader, Shader& prefilterShader, Shape& cubeShape);
+        void pollQueries();
+        void pollReadback();
+        GLfloat estimateStep(const IBLBakeStep& step, GLfloat frameBudget);
+        void swapTextures(Texture& texture, Texture& pendingTexture);
+};
+
+#endif
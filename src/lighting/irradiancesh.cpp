@@ -0,0 +1,229 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IRRADIANCESH_SSE
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "irradiancesh.h"
+
+
+const float shPI = 3.14159265359f;
+
+// Real SH basis constants, in the order 1, y, z, x, xy, yz, 3z^2 - 1, xz, x^2 - y^2 of the polynomials evaluated in the shaders
+const float shBasisConstant[IrradianceSH::coefficientCount] = { 0.282095f, 0.488603f, 0.488603f, 0.488603f, 1.092548f, 1.092548f, 0.315392f, 1.092548f, 0.546274f };
+
+// Clamped cosine lobe convolution (Ramamoorthi & Hanrahan) divided by PI, per band
+const float shBandFactor[IrradianceSH::coefficientCount] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+
+IrradianceSH::IrradianceSH()
+{
+    std::fill(this->irradianceCoefficients, this->irradianceCoefficients + coefficientCount * 3, 0.0f);
+}
+
+
+IrradianceSH::~IrradianceSH()
+{
+
+}
+
+
+// The texels follow the latlong lookup of the shaders : u = (atan(x, -z) + PI) / 2PI, v = acos(-y) / PI,
+// each one weighted by its solid angle. Rows are handed out to the threads, their sums being merged in row order
+// so that the result does not depend on the thread count
+void IrradianceSH::computeCoefficients(const float* texData, unsigned int width, unsigned int height, unsigned int components, unsigned int threadCount)
+{
+    std::chrono::high_resolution_clock::time_point computeStart = std::chrono::high_resolution_clock::now();
+
+    this->columnSin.resize(width);
+    this->columnCos.resize(width);
+    this->rowSums.assign(height * coefficientCount * 3, 0.0);
+
+    for (unsigned int x = 0; x < width; ++x)
+    {
+        float theta = 2.0f * shPI * (x + 0.5f) / width - shPI;
+
+        this->columnSin[x] = std::sin(theta);
+        this->columnCos[x] = std::cos(theta);
+    }
+
+    if (!threadCount)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    threadCount = std::max(1u, std::min(threadCount, height));
+
+    std::atomic<unsigned int> nextRow(0);
+
+    auto projectWorker = [this, &nextRow, texData, width, height, components]()
+    {
+        for (unsigned int row = nextRow++; row < height; row = nextRow++)
+            this->projectRow(texData, width, height, components, row);
+    };
+
+    std::vector<std::thread> projectThreads;
+
+    for (unsigned int i = 1; i < threadCount; ++i)
+        projectThreads.push_back(std::thread(projectWorker));
+
+    projectWorker();
+
+    for (std::thread& projectThread : projectThreads)
+        projectThread.join();
+
+    double coefficientSums[coefficientCount * 3] = { 0.0 };
+
+    for (unsigned int row = 0; row < height; ++row)
+    {
+        for (unsigned int i = 0; i < coefficientCount * 3; ++i)
+            coefficientSums[i] += this->rowSums[row * coefficientCount * 3 + i];
+    }
+
+    for (unsigned int i = 0; i < coefficientCount; ++i)
+    {
+        for (unsigned int channel = 0; channel < 3; ++channel)
+            this->irradianceCoefficients[i * 3 + channel] = float(coefficientSums[i * 3 + channel] * shBasisConstant[i] * shBasisConstant[i] * shBandFactor[i]);
+    }
+
+    this->computeTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - computeStart).count();
+    this->computeThreads = threadCount;
+}
+
+
+void IrradianceSH::projectRow(const float* texData, unsigned int width, unsigned int height, unsigned int components, unsigned int row)
+{
+    const float phi = shPI * (row + 0.5f) / height;
+    const float sinPhi = std::sin(phi);
+    const float dirY = -std::cos(phi);
+    const float solidAngle = sinPhi * (shPI / height) * (2.0f * shPI / width);
+
+    const float* rowData = texData + size_t(row) * width * components;
+    const float* columnSin = this->columnSin.data();
+    const float* columnCos = this->columnCos.data();
+
+    float sums[coefficientCount * 3] = { 0.0f };
+    unsigned int x = 0;
+
+#ifdef IRRADIANCESH_SSE
+    // 4 texels per iteration, one accumulator per coefficient and channel
+    __m128 accumulators[coefficientCount * 3];
+
+    for (unsigned int i = 0; i < coefficientCount * 3; ++i)
+        accumulators[i] = _mm_setzero_ps();
+
+    const __m128 sinPhi4 = _mm_set1_ps(sinPhi);
+    const __m128 dirY4 = _mm_set1_ps(dirY);
+    const __m128 one4 = _mm_set1_ps(1.0f);
+    const __m128 three4 = _mm_set1_ps(3.0f);
+
+    for (; x + 4 <= width; x += 4)
+    {
+        const float* texel = rowData + x * components;
+
+        __m128 colors[3];
+        colors[0] = _mm_setr_ps(texel[0], texel[components], texel[2 * components], texel[3 * components]);
+        colors[1] = _mm_setr_ps(texel[1], texel[components + 1], texel[2 * components + 1], texel[3 * components + 1]);
+        colors[2] = _mm_setr_ps(texel[2], texel[components + 2], texel[2 * components + 2], texel[3 * components + 2]);
+
+        __m128 dirX = _mm_mul_ps(sinPhi4, _mm_loadu_ps(columnSin + x));
+        __m128 dirZ = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(sinPhi4, _mm_loadu_ps(columnCos + x)));
+
+        __m128 basis[coefficientCount];
+        basis[0] = one4;
+        basis[1] = dirY4;
+        basis[2] = dirZ;
+        basis[3] = dirX;
+        basis[4] = _mm_mul_ps(dirX, dirY4);
+        basis[5] = _mm_mul_ps(dirY4, dirZ);
+        basis[6] = _mm_sub_ps(_mm_mul_ps(three4, _mm_mul_ps(dirZ, dirZ)), one4);
+        basis[7] = _mm_mul_ps(dirX, dirZ);
+        basis[8] = _mm_sub_ps(_mm_mul_ps(dirX, dirX), _mm_mul_ps(dirY4, dirY4));
+
+        for (unsigned int i = 0; i < coefficientCount; ++i)
+        {
+            for (unsigned int channel = 0; channel < 3; ++channel)
+                accumulators[i * 3 + channel] = _mm_add_ps(accumulators[i * 3 + channel], _mm_mul_ps(basis[i], colors[channel]));
+        }
+    }
+
+    for (unsigned int i = 0; i < coefficientCount * 3; ++i)
+    {
+        float lanes[4];
+        _mm_storeu_ps(lanes, accumulators[i]);
+        sums[i] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+#endif
+
+    for (; x < width; ++x)
+    {
+        const float* texel = rowData + x * components;
+
+        float dirX = sinPhi * columnSin[x];
+        float dirZ = -sinPhi * columnCos[x];
+        float basis[coefficientCount] = { 1.0f, dirY, dirZ, dirX, dirX * dirY, dirY * dirZ, 3.0f * dirZ * dirZ - 1.0f, dirX * dirZ, dirX * dirX - dirY * dirY };
+
+        for (unsigned int i = 0; i < coefficientCount; ++i)
+        {
+            for (unsigned int channel = 0; channel < 3; ++channel)
+                sums[i * 3 + channel] += basis[i] * texel[channel];
+        }
+    }
+
+    double* rowSum = this->rowSums.data() + size_t(row) * coefficientCount * 3;
+
+    for (unsigned int i = 0; i < coefficientCount * 3; ++i)
+        rowSum[i] = double(sums[i]) * solidAngle;
+}
+
+
+const float* IrradianceSH::getCoefficients()
+{
+    return this->irradianceCoefficients;
+}
+
+
+// Coefficients computed beforehand, typically coming from the IBL cache
+void IrradianceSH::setCoefficients(const float* coefficients)
+{
+    std::copy(coefficients, coefficients + coefficientCount * 3, this->irradianceCoefficients);
+}
+
+
+// Same evaluation as the shaders, already divided by PI (the Lambert albedo / PI term only needs the albedo)
+glm::vec3 IrradianceSH::computeIrradiance(glm::vec3 normal)
+{
+    float basis[coefficientCount] = { 1.0f, normal.y, normal.z, normal.x, normal.x * normal.y, normal.y * normal.z,
+                                      3.0f * normal.z * normal.z - 1.0f, normal.x * normal.z, normal.x * normal.x - normal.y * normal.y };
+
+    glm::vec3 irradiance = glm::vec3(0.0f);
+
+    for (unsigned int i = 0; i < coefficientCount; ++i)
+        irradiance += basis[i] * glm::vec3(this->irradianceCoefficients[i * 3], this->irradianceCoefficients[i * 3 + 1], this->irradianceCoefficients[i * 3 + 2]);
+
+    return glm::max(irradiance, glm::vec3(0.0f));
+}
+
+
+float IrradianceSH::getComputeTime()
+{
+    return this->computeTime;
+}
+
+
+unsigned int IrradianceSH::getComputeThreads()
+{
+    return this->computeThreads;
+}
@@ -0,0 +1,45 @@
+#ifndef IRRADIANCESH_H
+#define IRRADIANCESH_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+
+// Diffuse irradiance of an environment map as 9 spherical harmonics coefficients (bands 0 to 2) per color channel,
+// projected on the CPU from the latlong HDR texels. Deliberately free of any GL call, like ClusterGrid
+class IrradianceSH
+{
+    public:
+        static const unsigned int coefficientCount = 9;
+
+        IrradianceSH();
+        ~IrradianceSH();
+        void computeCoefficients(const float* texData, unsigned int width, unsigned int height, unsigned int components, unsigned int threadCount = 0);
+        const float* getCoefficients();
+        void setCoefficients(const float* coefficients);
+        glm::vec3 computeIrradiance(glm::vec3 normal);
+        float getComputeTime();
+        unsigned int getComputeThreads();
+
+    private:
+        // RGB triplets, already convolved with the clamped cosine lobe and multiplied by the basis constants and 1/PI,
+        // so that the shader only has to weight them by the basis polynomials of the normal
+        float irradianceCoefficients[coefficientCount * 3];
+        float computeTime = 0.0f;
+        unsigned int computeThreads = 0;
+
+        // Per-column direction terms of the latlong mapping, and per-row partial sums merged in row order
+        std::vector<float> columnSin, columnCos;
+        std::vector<double> rowSums;
+
+        void projectRow(const float* texData, unsigned int width, unsigned int height, unsigned int components, unsigned int row);
+};
+
+#endif
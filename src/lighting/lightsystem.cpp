@@ -0,0 +1,656 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LIGHTSYSTEM_SSE
+#endif
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "lightsystem.h"
+#include "profiler.h"
+
+
+LightSystem::LightSystem()
+{
+
+}
+
+
+LightSystem::~LightSystem()
+{
+
+}
+
+
+LightHandle LightSystem::addPointLight(glm::vec3 position, glm::vec4 color, float radius, bool isMesh)
+{
+    return this->addLight(LIGHT_POINT, glm::vec4(position, 1.0f), color, radius, isMesh);
+}
+
+
+LightHandle LightSystem::addDirectionalLight(glm::vec3 direction, glm::vec4 color)
+{
+    return this->addLight(LIGHT_DIRECTIONAL, glm::vec4(direction, 0.0f), color, 0.0f, false);
+}
+
+
+LightHandle LightSystem::addLight(LightType type, glm::vec4 position, glm::vec4 color, float radius, bool isMesh)
+{
+    GLuint lightIndex = this->getLightCount();
+
+    this->lightPositionX.push_back(position.x);
+    this->lightPositionY.push_back(position.y);
+    this->lightPositionZ.push_back(position.z);
+    this->lightPositionW.push_back(position.w);
+    this->lightColorR.push_back(color.r);
+    this->lightColorG.push_back(color.g);
+    this->lightColorB.push_back(color.b);
+    this->lightColorA.push_back(color.a);
+    this->lightRadius.push_back(radius);
+    this->lightType.push_back(type);
+    this->lightToMesh.push_back(isMesh);
+    this->lightDirty.push_back(true);
+    this->lightShadowLayer.push_back(-1);
+    this->lightViewX.push_back(0.0f);
+    this->lightViewY.push_back(0.0f);
+    this->lightViewZ.push_back(0.0f);
+
+    // Reuse a free handle slot if any, its generation was bumped when it got freed
+    GLuint handleSlot;
+
+    if (!this->freeSlots.empty())
+    {
+        handleSlot = this->freeSlots.back();
+        this->freeSlots.pop_back();
+    }
+    else
+    {
+        handleSlot = this->slotToIndex.size();
+        this->slotToIndex.push_back(0);
+        this->slotGeneration.push_back(0);
+    }
+
+    this->slotToIndex[handleSlot] = lightIndex;
+    this->indexToSlot.push_back(handleSlot);
+    this->anyDirty = true;
+    this->viewSpaceDirty = true;
+
+    if (isMesh && !this->lightMeshReady)
+    {
+        this->lightMesh.setShape("cube", glm::vec3(0.0f));
+        this->lightMesh.setShapeScale(glm::vec3(0.15f, 0.15f, 0.15f));
+        this->lightMeshReady = true;
+    }
+
+    LightHandle handle;
+    handle.handleSlot = handleSlot;
+    handle.handleGeneration = this->slotGeneration[handleSlot];
+
+    return handle;
+}
+
+
+void LightSystem::removeLight(LightHandle handle)
+{
+    if (!this->isValid(handle))
+        return;
+
+    // Swap-and-pop to keep the arrays packed, then patch the handle of the light that moved
+    GLuint lightIndex = this->slotToIndex[handle.handleSlot];
+    GLuint lastIndex = this->getLightCount() - 1;
+
+    this->lightPositionX[lightIndex] = this->lightPositionX[lastIndex];
+    this->lightPositionY[lightIndex] = this->lightPositionY[lastIndex];
+    this->lightPositionZ[lightIndex] = this->lightPositionZ[lastIndex];
+    this->lightPositionW[lightIndex] = this->lightPositionW[lastIndex];
+    this->lightColorR[lightIndex] = this->lightColorR[lastIndex];
+    this->lightColorG[lightIndex] = this->lightColorG[lastIndex];
+    this->lightColorB[lightIndex] = this->lightColorB[lastIndex];
+    this->lightColorA[lightIndex] = this->lightColorA[lastIndex];
+    this->lightRadius[lightIndex] = this->lightRadius[lastIndex];
+    this->lightType[lightIndex] = this->lightType[lastIndex];
+    this->lightToMesh[lightIndex] = this->lightToMesh[lastIndex];
+    this->lightShadowLayer[lightIndex] = this->lightShadowLayer[lastIndex];
+    this->lightViewX[lightIndex] = this->lightViewX[lastIndex];
+    this->lightViewY[lightIndex] = this->lightViewY[lastIndex];
+    this->lightViewZ[lightIndex] = this->lightViewZ[lastIndex];
+    this->indexToSlot[lightIndex] = this->indexToSlot[lastIndex];
+    this->slotToIndex[this->indexToSlot[lightIndex]] = lightIndex;
+
+    this->lightPositionX.pop_back();
+    this->lightPositionY.pop_back();
+    this->lightPositionZ.pop_back();
+    this->lightPositionW.pop_back();
+    this->lightColorR.pop_back();
+    this->lightColorG.pop_back();
+    this->lightColorB.pop_back();
+    this->lightColorA.pop_back();
+    this->lightRadius.pop_back();
+    this->lightType.pop_back();
+    this->lightToMesh.pop_back();
+    this->lightDirty.pop_back();
+    this->lightShadowLayer.pop_back();
+    this->lightViewX.pop_back();
+    this->lightViewY.pop_back();
+    this->lightViewZ.pop_back();
+    this->indexToSlot.pop_back();
+
+    this->slotToIndex[handle.handleSlot] = invalidIndex;
+    this->slotGeneration[handle.handleSlot]++;
+    this->freeSlots.push_back(handle.handleSlot);
+
+    // The moved light changed index, and the per-type indices of the others may have shifted
+    std::fill(this->lightDirty.begin(), this->lightDirty.end(), true);
+    this->anyDirty = true;
+    this->viewSpaceDirty = true;
+}
+
+
+bool LightSystem::isValid(LightHandle handle)
+{
+    return handle.handleSlot < this->slotGeneration.size() && this->slotGeneration[handle.handleSlot] == handle.handleGeneration;
+}
+
+
+// Batched over all the lights, and only once per frame : the several passes asking for the view-space positions
+// reuse the previous result as long as neither the view nor any light changed
+void LightSystem::computeViewSpace(const glm::mat4& view)
+{
+    if (!this->viewSpaceDirty && view == this->viewSpaceMatrix)
+        return;
+
+    this->viewSpaceMatrix = view;
+    this->viewSpaceDirty = false;
+
+    const GLuint lightCount = this->getLightCount();
+
+    const GLfloat* positionX = this->lightPositionX.data();
+    const GLfloat* positionY = this->lightPositionY.data();
+    const GLfloat* positionZ = this->lightPositionZ.data();
+    const GLfloat* positionW = this->lightPositionW.data();
+    GLfloat* viewX = this->lightViewX.data();
+    GLfloat* viewY = this->lightViewY.data();
+    GLfloat* viewZ = this->lightViewZ.data();
+
+    GLuint i = 0;
+
+#ifdef LIGHTSYSTEM_SSE
+    // 4 lights per iteration, the matrix coefficients are broadcasted once (GLM matrices are column-major)
+    const __m128 m00 = _mm_set1_ps(view[0][0]), m10 = _mm_set1_ps(view[1][0]), m20 = _mm_set1_ps(view[2][0]), m30 = _mm_set1_ps(view[3][0]);
+    const __m128 m01 = _mm_set1_ps(view[0][1]), m11 = _mm_set1_ps(view[1][1]), m21 = _mm_set1_ps(view[2][1]), m31 = _mm_set1_ps(view[3][1]);
+    const __m128 m02 = _mm_set1_ps(view[0][2]), m12 = _mm_set1_ps(view[1][2]), m22 = _mm_set1_ps(view[2][2]), m32 = _mm_set1_ps(view[3][2]);
+
+    for (; i + 4 <= lightCount; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(positionX + i);
+        __m128 y = _mm_loadu_ps(positionY + i);
+        __m128 z = _mm_loadu_ps(positionZ + i);
+        __m128 w = _mm_loadu_ps(positionW + i);
+
+        _mm_storeu_ps(viewX + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m00, x), _mm_mul_ps(m10, y)), _mm_add_ps(_mm_mul_ps(m20, z), _mm_mul_ps(m30, w))));
+        _mm_storeu_ps(viewY + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m01, x), _mm_mul_ps(m11, y)), _mm_add_ps(_mm_mul_ps(m21, z), _mm_mul_ps(m31, w))));
+        _mm_storeu_ps(viewZ + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(m02, x), _mm_mul_ps(m12, y)), _mm_add_ps(_mm_mul_ps(m22, z), _mm_mul_ps(m32, w))));
+    }
+#endif
+
+    for (; i < lightCount; ++i)
+    {
+        viewX[i] = view[0][0] * positionX[i] + view[1][0] * positionY[i] + view[2][0] * positionZ[i] + view[3][0] * positionW[i];
+        viewY[i] = view[0][1] * positionX[i] + view[1][1] * positionY[i] + view[2][1] * positionZ[i] + view[3][1] * positionW[i];
+        viewZ[i] = view[0][2] * positionX[i] + view[1][2] * positionY[i] + view[2][2] * positionZ[i] + view[3][2] * positionW[i];
+    }
+}
+
+
+// Lights kept in a persistent uniform buffer (the LightBlock of lightingBRDF.frag) instead of being re-sent uniform by uniform.
+// Colors and shadows are only rewritten for the dirty lights, the view-space positions when the view or a light changed,
+// and the modified byte range of the CPU mirror goes up with a single glBufferSubData
+void LightSystem::renderToUniformBuffer(const glm::mat4& view)
+{
+    if (!this->lightBlockBuffer)
+    {
+        glGenBuffers(1, &this->lightBlockBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, this->lightBlockBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlock), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        std::memset(&this->lightBlockData, 0, sizeof(LightBlock));
+        std::fill(this->lightDirty.begin(), this->lightDirty.end(), true);
+        this->anyDirty = true;
+        this->markBlockRange(&this->lightBlockData, sizeof(LightBlock));
+    }
+
+    bool viewChanged = view != this->lightBlockView;
+
+    if (viewChanged || this->anyDirty)
+    {
+        this->computeViewSpace(view);
+
+        GLint lightPointIndex = 0;
+        GLint lightDirectionalIndex = 0;
+
+        for (GLuint i = 0; i < this->getLightCount(); i++)
+        {
+            if (this->lightType[i] == LIGHT_POINT && lightPointIndex < GLint(LightBlock::pointMax))
+            {
+                GLuint blockIndex = lightPointIndex++;
+
+                if (viewChanged || this->lightDirty[i])
+                {
+                    GLfloat* positionRadius = this->lightBlockData.pointPositionRadius[blockIndex];
+                    positionRadius[0] = this->lightViewX[i];
+                    positionRadius[1] = this->lightViewY[i];
+                    positionRadius[2] = this->lightViewZ[i];
+                    positionRadius[3] = this->lightRadius[i];
+                    this->markBlockRange(positionRadius, 4 * sizeof(GLfloat));
+                }
+
+                if (this->lightDirty[i])
+                {
+                    GLfloat* color = this->lightBlockData.pointColor[blockIndex];
+                    color[0] = this->lightColorR[i];
+                    color[1] = this->lightColorG[i];
+                    color[2] = this->lightColorB[i];
+                    color[3] = this->lightColorA[i];
+                    this->markBlockRange(color, 4 * sizeof(GLfloat));
+
+                    this->lightBlockData.pointShadow[blockIndex][0] = this->lightShadowLayer[i];
+                    this->markBlockRange(this->lightBlockData.pointShadow[blockIndex], 4 * sizeof(GLint));
+                }
+            }
+
+            else if (this->lightType[i] == LIGHT_DIRECTIONAL && lightDirectionalIndex < GLint(LightBlock::directionalMax))
+            {
+                GLuint blockIndex = lightDirectionalIndex++;
+
+                if (viewChanged || this->lightDirty[i])
+                {
+                    GLfloat* direction = this->lightBlockData.directionalDirection[blockIndex];
+                    direction[0] = this->lightViewX[i];
+                    direction[1] = this->lightViewY[i];
+                    direction[2] = this->lightViewZ[i];
+                    this->markBlockRange(direction, 4 * sizeof(GLfloat));
+                }
+
+                if (this->lightDirty[i])
+                {
+                    GLfloat* color = this->lightBlockData.directionalColor[blockIndex];
+                    color[0] = this->lightColorR[i];
+                    color[1] = this->lightColorG[i];
+                    color[2] = this->lightColorB[i];
+                    color[3] = this->lightColorA[i];
+                    this->markBlockRange(color, 4 * sizeof(GLfloat));
+                }
+            }
+        }
+
+        if (this->lightBlockData.lightCounters[0] != lightPointIndex || this->lightBlockData.lightCounters[1] != lightDirectionalIndex)
+        {
+            this->lightBlockData.lightCounters[0] = lightPointIndex;
+            this->lightBlockData.lightCounters[1] = lightDirectionalIndex;
+            this->markBlockRange(this->lightBlockData.lightCounters, 4 * sizeof(GLint));
+        }
+
+        this->lightBlockView = view;
+    }
+
+    if (this->lightBlockDirtyEnd > this->lightBlockDirtyBegin)
+    {
+        const GLubyte* blockData = reinterpret_cast<const GLubyte*>(&this->lightBlockData);
+
+        glBindBuffer(GL_UNIFORM_BUFFER, this->lightBlockBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, this->lightBlockDirtyBegin, this->lightBlockDirtyEnd - this->lightBlockDirtyBegin, blockData + this->lightBlockDirtyBegin);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        this->lightBlockDirtyBegin = 0;
+        this->lightBlockDirtyEnd = 0;
+    }
+}
+
+
+void LightSystem::bindUniformBuffer(GLuint bindingPoint)
+{
+    glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, this->lightBlockBuffer);
+}
+
+
+// Point lights packed as std430 { vec4 positionRadius; vec4 color; }, positions in view-space
+void LightSystem::renderToBuffer(const glm::mat4& view)
+{
+    this->computeViewSpace(view);
+
+    const GLuint lightCount = this->getLightCount();
+    this->lightPointBufferData.resize(lightCount * 8);
+
+    GLfloat* bufferData = this->lightPointBufferData.data();
+    GLuint lightPointIndex = 0;
+
+    for (GLuint i = 0; i < lightCount; i++)
+    {
+        if (this->lightType[i] != LIGHT_POINT)
+            continue;
+
+        GLfloat* lightData = bufferData + 8 * lightPointIndex++;
+
+        lightData[0] = this->lightViewX[i];
+        lightData[1] = this->lightViewY[i];
+        lightData[2] = this->lightViewZ[i];
+        lightData[3] = this->lightRadius[i];
+        lightData[4] = this->lightColorR[i];
+        lightData[5] = this->lightColorG[i];
+        lightData[6] = this->lightColorB[i];
+        lightData[7] = this->lightColorA[i];
+    }
+
+    if (!this->lightPointBuffer)
+        glGenBuffers(1, &this->lightPointBuffer);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->lightPointBuffer);
+
+    // Only reallocate when growing, an empty buffer still gets one light worth of storage to stay bindable
+    GLuint bufferCapacity = std::max(lightPointIndex, 1u);
+
+    if (bufferCapacity > this->lightPointBufferCapacity)
+    {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, bufferCapacity * 8 * sizeof(GLfloat), nullptr, GL_DYNAMIC_DRAW);
+        this->lightPointBufferCapacity = bufferCapacity;
+    }
+
+    if (lightPointIndex)
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, lightPointIndex * 8 * sizeof(GLfloat), bufferData);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    this->lightPointBufferCount = lightPointIndex;
+}
+
+
+void LightSystem::bindLightBuffer(GLuint bindingPoint)
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, bindingPoint, this->lightPointBuffer);
+}
+
+
+GLuint LightSystem::getLightBufferCount()
+{
+    return this->lightPointBufferCount;
+}
+
+
+// Clustered forward+ : point lights uploaded by renderToBuffer(), then binned into the froxels of the grid.
+// The grid buffer holds an uvec2 (offset, count) per cluster, the index buffer the compact light lists
+void LightSystem::renderToClusters(ClusterGrid& clusterGrid, const glm::mat4& view)
+{
+    this->renderToBuffer(view);
+
+    // Timed here, ClusterGrid staying free of any GL (and thus profiler) dependency
+    {
+        ProfilerScope binScope("Cluster Binning");
+        clusterGrid.binLights(this->lightPointBufferData.data(), 8, this->lightPointBufferCount);
+    }
+
+    GLuint gridSize = GLuint(clusterGrid.clusterOffsetCount.size() * sizeof(GLuint));
+    GLuint indexSize = GLuint(clusterGrid.clusterLightIndices.size() * sizeof(GLuint));
+
+    if (!this->clusterGridBuffer)
+    {
+        glGenBuffers(1, &this->clusterGridBuffer);
+        glGenBuffers(1, &this->clusterIndexBuffer);
+    }
+
+    // Same growing-only policy as the light buffer, the index buffer always keeps at least one entry to stay bindable
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->clusterGridBuffer);
+
+    if (gridSize > this->clusterGridBufferSize)
+    {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, gridSize, nullptr, GL_DYNAMIC_DRAW);
+        this->clusterGridBufferSize = gridSize;
+    }
+
+    if (gridSize)
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, gridSize, clusterGrid.clusterOffsetCount.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->clusterIndexBuffer);
+
+    if (std::max(indexSize, GLuint(sizeof(GLuint))) > this->clusterIndexBufferSize)
+    {
+        this->clusterIndexBufferSize = std::max(indexSize, GLuint(sizeof(GLuint)));
+        glBufferData(GL_SHADER_STORAGE_BUFFER, this->clusterIndexBufferSize, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    if (indexSize)
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, indexSize, clusterGrid.clusterLightIndices.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+
+void LightSystem::bindClusterBuffers(GLuint gridBindingPoint, GLuint indexBindingPoint)
+{
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, gridBindingPoint, this->clusterGridBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, indexBindingPoint, this->clusterIndexBuffer);
+}
+
+
+void LightSystem::renderLightMeshes(Shader& shader, glm::mat4& view, glm::mat4& projection, Camera& camera)
+{
+    if (!this->lightMeshReady)
+        return;
+
+    shader.useShader();
+
+    for (GLuint i = 0; i < this->getLightCount(); i++)
+    {
+        if (this->lightType[i] != LIGHT_POINT || !this->lightToMesh[i])
+            continue;
+
+        glUniform4f(glGetUniformLocation(shader.Program, "lightColor"), this->lightColorR[i], this->lightColorG[i], this->lightColorB[i], this->lightColorA[i]);
+
+        this->lightMesh.setShapePosition(glm::vec3(this->lightPositionX[i], this->lightPositionY[i], this->lightPositionZ[i]));
+        this->lightMesh.drawShape(shader, view, projection, camera);
+    }
+}
+
+
+void LightSystem::clearDirty()
+{
+    std::fill(this->lightDirty.begin(), this->lightDirty.end(), false);
+    this->anyDirty = false;
+}
+
+
+bool LightSystem::isDirty()
+{
+    return this->anyDirty;
+}
+
+
+GLuint LightSystem::getLightCount()
+{
+    return this->lightType.size();
+}
+
+
+GLuint LightSystem::getLightCount(LightType type)
+{
+    return std::count(this->lightType.begin(), this->lightType.end(), type);
+}
+
+
+GLuint LightSystem::getLightIndex(LightHandle handle)
+{
+    if (!this->isValid(handle))
+        return invalidIndex;
+
+    return this->slotToIndex[handle.handleSlot];
+}
+
+
+// A stale handle reads back default values, and the setters ignore it
+LightType LightSystem::getLightType(LightHandle handle)
+{
+    GLuint lightIndex = this->getLightIndex(handle);
+
+    if (lightIndex == invalidIndex)
+        return LIGHT_POINT;
+
+    return this->lightType[lightIndex];
+}
+
+
+glm::vec3 LightSystem::getLightPosition(LightHandle handle)
+{
+    GLuint lightIndex = this->getLightIndex(handle);
+
+    if (lightIndex == invalidIndex)
+        return glm::vec3(0.0f);
+
+    return glm::vec3(this->lightPositionX[lightIndex], this->lightPositionY[lightIndex], this->lightPositionZ[lightIndex]);
+}
+
+
+glm::vec3 LightSystem::getLightDirection(LightHandle handle)
+{
+    return this->getLightPosition(handle);
+}
+
+
+glm::vec4 LightSystem::getLightColor(LightHandle handle)
+{
+    GLuint lightIndex = this->getLightIndex(handle);
+
+    if (lightIndex == invalidIndex)
+        return glm::vec4(0.0f);
+
+    return glm::vec4(this->lightColorR[lightIndex], this->lightColorG[lightIndex], this->lightColorB[lightIndex], this->lightColorA[lightIndex]);
+}
+
+
+float LightSystem::getLightRadius(LightHandle handle)
+{
+    GLuint lightIndex = this->getLightIndex(handle);
+
+    if (lightIndex == invalidIndex)
+        return 0.0f;
+
+    return this->lightRadius[lightIndex];
+}
+
+
+GLint LightSystem::getLightShadowLayer(LightHandle handle)
+{
+    GLuint lightIndex = this->getLightIndex(handle);
+
+    if (lightIndex == invalidIndex)
+        return -1;
+
+    return this->lightShadowLayer[lightIndex];
+}
+
+
+// The setters only flag the light when its value actually changed
+void LightSystem::setLightPosition(LightHandle handle, glm::vec3 position)
+{
+    GLuint lightIndex = this->getLightIndex(handle);
+
+    if (lightIndex == invalidIndex)
+        return;
+
+    if (this->lightPositionX[lightIndex] == position.x && this->lightPositionY[lightIndex] == position.y && this->lightPositionZ[lightIndex] == position.z)
+        return;
+
+    this->lightPositionX[lightIndex] = position.x;
+    this->lightPositionY[lightIndex] = position.y;
+    this->lightPositionZ[lightIndex] = position.z;
+    this->markDirty(lightIndex);
+}
+
+
+void LightSystem::setLightDirection(LightHandle handle, glm::vec3 direction)
+{
+    this->setLightPosition(handle, direction);
+}
+
+
+void LightSystem::setLightColor(LightHandle handle, glm::vec4 color)
+{
+    GLuint lightIndex = this->getLightIndex(handle);
+
+    if (lightIndex == invalidIndex)
+        return;
+
+    if (this->lightColorR[lightIndex] == color.r && this->lightColorG[lightIndex] == color.g && this->lightColorB[lightIndex] == color.b && this->lightColorA[lightIndex] == color.a)
+        return;
+
+    this->lightColorR[lightIndex] = color.r;
+    this->lightColorG[lightIndex] = color.g;
+    this->lightColorB[lightIndex] = color.b;
+    this->lightColorA[lightIndex] = color.a;
+    this->markDirty(lightIndex);
+}
+
+
+void LightSystem::setLightRadius(LightHandle handle, float radius)
+{
+    GLuint lightIndex = this->getLightIndex(handle);
+
+    if (lightIndex == invalidIndex)
+        return;
+
+    if (this->lightRadius[lightIndex] == radius)
+        return;
+
+    this->lightRadius[lightIndex] = radius;
+    this->markDirty(lightIndex);
+}
+
+
+void LightSystem::setLightShadowLayer(LightHandle handle, GLint shadowLayer)
+{
+    GLuint lightIndex = this->getLightIndex(handle);
+
+    if (lightIndex == invalidIndex)
+        return;
+
+    if (this->lightShadowLayer[lightIndex] == shadowLayer)
+        return;
+
+    this->lightShadowLayer[lightIndex] = shadowLayer;
+    this->markDirty(lightIndex);
+}
+
+
+void LightSystem::markDirty(GLuint index)
+{
+    this->lightDirty[index] = true;
+    this->anyDirty = true;
+    this->viewSpaceDirty = true;
+}
+
+
+// Grows the byte range of the uniform buffer mirror waiting for upload
+void LightSystem::markBlockRange(const void* member, GLuint size)
+{
+    GLuint begin = GLuint(reinterpret_cast<const GLubyte*>(member) - reinterpret_cast<const GLubyte*>(&this->lightBlockData));
+
+    if (this->lightBlockDirtyEnd == this->lightBlockDirtyBegin)
+    {
+        this->lightBlockDirtyBegin = begin;
+        this->lightBlockDirtyEnd = begin + size;
+    }
+    else
+    {
+        this->lightBlockDirtyBegin = std::min(this->lightBlockDirtyBegin, begin);
+        this->lightBlockDirtyEnd = std::max(this->lightBlockDirtyEnd, begin + size);
+    }
+}
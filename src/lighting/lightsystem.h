@@ -0,0 +1,129 @@
+#ifndef LIGHTSYSTEM_H
+#define LIGHTSYSTEM_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "shader.h"
+#include "shape.h"
+#include "camera.h"
+#include "clustergrid.h"
+
+
+enum LightType
+{
+    LIGHT_POINT,
+    LIGHT_DIRECTIONAL
+};
+
+
+// std140 mirror of the LightBlock uniform block declared in lightingBRDF.frag, every member being vec4/ivec4 aligned
+struct LightBlock
+{
+    static const GLuint pointMax = 3;
+    static const GLuint directionalMax = 1;
+
+    GLfloat pointPositionRadius[pointMax][4];           // View-space position, radius in w
+    GLfloat pointColor[pointMax][4];
+    GLint pointShadow[pointMax][4];                     // Cube index of the point shadow in x
+    GLfloat directionalDirection[directionalMax][4];    // View-space direction
+    GLfloat directionalColor[directionalMax][4];
+    GLint lightCounters[4];                             // Point light count in x, directional light count in y
+};
+
+
+// Stays valid while the light lives, whatever the removals happening around it
+struct LightHandle
+{
+    GLuint handleSlot;
+    GLuint handleGeneration;
+};
+
+
+class LightSystem
+{
+    public:
+        // Index of the freed handle slots, returned by getLightIndex for a removed light
+        static const GLuint invalidIndex = 0xFFFFFFFF;
+
+        // Structure-of-Arrays light storage, densely packed so per-frame loops run over contiguous floats.
+        // Positions are homogeneous : w = 1 for point lights, w = 0 for directional lights (xyz is then the direction)
+        std::vector<GLfloat> lightPositionX, lightPositionY, lightPositionZ, lightPositionW;
+        std::vector<GLfloat> lightColorR, lightColorG, lightColorB, lightColorA;
+        std::vector<GLfloat> lightRadius;
+        std::vector<LightType> lightType;
+        std::vector<GLubyte> lightToMesh;
+        std::vector<GLubyte> lightDirty;
+        std::vector<GLint> lightShadowLayer;    // Cube index of the light shadow in the point shadow cube-map array, -1 when it casts none
+
+        // View-space positions/directions, refreshed by computeViewSpace()
+        std::vector<GLfloat> lightViewX, lightViewY, lightViewZ;
+
+        LightSystem();
+        ~LightSystem();
+        LightHandle addPointLight(glm::vec3 position, glm::vec4 color, float radius, bool isMesh);
+        LightHandle addDirectionalLight(glm::vec3 direction, glm::vec4 color);
+        void removeLight(LightHandle handle);
+        bool isValid(LightHandle handle);
+        void computeViewSpace(const glm::mat4& view);
+        void renderToUniformBuffer(const glm::mat4& view);
+        void bindUniformBuffer(GLuint bindingPoint);
+        void renderToBuffer(const glm::mat4& view);
+        void bindLightBuffer(GLuint bindingPoint);
+        GLuint getLightBufferCount();
+        void renderToClusters(ClusterGrid& clusterGrid, const glm::mat4& view);
+        void bindClusterBuffers(GLuint gridBindingPoint, GLuint indexBindingPoint);
+        void renderLightMeshes(Shader& shader, glm::mat4& view, glm::mat4& projection, Camera& camera);
+        void clearDirty();
+        bool isDirty();
+        GLuint getLightCount();
+        GLuint getLightCount(LightType type);
+        GLuint getLightIndex(LightHandle handle);
+        LightType getLightType(LightHandle handle);
+        glm::vec3 getLightPosition(LightHandle handle);
+        glm::vec3 getLightDirection(LightHandle handle);
+        glm::vec4 getLightColor(LightHandle handle);
+        float getLightRadius(LightHandle handle);
+        GLint getLightShadowLayer(LightHandle handle);
+        void setLightPosition(LightHandle handle, glm::vec3 position);
+        void setLightDirection(LightHandle handle, glm::vec3 direction);
+        void setLightColor(LightHandle handle, glm::vec4 color);
+        void setLightRadius(LightHandle handle, float radius);
+        void setLightShadowLayer(LightHandle handle, GLint shadowLayer);
+
+    private:
+        std::vector<GLuint> slotToIndex, slotGeneration, freeSlots;
+        std::vector<GLuint> indexToSlot;
+        Shape lightMesh;
+        GLuint lightPointBuffer = 0;
+        GLuint lightPointBufferCount = 0;
+        GLuint lightPointBufferCapacity = 0;
+        std::vector<GLfloat> lightPointBufferData;
+        GLuint clusterGridBuffer = 0;
+        GLuint clusterGridBufferSize = 0;
+        GLuint clusterIndexBuffer = 0;
+        GLuint clusterIndexBufferSize = 0;
+        LightBlock lightBlockData;
+        GLuint lightBlockBuffer = 0;
+        GLuint lightBlockDirtyBegin = 0;
+        GLuint lightBlockDirtyEnd = 0;
+        glm::mat4 lightBlockView;
+        glm::mat4 viewSpaceMatrix;
+        bool viewSpaceDirty = true;
+        bool lightMeshReady = false;
+        bool anyDirty = false;
+
+        LightHandle addLight(LightType type, glm::vec4 position, glm::vec4 color, float radius, bool isMesh);
+        void markDirty(GLuint index);
+        void markBlockRange(const void* member, GLuint size);
+};
+
+#endif
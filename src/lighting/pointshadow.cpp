@@ -0,0 +1,273 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "pointshadow.h"
+
+
+// Near plane of the cube faces, the far plane being the light radius
+const GLfloat pointShadowNear = 0.05f;
+
+// Cube face orientations, in the +X, -X, +Y, -Y, +Z, -Z layer order expected by the cube-map lookups
+const glm::vec3 pointShadowFaceDirection[6] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+                                                glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+const glm::vec3 pointShadowFaceUp[6] = { glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                                         glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f) };
+
+
+PointShadow::PointShadow()
+{
+
+}
+
+
+PointShadow::~PointShadow()
+{
+
+}
+
+
+// As many cubes as the budget allows (at least one), the layer count of the array being 6 times the cube count
+void PointShadow::setShadowMap(GLuint resolution, GLuint memoryBudget)
+{
+    GLint layerMax;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &layerMax);
+
+    GLuint cubeSize = resolution * resolution * 6 * 4;
+    GLuint cubeCount = std::max(1u, std::min(memoryBudget / cubeSize, std::min(slotMax, GLuint(layerMax) / 6)));
+
+    this->shadowResolution = resolution;
+    this->slotCount = cubeCount;
+
+    if (!this->shadowFBO)
+    {
+        glGenFramebuffers(1, &this->shadowFBO);
+        glGenTextures(1, &this->shadowCubeArray);
+    }
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, this->shadowCubeArray);
+    glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, cubeCount * 6, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+    // Layered attachment, gl_Layer picks the face written by each primitive
+    glBindFramebuffer(GL_FRAMEBUFFER, this->shadowFBO);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->shadowCubeArray, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Point Shadow Framebuffer not complete !" << std::endl;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // The previous assignments are dropped, the next updateLights() hands the cubes out again
+    this->slotLight.assign(cubeCount, LightHandle());
+    this->slotUsed.assign(cubeCount, 0);
+    this->slotDirty.assign(cubeCount, 1);
+    this->slotUpdated.assign(cubeCount, 0);
+    this->slotPosition.assign(cubeCount, glm::vec3(0.0f));
+    this->slotRadius.assign(cubeCount, 0.0f);
+}
+
+
+// The casters nearest to the camera get a cube, a light keeps the cube it already had so that its cached content stays usable.
+// Lights left without a cube are flagged as unshadowed in the light system
+void PointShadow::updateLights(LightSystem& lightSystem, const std::vector<LightHandle>& casters, glm::vec3 cameraPosition)
+{
+    std::vector<std::pair<GLfloat, GLuint>> casterDistances;
+
+    for (GLuint i = 0; i < casters.size(); ++i)
+    {
+        if (!lightSystem.isValid(casters[i]) || lightSystem.getLightType(casters[i]) != LIGHT_POINT)
+            continue;
+
+        glm::vec3 cameraOffset = lightSystem.getLightPosition(casters[i]) - cameraPosition;
+        casterDistances.push_back(std::make_pair(glm::dot(cameraOffset, cameraOffset), i));
+    }
+
+    std::sort(casterDistances.begin(), casterDistances.end());
+
+    GLuint shadowedCount = std::min(GLuint(casterDistances.size()), this->slotCount);
+    std::vector<GLubyte> slotKept(this->slotCount, 0);
+
+    for (GLuint i = 0; i < shadowedCount; ++i)
+    {
+        GLint slot = this->findSlot(casters[casterDistances[i].second]);
+
+        if (slot >= 0)
+            slotKept[slot] = 1;
+    }
+
+    // Cubes whose light is gone, or pushed out by nearer ones, are released
+    for (GLuint slot = 0; slot < this->slotCount; ++slot)
+    {
+        if (!this->slotUsed[slot] || slotKept[slot])
+            continue;
+
+        if (lightSystem.isValid(this->slotLight[slot]))
+            lightSystem.setLightShadowLayer(this->slotLight[slot], -1);
+
+        this->slotUsed[slot] = 0;
+    }
+
+    for (GLuint i = shadowedCount; i < casterDistances.size(); ++i)
+        lightSystem.setLightShadowLayer(casters[casterDistances[i].second], -1);
+
+    for (GLuint i = 0; i < shadowedCount; ++i)
+    {
+        LightHandle handle = casters[casterDistances[i].second];
+        GLint slot = this->findSlot(handle);
+
+        if (slot < 0)
+        {
+            slot = GLint(std::find(this->slotUsed.begin(), this->slotUsed.end(), 0) - this->slotUsed.begin());
+
+            this->slotLight[slot] = handle;
+            this->slotUsed[slot] = 1;
+            this->slotDirty[slot] = 1;
+        }
+
+        glm::vec3 lightPosition = lightSystem.getLightPosition(handle);
+        GLfloat lightRadius = lightSystem.getLightRadius(handle);
+
+        if (lightPosition != this->slotPosition[slot] || lightRadius != this->slotRadius[slot])
+        {
+            this->slotPosition[slot] = lightPosition;
+            this->slotRadius[slot] = lightRadius;
+            this->slotDirty[slot] = 1;
+        }
+
+        lightSystem.setLightShadowLayer(handle, slot);
+    }
+}
+
+
+void PointShadow::invalidateLights()
+{
+    std::fill(this->slotDirty.begin(), this->slotDirty.end(), 1);
+}
+
+
+// Marks the cubes whose light reaches a world-space sphere, typically the old and new bounds of a moving object
+void PointShadow::invalidateBounds(glm::vec3 center, GLfloat radius)
+{
+    for (GLuint slot = 0; slot < this->slotCount; ++slot)
+    {
+        if (this->slotUsed[slot] && glm::length(center - this->slotPosition[slot]) <= radius + this->slotRadius[slot])
+            this->slotDirty[slot] = 1;
+    }
+}
+
+
+// Returns false, and leaves the cube untouched, when the slot is free or its cached content is still valid.
+// Otherwise the 6 layers of the cube are cleared and the face matrices are handed to the layered depth shader
+bool PointShadow::beginSlot(GLuint slot, Shader& shader)
+{
+    this->slotUpdated[slot] = 0;
+
+    if (!this->slotUsed[slot] || !this->slotDirty[slot])
+        return false;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->shadowFBO);
+    glViewport(0, 0, this->shadowResolution, this->shadowResolution);
+
+    for (GLuint face = 0; face < 6; ++face)
+    {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->shadowCubeArray, 0, slot * 6 + face);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->shadowCubeArray, 0);
+
+    glm::vec3 lightPosition = this->slotPosition[slot];
+    glm::mat4 faceProjection = glm::perspective(glm::radians(90.0f), 1.0f, pointShadowNear, this->slotRadius[slot]);
+
+    shader.useShader();
+
+    for (GLuint face = 0; face < 6; ++face)
+    {
+        glm::mat4 faceMatrix = faceProjection * glm::lookAt(lightPosition, lightPosition + pointShadowFaceDirection[face], pointShadowFaceUp[face]);
+        std::string faceUniform = "shadowFaceMatrices[" + std::to_string(face) + "]";
+
+        glUniformMatrix4fv(glGetUniformLocation(shader.Program, faceUniform.c_str()), 1, GL_FALSE, glm::value_ptr(faceMatrix));
+    }
+
+    glUniform1i(glGetUniformLocation(shader.Program, "shadowCubeIndex"), slot);
+    glUniform3f(glGetUniformLocation(shader.Program, "lightPosition"), lightPosition.x, lightPosition.y, lightPosition.z);
+    glUniform1f(glGetUniformLocation(shader.Program, "lightRadius"), this->slotRadius[slot]);
+
+    return true;
+}
+
+
+void PointShadow::endSlot(GLuint slot)
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    this->slotDirty[slot] = 0;
+    this->slotUpdated[slot] = 1;
+}
+
+
+void PointShadow::useShadowMap()
+{
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, this->shadowCubeArray);
+}
+
+
+bool PointShadow::isSlotUpdated(GLuint slot)
+{
+    return this->slotUpdated[slot] != 0;
+}
+
+
+GLuint PointShadow::getSlotCount()
+{
+    return this->slotCount;
+}
+
+
+GLuint PointShadow::getUsedSlotCount()
+{
+    return GLuint(std::count(this->slotUsed.begin(), this->slotUsed.end(), 1));
+}
+
+
+GLuint PointShadow::getResolution()
+{
+    return this->shadowResolution;
+}
+
+
+GLuint PointShadow::getMemorySize()
+{
+    return this->shadowResolution * this->shadowResolution * 6 * 4 * this->slotCount;
+}
+
+
+GLint PointShadow::findSlot(LightHandle handle)
+{
+    for (GLuint slot = 0; slot < this->slotCount; ++slot)
+    {
+        if (this->slotUsed[slot] && this->slotLight[slot].handleSlot == handle.handleSlot && this->slotLight[slot].handleGeneration == handle.handleGeneration)
+            return slot;
+    }
+
+    return -1;
+}
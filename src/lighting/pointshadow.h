@@ -0,0 +1,59 @@
+#ifndef POINTSHADOW_H
+#define POINTSHADOW_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "shader.h"
+#include "lightsystem.h"
+
+
+// Omnidirectional shadows of the point lights, packed in a single depth cube-map array sized from a memory budget.
+// Each light renders its 6 faces in one pass (the geometry shader routes every triangle to the faces through gl_Layer),
+// and its cube is only re-rendered when the light itself, or something within its radius, has moved
+class PointShadow
+{
+    public:
+        static const GLuint slotMax = 32;
+
+        PointShadow();
+        ~PointShadow();
+        void setShadowMap(GLuint resolution, GLuint memoryBudget);
+        void updateLights(LightSystem& lightSystem, const std::vector<LightHandle>& casters, glm::vec3 cameraPosition);
+        void invalidateLights();
+        void invalidateBounds(glm::vec3 center, GLfloat radius);
+        bool beginSlot(GLuint slot, Shader& shader);
+        void endSlot(GLuint slot);
+        void useShadowMap();
+        bool isSlotUpdated(GLuint slot);
+        GLuint getSlotCount();
+        GLuint getUsedSlotCount();
+        GLuint getResolution();
+        GLuint getMemorySize();
+
+    private:
+        GLuint shadowFBO = 0;
+        GLuint shadowCubeArray = 0;
+        GLuint shadowResolution = 0;
+        GLuint slotCount = 0;
+
+        // Light owning each cube of the array, with the position and radius its cube was rendered with
+        std::vector<LightHandle> slotLight;
+        std::vector<GLubyte> slotUsed;
+        std::vector<GLubyte> slotDirty;
+        std::vector<GLubyte> slotUpdated;
+        std::vector<glm::vec3> slotPosition;
+        std::vector<GLfloat> slotRadius;
+
+        GLint findSlot(LightHandle handle);
+};
+
+#endif
@@ -53,6 +53,24 @@ void Model::Draw()
 }
 
 
+GLuint Model::getMeshCount()
+{
+    return this->meshes.size();
+}
+
+
+glm::vec3 Model::getBoundsMin()
+{
+    return this->boundsMin;
+}
+
+
+glm::vec3 Model::getBoundsMax()
+{
+    return this->boundsMax;
+}
+
+
 void Model::processNode(aiNode* node, const aiScene* scene)
 {
     for(GLuint i = 0; i < node->mNumMeshes; i++)
@@ -83,6 +101,10 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene)
         vector.z = mesh->mVertices[i].z;
         vertex.Position = vector;
 
+        // Model-space bounds, used to know which shadow maps a moving model touches
+        this->boundsMin = glm::min(this->boundsMin, vector);
+        this->boundsMax = glm::max(this->boundsMax, vector);
+
         vector.x = mesh->mNormals[i].x;
         vector.y = mesh->mNormals[i].y;
         vector.z = mesh->mNormals[i].z;
@@ -25,10 +25,15 @@ class Model
         ~Model();
         void loadModel(std::string path);
         void Draw();
+        GLuint getMeshCount();
+        glm::vec3 getBoundsMin();
+        glm::vec3 getBoundsMax();
 
     private:
         std::vector<Mesh> meshes;
         std::string directory;
+        glm::vec3 boundsMin = glm::vec3(1e30f);
+        glm::vec3 boundsMax = glm::vec3(-1e30f);
 
         void processNode(aiNode* node, const aiScene* scene);
         Mesh processMesh(aiMesh* mesh, const aiScene* scene);
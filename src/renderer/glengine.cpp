@@ -7,7 +7,16 @@
 #include "model.h"
 #include "shape.h"
 #include "texture.h"
-#include "light.h"
+#include "lightsystem.h"
+#include "clustergrid.h"
+#include "cascadedshadow.h"
+#include "pointshadow.h"
+#include "irradiancesh.h"
+#include "iblcache.h"
+#include "iblbakejob.h"
+#include "rendergraph.h"
+#include "gputimer.h"
+#include "profiler.h"
 #include "skybox.h"
 #include "material.h"
 
@@ -29,6 +38,7 @@
 #include <tuple>
 #include <cstdio>
 #include <cstdlib>
+#include <cmath>
 #include <iostream>
 #include <random>
 
@@ -49,10 +59,12 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 
 void cameraMove();
 void imGuiSetup();
-void gBufferSetup();
-void saoSetup();
-void postprocessSetup();
 void iblSetup();
+void samplersSetup();
+void lightsExtraSetup();
+void shadowInvalidateModel(glm::mat4& modelMatrix);
+void historySetup(GLuint historyTexture[2], GLuint width, GLuint height, GLenum format);
+GLuint gBufferPixelBytes(bool compactLayout, bool lightingRead);
 
 //---------------------------------
 // Variables & objects declarations
@@ -62,30 +74,50 @@ GLuint WIDTH = 1280;
 GLuint HEIGHT = 720;
 
 GLuint screenQuadVAO, screenQuadVBO;
-GLuint gBuffer, zBuffer, gPosition, gNormal, gAlbedo, gEffects;
-GLuint saoFBO, saoBlurFBO, saoBuffer, saoBlurBuffer;
-GLuint postprocessFBO, postprocessBuffer;
-GLuint envToCubeFBO, irradianceFBO, prefilterFBO, brdfLUTFBO, envToCubeRBO, irradianceRBO, prefilterRBO, brdfLUTRBO;
+GLuint envToCubeFBO, prefilterFBO, brdfLUTFBO, envToCubeRBO, prefilterRBO, brdfLUTRBO;
+GLuint taaHistoryTexture[2] = { 0, 0 };    // Ping-ponged, the resolved frame of one being the history of the next
+GLuint taaHistoryIndex = 0;
+GLuint taaHistoryWidth = 0;
+GLuint taaHistoryHeight = 0;
+GLenum taaHistoryFormat = GL_NONE;
+GLuint saoHistoryTexture[2] = { 0, 0 };
+GLuint saoHistoryIndex = 0;
+GLuint saoHistoryWidth = 0;
+GLuint saoHistoryHeight = 0;
+GLenum saoHistoryFormat = GL_NONE;
+GLuint saoTemporalFrame = 0;
 
 GLint gBufferView = 1;
 GLint tonemappingMode = 1;
 GLint lightDebugMode = 3;
 GLint attenuationMode = 2;
+GLint lightingMode = 1;
+GLint lightPointExtraCount = 0;
 GLint saoSamples = 12;
 GLint saoTurns = 7;
-GLint saoBlurSize = 4;
+GLint saoBlurSize = 4;     // Radius of the separable blur, 2 * saoBlurSize + 1 taps per axis
+GLint saoTemporalSamples = 3;     // Taps per frame in temporal mode, the saoSamples pattern being covered over several frames
+GLint saoSampleStride = 1;     // Frames covering the saoSamples pattern, one tap out of saoSampleStride being taken per frame
+GLint saoResolution = 0;     // Pyramid level the SAO and its blur run at : full, half or quarter resolution
+GLuint saoPyramidLevels = 5;     // Enough for the widest taps, the SAO picks a level from the tap distance
 GLint motionBlurMaxSamples = 32;
+GLint targetFormatPreset = 0;     // Column of the format table : reference, balanced or compact
+GLint profilerCaptureFrames = 10;
+GLint profilerZone = 0;
+GLint shadowResolution = 1024;
+GLint shadowCascadeCount = 4;
+GLuint cascadeDrawCount[CascadedShadow::cascadeMax] = { 0 };
+GLint pointShadowResolution = 512;
+GLint pointShadowBudget = 32;   // MB
+GLuint pointShadowRenderedCount = 0;
+GLuint iblPrefilterMips = 5;
+GLuint iblSampleCount = 1024;   // numSamples of prefilterIBL.frag and integrateIBL.frag, part of the cache key
 
 GLfloat lastX = WIDTH / 2;
 GLfloat lastY = HEIGHT / 2;
 GLfloat deltaTime = 0.0f;
 GLfloat lastFrame = 0.0f;
-GLfloat deltaGeometryTime = 0.0f;
-GLfloat deltaLightingTime = 0.0f;
-GLfloat deltaSAOTime = 0.0f;
-GLfloat deltaPostprocessTime = 0.0f;
-GLfloat deltaForwardTime = 0.0f;
-GLfloat deltaGUITime = 0.0f;
+GLfloat deltaIBLSetupTime = 0.0f;
 GLfloat materialRoughness = 0.01f;
 GLfloat materialMetallicity = 0.02f;
 GLfloat ambientIntensity = 0.005f;
@@ -93,6 +125,11 @@ GLfloat saoRadius = 0.3f;
 GLfloat saoBias = 0.001f;
 GLfloat saoScale = 0.7f;
 GLfloat saoContrast = 0.8f;
+GLfloat saoBlurSharpness = 16.0f;
+GLfloat saoTemporalFeedback = 0.1f;
+GLfloat saoTemporalDepthThreshold = 0.05f;     // Relative depth change past which the history is rejected
+GLfloat saoUpsampleDepthSharpness = 32.0f;
+GLfloat saoUpsampleNormalSharpness = 8.0f;
 GLfloat lightPointRadius1 = 3.0f;
 GLfloat lightPointRadius2 = 3.0f;
 GLfloat lightPointRadius3 = 3.0f;
@@ -100,14 +137,41 @@ GLfloat cameraAperture = 16.0f;
 GLfloat cameraShutterSpeed = 0.5f;
 GLfloat cameraISO = 1000.0f;
 GLfloat modelRotationSpeed = 0.0f;
+GLfloat forwardOpacity = 0.5f;
+GLfloat shadowDistance = 30.0f;
+GLfloat shadowSplitLambda = 0.75f;
+GLfloat shadowBias = 0.0005f;
+GLfloat pointShadowBias = 0.01f;
+GLfloat iblBakeBudget = 2.0f;   // ms of GPU time per frame for environment map switches
+GLfloat renderScale = 1.0f;     // Internal resolution of the scene passes, relative to the window
+GLfloat renderScaleMin = 0.5f;
+GLfloat renderScaleGoal = 1.0f;     // Unsnapped scale tracked by the dynamic resolution controller
+GLfloat dynamicResolutionBudget = 16.0f;    // ms of GPU time per frame
+GLfloat upscaleSharpness = 1.0f;
+GLfloat taaFeedback = 0.1f;     // Weight of the current frame once the history is accepted
+GLfloat taaClipGamma = 1.0f;    // Standard deviations of the neighbourhood color box
 
 bool cameraMode;
 bool pointMode = false;
 bool directionalMode = false;
 bool iblMode = true;
+bool gBufferCompactMode = false;
 bool saoMode = false;
-bool fxaaMode = false;
+bool saoComputeMode = false;
+bool saoTemporalMode = false;
+bool saoHistoryValid = false;
+bool clusteredMode = false;
+bool clusterDebugMode = false;
+bool shadowMode = true;
+bool cascadeQueried[CascadedShadow::cascadeMax] = { false };
+bool pointShadowMode = true;
+bool iblCacheHit = false;
+bool iblLUTReady = false;
+bool taaMode = false;
+bool taaHistoryValid = false;
 bool motionBlurMode = false;
+bool dynamicResolutionMode = false;
+bool profilerMode = true;
 bool screenMode = false;
 bool firstMouse = true;
 bool guiIsOpen = true;
@@ -126,9 +190,11 @@ glm::vec3 lightDirectionalColor1 = glm::vec3(1.0f);
 glm::vec3 modelPosition = glm::vec3(0.0f);
 glm::vec3 modelRotationAxis = glm::vec3(0.0f, 1.0f, 0.0f);
 glm::vec3 modelScale = glm::vec3(0.1f);
+glm::vec3 forwardSpherePosition = glm::vec3(0.0f, 1.0f, 1.5f);
 
 glm::mat4 projViewModel;
 glm::mat4 prevProjViewModel = projViewModel;
+glm::mat4 shadowPrevModel;
 glm::mat4 envMapProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
 glm::mat4 envMapView[] =
 {
@@ -146,12 +212,25 @@ Shader gBufferShader;
 Shader latlongToCubeShader;
 Shader simpleShader;
 Shader lightingBRDFShader;
-Shader irradianceIBLShader;
+Shader lightingTiledShader;
+Shader lightingPointShader;
+Shader lightingStencilShader;
+Shader clusteredForwardShader;
+Shader shadowDepthShader;
+Shader pointShadowDepthShader;
 Shader prefilterIBLShader;
 Shader integrateIBLShader;
 Shader firstpassPPShader;
+Shader upscaleShader;
+Shader taaShader;
+Shader velocityTileMaxShader;
+Shader velocityNeighborMaxShader;
 Shader saoShader;
+Shader saoComputeShader;
+Shader saoPyramidShader;
 Shader saoBlurShader;
+Shader saoTemporalShader;
+Shader saoUpsampleShader;
 
 Texture objectAlbedo;
 Texture objectNormal;
@@ -160,7 +239,6 @@ Texture objectMetalness;
 Texture objectAO;
 Texture envMapHDR;
 Texture envMapCube;
-Texture envMapIrradiance;
 Texture envMapPrefilter;
 Texture envMapLUT;
 
@@ -168,12 +246,65 @@ Material pbrMat;
 
 Model objectModel;
 
-Light lightPoint1;
-Light lightPoint2;
-Light lightPoint3;
-Light lightDirectional1;
+LightSystem lightSystem;
+ClusterGrid clusterGrid;
+CascadedShadow cascadedShadow;
+PointShadow pointShadow;
+IrradianceSH irradianceSH;
+IBLCache iblCache;
+IBLBakeJob iblBakeJob;
+RenderGraph renderGraph;
+
+GPUTimer geometryTimer;
+GPUTimer lightingTimer;
+GPUTimer saoTimer[2][3];     // Fragment and compute paths at full, half and quarter resolution, timed apart to compare them side by side
+GPUTimer taaTimer;
+GPUTimer upscaleTimer;
+GPUTimer velocityTileTimer;
+GPUTimer postprocessTimer;
+GPUTimer forwardTimer;
+GPUTimer guiTimer;
+GPUTimer shadowTimer;
+GPUTimer cascadeTimer[CascadedShadow::cascadeMax];
+GPUTimer pointShadowTimer;
+
+LightHandle lightPoint1;
+LightHandle lightPoint2;
+LightHandle lightPoint3;
+LightHandle lightDirectional1;
+
+std::vector<LightHandle> lightPointExtraList;
+std::vector<LightHandle> lightPointShadowList;
+
+// Format of every render target, per format preset. The compact preset stores the HDR color in R11G11B10F (no alpha, no negative values,
+// 6 bits of mantissa on red and green), the rows with a single format being tied to an image qualifier, a shader encoding or a blit
+std::vector<RenderFormat> targetFormats =
+{
+    { "Backbuffer", { GL_RGBA8 } },
+    { "Depth", { GL_DEPTH24_STENCIL8 } },     // Blitted to the default framebuffer, the formats have to match
+    { "Albedo", { GL_RGBA8 } },
+    { "Normal", { GL_RGBA16F } },
+    { "Normal (Compact)", { GL_RG16 } },     // Octahedral encoding, read back as UNORM bits
+    { "Effects", { GL_RGB16F } },
+    { "Effects (Compact)", { GL_RG16F } },
+    { "Position", { GL_RGBA16F } },
+    { "SAO Z Pyramid", { GL_R32F } },     // Image qualifiers of saoDepthPyramid.comp
+    { "SAO", { GL_RG16F } },     // Image qualifier of sao.comp
+    { "SAO History", { GL_RGBA16F } },     // Depth kept along the AO for the disocclusion test
+    { "SAO Blur X", { GL_RG16F } },
+    { "SAO Blur", { GL_R8 } },
+    { "SAO Upsample", { GL_R8 } },
+    { "Lighting", { GL_RGBA32F, GL_RGBA16F, GL_R11F_G11F_B10F } },
+    { "Lighting (Tiled)", { GL_RGBA32F } },     // Image qualifier of lightingTiled.comp
+    { "TAA History", { GL_RGBA16F, GL_RGBA16F, GL_R11F_G11F_B10F } },
+    { "Velocity Tile Max", { GL_RG16F } },     // Image qualifiers of the velocity tile shaders
+    { "Velocity Neighbor Max", { GL_RG16F } },
+    { "Upscale", { GL_RGBA32F, GL_RGBA16F, GL_R11F_G11F_B10F } },
+};
 
 Shape quadRender;
+Shape sphereRender;
+Shape forwardSphereRender;
 Shape envCubeRender;
 
 
@@ -182,7 +313,7 @@ int main(int argc, char* argv[])
     glfwInit();
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);   // Compute shaders
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
 
@@ -223,17 +354,30 @@ int main(int argc, char* argv[])
     // Shader(s)
     //----------
     gBufferShader.setShader("resources/shaders/gBuffer.vert", "resources/shaders/gBuffer.frag");
+    shadowDepthShader.setShader("resources/shaders/shadowDepth.vert", "resources/shaders/shadowDepth.frag");
+    pointShadowDepthShader.setShader("resources/shaders/pointShadowDepth.vert", "resources/shaders/pointShadowDepth.geom", "resources/shaders/pointShadowDepth.frag");
     latlongToCubeShader.setShader("resources/shaders/latlongToCube.vert", "resources/shaders/latlongToCube.frag");
 
     simpleShader.setShader("resources/shaders/lighting/simple.vert", "resources/shaders/lighting/simple.frag");
     lightingBRDFShader.setShader("resources/shaders/lighting/lightingBRDF.vert", "resources/shaders/lighting/lightingBRDF.frag");
-    irradianceIBLShader.setShader("resources/shaders/lighting/irradianceIBL.vert", "resources/shaders/lighting/irradianceIBL.frag");
+    lightingTiledShader.setShader("resources/shaders/lighting/lightingTiled.comp");
+    lightingPointShader.setShader("resources/shaders/lighting/point.vert", "resources/shaders/lighting/point.frag");
+    lightingStencilShader.setShader("resources/shaders/lighting/point.vert", "resources/shaders/lighting/simple.frag");
+    clusteredForwardShader.setShader("resources/shaders/lighting/clusteredForward.vert", "resources/shaders/lighting/clusteredForward.frag");
     prefilterIBLShader.setShader("resources/shaders/lighting/prefilterIBL.vert", "resources/shaders/lighting/prefilterIBL.frag");
     integrateIBLShader.setShader("resources/shaders/lighting/integrateIBL.vert", "resources/shaders/lighting/integrateIBL.frag");
 
     firstpassPPShader.setShader("resources/shaders/postprocess/postprocess.vert", "resources/shaders/postprocess/firstpass.frag");
+    upscaleShader.setShader("resources/shaders/postprocess/postprocess.vert", "resources/shaders/postprocess/upscale.frag");
+    velocityTileMaxShader.setShader("resources/shaders/postprocess/velocityTileMax.comp");
+    velocityNeighborMaxShader.setShader("resources/shaders/postprocess/velocityNeighborMax.comp");
+    taaShader.setShader("resources/shaders/postprocess/postprocess.vert", "resources/shaders/postprocess/taa.frag");
     saoShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/sao.frag");
+    saoComputeShader.setShader("resources/shaders/postprocess/sao.comp");
+    saoPyramidShader.setShader("resources/shaders/postprocess/saoDepthPyramid.comp");
     saoBlurShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/saoBlur.frag");
+    saoTemporalShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/saoTemporal.frag");
+    saoUpsampleShader.setShader("resources/shaders/postprocess/sao.vert", "resources/shaders/postprocess/saoUpsample.frag");
 
 
     //-----------
@@ -248,7 +392,6 @@ int main(int argc, char* argv[])
     envMapHDR.setTextureHDR("resources/textures/hdr/appart.hdr", "appartHDR", true);
 
     envMapCube.setTextureCube(512, GL_RGB, GL_RGB16F, GL_FLOAT, GL_LINEAR_MIPMAP_LINEAR);
-    envMapIrradiance.setTextureCube(32, GL_RGB, GL_RGB16F, GL_FLOAT, GL_LINEAR);
     envMapPrefilter.setTextureCube(128, GL_RGB, GL_RGB16F, GL_FLOAT, GL_LINEAR_MIPMAP_LINEAR);
     envMapPrefilter.computeTexMipmap();
     envMapLUT.setTextureHDR(512, 512, GL_RG, GL_RG16F, GL_FLOAT, GL_LINEAR);
@@ -281,16 +424,24 @@ int main(int argc, char* argv[])
     //---------------
     envCubeRender.setShape("cube", glm::vec3(0.0f));
     quadRender.setShape("quad", glm::vec3(0.0f));
+    sphereRender.setShape("sphere", glm::vec3(0.0f));
+    forwardSphereRender.setShape("sphere", forwardSpherePosition);
+    forwardSphereRender.setShapeScale(glm::vec3(0.5f));
 
 
     //----------------
     // Light source(s)
     //----------------
-    lightPoint1.setLight(lightPointPosition1, glm::vec4(lightPointColor1, 1.0f), lightPointRadius1, true);
-    lightPoint2.setLight(lightPointPosition2, glm::vec4(lightPointColor2, 1.0f), lightPointRadius2, true);
-    lightPoint3.setLight(lightPointPosition3, glm::vec4(lightPointColor3, 1.0f), lightPointRadius3, true);
+    lightPoint1 = lightSystem.addPointLight(lightPointPosition1, glm::vec4(lightPointColor1, 1.0f), lightPointRadius1, true);
+    lightPoint2 = lightSystem.addPointLight(lightPointPosition2, glm::vec4(lightPointColor2, 1.0f), lightPointRadius2, true);
+    lightPoint3 = lightSystem.addPointLight(lightPointPosition3, glm::vec4(lightPointColor3, 1.0f), lightPointRadius3, true);
 
-    lightDirectional1.setLight(lightDirectionalDirection1, glm::vec4(lightDirectionalColor1, 1.0f));
+    lightDirectional1 = lightSystem.addDirectionalLight(lightDirectionalDirection1, glm::vec4(lightDirectionalColor1, 1.0f));
+
+    // Only the main point lights cast shadows, the extra ones would exhaust the cube budget for little visual gain
+    lightPointShadowList.push_back(lightPoint1);
+    lightPointShadowList.push_back(lightPoint2);
+    lightPointShadowList.push_back(lightPoint3);
 
 
     //-------
@@ -301,78 +452,58 @@ int main(int argc, char* argv[])
     //---------------------------------------------------------
     // Set the samplers for the lighting/post-processing passes
     //---------------------------------------------------------
-    lightingBRDFShader.useShader();
-    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gPosition"), 0);
-    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gAlbedo"), 1);
-    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gNormal"), 2);
-    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gEffects"), 3);
-    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "sao"), 4);
-    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "envMap"), 5);
-    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "envMapIrradiance"), 6);
-    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "envMapPrefilter"), 7);
-    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "envMapLUT"), 8);
-
-    saoShader.useShader();
-    glUniform1i(glGetUniformLocation(saoShader.Program, "gPosition"), 0);
-    glUniform1i(glGetUniformLocation(saoShader.Program, "gNormal"), 1);
-
-    firstpassPPShader.useShader();
-    glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "sao"), 1);
-    glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "gEffects"), 2);
-
-    latlongToCubeShader.useShader();
-    glUniform1i(glGetUniformLocation(latlongToCubeShader.Program, "envMap"), 0);
-
-    irradianceIBLShader.useShader();
-    glUniform1i(glGetUniformLocation(irradianceIBLShader.Program, "envMap"), 0);
-
-    prefilterIBLShader.useShader();
-    glUniform1i(glGetUniformLocation(prefilterIBLShader.Program, "envMap"), 0);
-
-
-    //---------------
-    // G-Buffer setup
-    //---------------
-    gBufferSetup();
-
-
-    //------------
-    // SAO setup
-    //------------
-    saoSetup();
+    samplersSetup();
 
 
     //---------------------
-    // Postprocessing setup
+    // Render target formats
     //---------------------
-    postprocessSetup();
+    renderGraph.setFormatTable(targetFormats);
+
+
+    //-------------------
+    // Shader hot-reload
+    //-------------------
+    Shader::startWatching();
 
 
     //----------
     // IBL setup
     //----------
     iblSetup();
+    iblBakeJob.setTargets(envMapCube.getTexWidth(), envMapPrefilter.getTexWidth(), iblPrefilterMips, iblSampleCount);
+
+
+    //-------------
+    // Shadow setup
+    //-------------
+    cascadedShadow.setShadowMap(shadowResolution);
+    pointShadow.setShadowMap(pointShadowResolution, pointShadowBudget * 1024 * 1024);
 
 
     //------------------------------
     // Queries setting for profiling
     //------------------------------
-    GLuint64 startGeometryTime, startLightingTime, startSAOTime, startPostprocessTime, startForwardTime, startGUITime;
-    GLuint64 stopGeometryTime, stopLightingTime, stopSAOTime, stopPostprocessTime, stopForwardTime, stopGUITime;
+    geometryTimer.setTimer();
+    lightingTimer.setTimer();
+    for (GLuint i = 0; i < 3; i++)
+    {
+        saoTimer[0][i].setTimer();
+        saoTimer[1][i].setTimer();
+    }
+    taaTimer.setTimer();
+    upscaleTimer.setTimer();
+    velocityTileTimer.setTimer();
+    postprocessTimer.setTimer();
+    forwardTimer.setTimer();
+    guiTimer.setTimer();
+    shadowTimer.setTimer();
+    pointShadowTimer.setTimer();
 
-    unsigned int queryIDGeometry[2];
-    unsigned int queryIDLighting[2];
-    unsigned int queryIDSAO[2];
-    unsigned int queryIDPostprocess[2];
-    unsigned int queryIDForward[2];
-    unsigned int queryIDGUI[2];
+    for (GLuint i = 0; i < CascadedShadow::cascadeMax; i++)
+        cascadeTimer[i].setTimer();
 
-    glGenQueries(2, queryIDGeometry);
-    glGenQueries(2, queryIDLighting);
-    glGenQueries(2, queryIDSAO);
-    glGenQueries(2, queryIDPostprocess);
-    glGenQueries(2, queryIDForward);
-    glGenQueries(2, queryIDGUI);
+    Profiler::setProfiler();
 
 
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -384,34 +515,45 @@ int main(int argc, char* argv[])
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        Profiler::beginFrame();
+
+        Profiler::beginZone("Events");
         glfwPollEvents();
         cameraMove();
+        Profiler::endZone();
+
+        // Swap in the shaders rebuilt since the last frame, their sampler units have to be set again
+        Profiler::beginZone("Shader Reload");
+
+        if (Shader::updateShaders())
+            samplersSetup();
+
+        Profiler::endZone();
+
+        // Environment map switch spread over frames, the bound IBL textures only change once the new set is complete
+        Profiler::beginZone("IBL Bake Job");
+        Profiler::beginGPUZone("IBL Bake Job");
+        iblBakeJob.updateJob(iblBakeBudget, latlongToCubeShader, prefilterIBLShader, envCubeRender, iblCache, envMapHDR, envMapCube, envMapPrefilter, irradianceSH);
+        Profiler::endGPUZone();
+        Profiler::endZone();
+        glViewport(0, 0, WIDTH, HEIGHT);
 
 
         //--------------
         // ImGui setting
         //--------------
+        Profiler::beginZone("ImGui Setup");
         imGuiSetup();
+        Profiler::endZone();
 
 
-        //------------------------
-        // Geometry Pass rendering
-        //------------------------
-        glQueryCounter(queryIDGeometry[0], GL_TIMESTAMP);
-        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
+        //---------------
         // Camera setting
+        //---------------
         glm::mat4 projection = glm::perspective(camera.cameraFOV, (float)WIDTH / (float)HEIGHT, 0.1f, 100.0f);
         glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 model;
 
-        // Model(s) rendering
-        gBufferShader.useShader();
-
-        glUniformMatrix4fv(glGetUniformLocation(gBufferShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-        glUniformMatrix4fv(glGetUniformLocation(gBufferShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(view));
-
         GLfloat rotationAngle = glfwGetTime() / 5.0f * modelRotationSpeed;
         model = glm::mat4();
         model = glm::translate(model, modelPosition);
@@ -420,268 +562,948 @@ int main(int argc, char* argv[])
 
         projViewModel = projection * view * model;
 
-        glUniformMatrix4fv(glGetUniformLocation(gBufferShader.Program, "projViewModel"), 1, GL_FALSE, glm::value_ptr(projViewModel));
-        glUniformMatrix4fv(glGetUniformLocation(gBufferShader.Program, "prevProjViewModel"), 1, GL_FALSE, glm::value_ptr(prevProjViewModel));
-        glUniformMatrix4fv(glGetUniformLocation(gBufferShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniform3f(glGetUniformLocation(gBufferShader.Program, "albedoColor"), albedoColor.r, albedoColor.g, albedoColor.b);
 
-        // Material
-        // pbrMat.renderToShader();
+        //----------------------
+        // Shadow Pass rendering
+        //----------------------
+        // The shadow maps persist and are cached across frames, so they stay outside of the render graph
+        Profiler::beginZone("Cascaded Shadows");
+        Profiler::beginGPUZone("Cascaded Shadows");
+        shadowTimer.beginTimer();
 
-        glActiveTexture(GL_TEXTURE0);
-        objectAlbedo.useTexture();
-        glUniform1i(glGetUniformLocation(gBufferShader.Program, "texAlbedo"), 0);
-        glActiveTexture(GL_TEXTURE1);
-        objectNormal.useTexture();
-        glUniform1i(glGetUniformLocation(gBufferShader.Program, "texNormal"), 1);
-        glActiveTexture(GL_TEXTURE2);
-        objectRoughness.useTexture();
-        glUniform1i(glGetUniformLocation(gBufferShader.Program, "texRoughness"), 2);
-        glActiveTexture(GL_TEXTURE3);
-        objectMetalness.useTexture();
-        glUniform1i(glGetUniformLocation(gBufferShader.Program, "texMetalness"), 3);
-        glActiveTexture(GL_TEXTURE4);
-        objectAO.useTexture();
-        glUniform1i(glGetUniformLocation(gBufferShader.Program, "texAO"), 4);
-
-        objectModel.Draw();
+        for (GLuint i = 0; i < CascadedShadow::cascadeMax; i++)
+        {
+            cascadeQueried[i] = false;
+            cascadeDrawCount[i] = 0;
+        }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glQueryCounter(queryIDGeometry[1], GL_TIMESTAMP);
+        // A moving model only invalidates the cascades and point light cubes covering its previous or new position
+        if (model != shadowPrevModel)
+        {
+            shadowInvalidateModel(shadowPrevModel);
+            shadowInvalidateModel(model);
+            shadowPrevModel = model;
+        }
 
-        prevProjViewModel = projViewModel;
+        if (directionalMode && shadowMode)
+        {
+            cascadedShadow.setCascadeCount(shadowCascadeCount);
+            cascadedShadow.updateCascades(view, camera.cameraFOV, (float)WIDTH / (float)HEIGHT, 0.1f, shadowDistance, shadowSplitLambda, lightDirectionalDirection1);
 
-        //---------------
-        // sao rendering
-        //---------------
-        glQueryCounter(queryIDSAO[0], GL_TIMESTAMP);
-        glBindFramebuffer(GL_FRAMEBUFFER, saoFBO);
-        glClear(GL_COLOR_BUFFER_BIT);
+            shadowDepthShader.useShader();
+            glUniformMatrix4fv(glGetUniformLocation(shadowDepthShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
 
-        if (saoMode)
+            for (GLuint i = 0; i < cascadedShadow.getCascadeCount(); i++)
+            {
+                if (!cascadedShadow.beginCascade(i))
+                    continue;
+
+                cascadeTimer[i].beginTimer();
+
+                glUniformMatrix4fv(glGetUniformLocation(shadowDepthShader.Program, "lightSpaceMatrix"), 1, GL_FALSE, glm::value_ptr(cascadedShadow.getCascadeMatrix(i)));
+                objectModel.Draw();
+                cascadeDrawCount[i] = objectModel.getMeshCount();
+
+                cascadedShadow.endCascade(i);
+
+                cascadeTimer[i].endTimer();
+                cascadeQueried[i] = true;
+            }
+
+            glViewport(0, 0, WIDTH, HEIGHT);
+        }
+
+        shadowTimer.endTimer();
+        Profiler::endGPUZone();
+        Profiler::endZone();
+
+        // Point light cubes, each one rendered in a single layered pass, and only when its light or its surroundings moved
+        Profiler::beginZone("Point Shadows");
+        Profiler::beginGPUZone("Point Shadows");
+        pointShadowTimer.beginTimer();
+
+        pointShadowRenderedCount = 0;
+
+        if (pointMode && pointShadowMode)
+        {
+            pointShadow.updateLights(lightSystem, lightPointShadowList, camera.cameraPosition);
+
+            pointShadowDepthShader.useShader();
+            glUniformMatrix4fv(glGetUniformLocation(pointShadowDepthShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+
+            for (GLuint i = 0; i < pointShadow.getSlotCount(); i++)
+            {
+                if (!pointShadow.beginSlot(i, pointShadowDepthShader))
+                    continue;
+
+                objectModel.Draw();
+
+                pointShadow.endSlot(i);
+                pointShadowRenderedCount++;
+            }
+
+            glViewport(0, 0, WIDTH, HEIGHT);
+        }
+
+        pointShadowTimer.endTimer();
+        Profiler::endGPUZone();
+        Profiler::endZone();
+
+        //-------------------
+        // Render graph setup
+        //-------------------
+        // Declared again every frame : the G-Buffer layout and the enabled effects decide which targets exist and which passes survive
+        Profiler::beginZone("Render Graph Setup");
+        renderGraph.beginGraph();
+        renderGraph.setFormatPreset(targetFormatPreset);
+
+        // The scene passes render at the internal resolution, which the upscale pass brings back to the window size
+        GLuint renderWidth = std::max(GLuint(WIDTH * renderScale + 0.5f), 1u);
+        GLuint renderHeight = std::max(GLuint(HEIGHT * renderScale + 0.5f), 1u);
+
+        // Sub-pixel jitter of the geometry only, the velocities and every reconstruction keep the unjittered projection.
+        // The TAA is left out of the G-Buffer views, and its history starts over once it has been off or resized
+        bool taaActive = taaMode && gBufferView == 1;
+
+        if (taaActive)
+            camera.updateJitter(renderWidth, renderHeight);
+        else
+        {
+            camera.resetJitter();
+            taaHistoryValid = false;
+        }
+
+        glm::mat4 jitteredProjection = camera.GetJitteredProjection(projection);
+
+        if (taaActive && (taaHistoryWidth != renderWidth || taaHistoryHeight != renderHeight || taaHistoryFormat != renderGraph.getFormat("TAA History")))
+        {
+            taaHistoryFormat = renderGraph.getFormat("TAA History");
+            historySetup(taaHistoryTexture, renderWidth, renderHeight, taaHistoryFormat);
+            taaHistoryWidth = renderWidth;
+            taaHistoryHeight = renderHeight;
+            taaHistoryValid = false;
+        }
+
+        GLuint backbufferTarget = renderGraph.importTarget("Backbuffer", 0, renderGraph.getFormat("Backbuffer"), WIDTH, HEIGHT);
+        GLuint depthTarget = renderGraph.createTarget("Depth", renderGraph.getFormat("Depth"), renderWidth, renderHeight);
+        GLuint albedoTarget = renderGraph.createTarget("Albedo", renderGraph.getFormat("Albedo"), renderWidth, renderHeight);
+        GLuint normalTarget = renderGraph.createTarget("Normal", renderGraph.getFormat(gBufferCompactMode ? "Normal (Compact)" : "Normal"), renderWidth, renderHeight);
+        GLuint effectsTarget = renderGraph.createTarget("Effects", renderGraph.getFormat(gBufferCompactMode ? "Effects (Compact)" : "Effects"), renderWidth, renderHeight);
+        GLuint positionTarget = gBufferCompactMode ? depthTarget : renderGraph.createTarget("Position", renderGraph.getFormat("Position"), renderWidth, renderHeight);
+        GLuint saoPyramidTarget = renderGraph.createTarget("SAO Z Pyramid", renderGraph.getFormat("SAO Z Pyramid"), renderWidth, renderHeight, saoPyramidLevels);
+        GLuint saoWidth = std::max(renderWidth >> saoResolution, 1u);
+        GLuint saoHeight = std::max(renderHeight >> saoResolution, 1u);
+        GLuint saoTarget = renderGraph.createTarget("SAO", renderGraph.getFormat("SAO"), saoWidth, saoHeight);
+
+        // Temporal SAO : a few taps per frame, accumulated into a history at the SAO resolution
+        bool saoTemporalActive = saoMode && saoTemporalMode;
+        saoSampleStride = saoTemporalActive ? std::max((saoSamples + saoTemporalSamples - 1) / std::max(saoTemporalSamples, 1), 1) : 1;
+
+        if (!saoTemporalActive)
+            saoHistoryValid = false;
+
+        if (saoTemporalActive && (saoHistoryWidth != saoWidth || saoHistoryHeight != saoHeight || saoHistoryFormat != renderGraph.getFormat("SAO History")))
+        {
+            saoHistoryFormat = renderGraph.getFormat("SAO History");
+            historySetup(saoHistoryTexture, saoWidth, saoHeight, saoHistoryFormat);
+            saoHistoryWidth = saoWidth;
+            saoHistoryHeight = saoHeight;
+            saoHistoryValid = false;
+        }
+
+        GLuint saoHistoryTarget = saoTemporalActive ? renderGraph.importTarget("SAO History", saoHistoryTexture[saoHistoryIndex ^ 1], saoHistoryFormat, saoWidth, saoHeight) : saoTarget;
+        GLuint saoTemporalTarget = saoTemporalActive ? renderGraph.importTarget("SAO Temporal", saoHistoryTexture[saoHistoryIndex], saoHistoryFormat, saoWidth, saoHeight) : saoTarget;
+        GLuint saoBlurXTarget = renderGraph.createTarget("SAO Blur X", renderGraph.getFormat("SAO Blur X"), saoWidth, saoHeight);
+        GLuint saoBlurTarget = renderGraph.createTarget("SAO Blur", renderGraph.getFormat("SAO Blur"), saoWidth, saoHeight);
+        GLuint saoOutputTarget = saoResolution ? renderGraph.createTarget("SAO Upsample", renderGraph.getFormat("SAO Upsample"), renderWidth, renderHeight) : saoBlurTarget;
+
+        // The tiled lighting accumulates through image loads and stores, its format follows the qualifier of the shader
+        bool lightingTiled = pointMode && lightingMode == 2 && gBufferView == 1;
+        GLuint lightingTarget = renderGraph.createTarget("Lighting", renderGraph.getFormat(lightingTiled ? "Lighting (Tiled)" : "Lighting"), renderWidth, renderHeight);
+        GLuint taaHistoryTarget = taaActive ? renderGraph.importTarget("TAA History", taaHistoryTexture[taaHistoryIndex ^ 1], taaHistoryFormat, renderWidth, renderHeight) : lightingTarget;
+        GLuint taaTarget = taaActive ? renderGraph.importTarget("TAA", taaHistoryTexture[taaHistoryIndex], taaHistoryFormat, renderWidth, renderHeight) : lightingTarget;
+        GLuint velocityTilesX = (renderWidth + 15) / 16;
+        GLuint velocityTilesY = (renderHeight + 15) / 16;
+        GLuint velocityTileMaxTarget = renderGraph.createTarget("Velocity Tile Max", renderGraph.getFormat("Velocity Tile Max"), velocityTilesX, velocityTilesY);
+        GLuint velocityNeighborMaxTarget = renderGraph.createTarget("Velocity Neighbor Max", renderGraph.getFormat("Velocity Neighbor Max"), velocityTilesX, velocityTilesY);
+        GLuint upscaleTarget = renderScale < 1.0f ? renderGraph.createTarget("Upscale", renderGraph.getFormat("Upscale"), WIDTH, HEIGHT) : taaTarget;
+
+        renderGraph.setOutput(backbufferTarget);
+
+
+        //--------------
+        // Geometry Pass
+        //--------------
+        // The compact layout has no position target, the depth buffer takes its place
+        GLuint geometryPass = renderGraph.addPass("Geometry", [&]()
+        {
+            geometryTimer.beginTimer();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+            // Model(s) rendering
+            gBufferShader.useShader();
+
+            glUniformMatrix4fv(glGetUniformLocation(gBufferShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(jitteredProjection));
+            glUniformMatrix4fv(glGetUniformLocation(gBufferShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(gBufferShader.Program, "projViewModel"), 1, GL_FALSE, glm::value_ptr(projViewModel));
+            glUniformMatrix4fv(glGetUniformLocation(gBufferShader.Program, "prevProjViewModel"), 1, GL_FALSE, glm::value_ptr(prevProjViewModel));
+            glUniformMatrix4fv(glGetUniformLocation(gBufferShader.Program, "model"), 1, GL_FALSE, glm::value_ptr(model));
+            glUniform3f(glGetUniformLocation(gBufferShader.Program, "albedoColor"), albedoColor.r, albedoColor.g, albedoColor.b);
+            glUniform1i(glGetUniformLocation(gBufferShader.Program, "gBufferCompact"), gBufferCompactMode);
+
+            // Material
+            // pbrMat.renderToShader();
+
+            glActiveTexture(GL_TEXTURE0);
+            objectAlbedo.useTexture();
+            glUniform1i(glGetUniformLocation(gBufferShader.Program, "texAlbedo"), 0);
+            glActiveTexture(GL_TEXTURE1);
+            objectNormal.useTexture();
+            glUniform1i(glGetUniformLocation(gBufferShader.Program, "texNormal"), 1);
+            glActiveTexture(GL_TEXTURE2);
+            objectRoughness.useTexture();
+            glUniform1i(glGetUniformLocation(gBufferShader.Program, "texRoughness"), 2);
+            glActiveTexture(GL_TEXTURE3);
+            objectMetalness.useTexture();
+            glUniform1i(glGetUniformLocation(gBufferShader.Program, "texMetalness"), 3);
+            glActiveTexture(GL_TEXTURE4);
+            objectAO.useTexture();
+            glUniform1i(glGetUniformLocation(gBufferShader.Program, "texAO"), 4);
+
+            objectModel.Draw();
+
+            geometryTimer.endTimer();
+        });
+
+        renderGraph.writeTarget(geometryPass, albedoTarget);
+        renderGraph.writeTarget(geometryPass, normalTarget);
+        renderGraph.writeTarget(geometryPass, effectsTarget);
+
+        if (!gBufferCompactMode)
+            renderGraph.writeTarget(geometryPass, positionTarget);
+
+        renderGraph.writeTarget(geometryPass, depthTarget);
+
+
+        //---------
+        // SAO Pass
+        //---------
+        // Culled along with its Z pyramid and its blur whenever no later pass reads the SAO
+        GLuint saoPyramidPass = renderGraph.addPass("SAO Z Pyramid", [&]()
+        {
+            saoTimer[saoComputeMode][saoResolution].beginTimer();
+
+            saoPyramidShader.useShader();
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(positionTarget));
+
+            glUniform1i(glGetUniformLocation(saoPyramidShader.Program, "gBufferCompact"), gBufferCompactMode);
+            glUniformMatrix4fv(glGetUniformLocation(saoPyramidShader.Program, "inverseProj"), 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
+
+            // Each level is built from the previous one, so every dispatch waits for the former one's image stores
+            GLuint saoPyramidTexture = renderGraph.getTexture(saoPyramidTarget);
+
+            for (GLuint level = 0; level < saoPyramidLevels; level++)
+            {
+                GLuint levelWidth = std::max(renderWidth >> level, 1u);
+                GLuint levelHeight = std::max(renderHeight >> level, 1u);
+
+                glUniform1i(glGetUniformLocation(saoPyramidShader.Program, "pyramidLevel"), level);
+                glBindImageTexture(0, saoPyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+                if (level)
+                    glBindImageTexture(1, saoPyramidTexture, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+
+                glDispatchCompute((levelWidth + 15) / 16, (levelHeight + 15) / 16, 1);
+                glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+            }
+        });
+
+        renderGraph.readTarget(saoPyramidPass, positionTarget);
+        renderGraph.writeImage(saoPyramidPass, saoPyramidTarget);
+
+        GLuint saoPass = renderGraph.addPass("SAO", [&]()
         {
             // SAO noisy texture
-            saoShader.useShader();
+            Shader& saoPassShader = saoComputeMode ? saoComputeShader : saoShader;
+            saoPassShader.useShader();
 
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, gPosition);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(saoPyramidTarget));
             glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, gNormal);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(normalTarget));
+
+            glUniform1i(glGetUniformLocation(saoPassShader.Program, "saoSamples"), saoSamples);
+            glUniform1i(glGetUniformLocation(saoPassShader.Program, "saoSampleStride"), saoSampleStride);
+            glUniform1i(glGetUniformLocation(saoPassShader.Program, "saoSamplePhase"), saoTemporalFrame % saoSampleStride);
+            glUniform1f(glGetUniformLocation(saoPassShader.Program, "saoRadius"), saoRadius);
+            glUniform1i(glGetUniformLocation(saoPassShader.Program, "saoTurns"), saoTurns);
+            glUniform1f(glGetUniformLocation(saoPassShader.Program, "saoBias"), saoBias);
+            glUniform1f(glGetUniformLocation(saoPassShader.Program, "saoScale"), saoScale);
+            glUniform1f(glGetUniformLocation(saoPassShader.Program, "saoContrast"), saoContrast);
+            glUniform1i(glGetUniformLocation(saoPassShader.Program, "viewportWidth"), saoWidth);
+            glUniform1i(glGetUniformLocation(saoPassShader.Program, "viewportHeight"), saoHeight);
+            glUniform1i(glGetUniformLocation(saoPassShader.Program, "gBufferCompact"), gBufferCompactMode);
+            glUniform1i(glGetUniformLocation(saoPassShader.Program, "saoLevel"), saoResolution);
+            glUniform4f(glGetUniformLocation(saoPassShader.Program, "projInfo"), -2.0f / (renderWidth * projection[0][0]), -2.0f / (renderHeight * projection[1][1]),
+                        (1.0f - projection[2][0]) / projection[0][0], (1.0f + projection[2][1]) / projection[1][1]);
+
+            if (saoComputeMode)
+            {
+                // 16x16 tiles, written straight into the SAO target
+                glBindImageTexture(0, renderGraph.getTexture(saoTarget), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+                glDispatchCompute((saoWidth + 15) / 16, (saoHeight + 15) / 16, 1);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+            }
+            else
+            {
+                quadRender.drawShape();
+            }
+        });
+
+        renderGraph.readTarget(saoPass, saoPyramidTarget);
+        renderGraph.readTarget(saoPass, normalTarget);
+
+        if (saoComputeMode)
+            renderGraph.writeImage(saoPass, saoTarget);
+        else
+            renderGraph.writeTarget(saoPass, saoTarget);
 
-            glUniform1i(glGetUniformLocation(saoShader.Program, "saoSamples"), saoSamples);
-            glUniform1f(glGetUniformLocation(saoShader.Program, "saoRadius"), saoRadius);
-            glUniform1i(glGetUniformLocation(saoShader.Program, "saoTurns"), saoTurns);
-            glUniform1f(glGetUniformLocation(saoShader.Program, "saoBias"), saoBias);
-            glUniform1f(glGetUniformLocation(saoShader.Program, "saoScale"), saoScale);
-            glUniform1f(glGetUniformLocation(saoShader.Program, "saoContrast"), saoContrast);
-            glUniform1i(glGetUniformLocation(saoShader.Program, "viewportWidth"), WIDTH);
-            glUniform1i(glGetUniformLocation(saoShader.Program, "viewportHeight"), HEIGHT);
+        if (saoTemporalActive)
+        {
+            GLuint saoTemporalPass = renderGraph.addPass("SAO Temporal", [&]()
+            {
+                saoTemporalShader.useShader();
+
+                glUniform1i(glGetUniformLocation(saoTemporalShader.Program, "gBufferCompact"), gBufferCompactMode);
+                glUniform1i(glGetUniformLocation(saoTemporalShader.Program, "saoHistoryValid"), saoHistoryValid);
+                glUniform1f(glGetUniformLocation(saoTemporalShader.Program, "saoTemporalFeedback"), saoTemporalFeedback);
+                glUniform1f(glGetUniformLocation(saoTemporalShader.Program, "saoTemporalDepthThreshold"), saoTemporalDepthThreshold);
+                glUniform1i(glGetUniformLocation(saoTemporalShader.Program, "saoTemporalFrames"), saoSampleStride);
+
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(saoTarget));
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(saoHistoryTarget));
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(effectsTarget));
+
+                quadRender.drawShape();
+            });
+
+            renderGraph.readTarget(saoTemporalPass, saoTarget);
+            renderGraph.readTarget(saoTemporalPass, saoHistoryTarget);
+            renderGraph.readTarget(saoTemporalPass, effectsTarget);
+            renderGraph.writeTarget(saoTemporalPass, saoTemporalTarget);
+        }
+
+        // Separable bilateral blur, horizontal then vertical, the second one dropping the packed depth
+        GLuint saoBlurXPass = renderGraph.addPass("SAO Blur X", [&]()
+        {
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            saoBlurShader.useShader();
+
+            glUniform1i(glGetUniformLocation(saoBlurShader.Program, "saoBlurSize"), saoBlurSize);
+            glUniform1f(glGetUniformLocation(saoBlurShader.Program, "saoBlurSharpness"), saoBlurSharpness);
+            glUniform2i(glGetUniformLocation(saoBlurShader.Program, "saoBlurAxis"), 1, 0);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(saoTemporalTarget));
 
             quadRender.drawShape();
+        });
 
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        renderGraph.readTarget(saoBlurXPass, saoTemporalTarget);
+        renderGraph.writeTarget(saoBlurXPass, saoBlurXTarget);
 
-            // SAO blur pass
-            glBindFramebuffer(GL_FRAMEBUFFER, saoBlurFBO);
+        GLuint saoBlurPass = renderGraph.addPass("SAO Blur", [&]()
+        {
             glClear(GL_COLOR_BUFFER_BIT);
 
             saoBlurShader.useShader();
 
             glUniform1i(glGetUniformLocation(saoBlurShader.Program, "saoBlurSize"), saoBlurSize);
+            glUniform1f(glGetUniformLocation(saoBlurShader.Program, "saoBlurSharpness"), saoBlurSharpness);
+            glUniform2i(glGetUniformLocation(saoBlurShader.Program, "saoBlurAxis"), 0, 1);
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, saoBuffer);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(saoBlurXTarget));
 
             quadRender.drawShape();
+
+            if (!saoResolution)
+                saoTimer[saoComputeMode][saoResolution].endTimer();
+        });
+
+        renderGraph.readTarget(saoBlurPass, saoBlurXTarget);
+        renderGraph.writeTarget(saoBlurPass, saoBlurTarget);
+
+        // Only declared below full resolution, back to the G-Buffer size guided by its depth and normals
+        if (saoResolution)
+        {
+            GLuint saoUpsamplePass = renderGraph.addPass("SAO Upsample", [&]()
+            {
+                glClear(GL_COLOR_BUFFER_BIT);
+
+                saoUpsampleShader.useShader();
+
+                glUniform1i(glGetUniformLocation(saoUpsampleShader.Program, "saoLevel"), saoResolution);
+                glUniform1i(glGetUniformLocation(saoUpsampleShader.Program, "gBufferCompact"), gBufferCompactMode);
+                glUniform1f(glGetUniformLocation(saoUpsampleShader.Program, "saoUpsampleDepthSharpness"), saoUpsampleDepthSharpness);
+                glUniform1f(glGetUniformLocation(saoUpsampleShader.Program, "saoUpsampleNormalSharpness"), saoUpsampleNormalSharpness);
+
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(saoBlurTarget));
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(saoPyramidTarget));
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(normalTarget));
+
+                quadRender.drawShape();
+
+                saoTimer[saoComputeMode][saoResolution].endTimer();
+            });
+
+            renderGraph.readTarget(saoUpsamplePass, saoBlurTarget);
+            renderGraph.readTarget(saoUpsamplePass, saoPyramidTarget);
+            renderGraph.readTarget(saoUpsamplePass, normalTarget);
+            renderGraph.writeTarget(saoUpsamplePass, saoOutputTarget);
         }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glQueryCounter(queryIDSAO[1], GL_TIMESTAMP);
 
+        //-----------------
+        // Depth Copy Pass
+        //-----------------
+        // The light volumes test against the G-Buffer depth-stencil attached to the lighting pass, which the compact layout also samples
+        // as its position : that pass reads a copy instead, sampling an attached image being a feedback loop
+        bool lightVolumes = pointMode && lightingMode == 3 && gBufferView == 1;
+        GLuint lightingPositionTarget = positionTarget;
 
-        //------------------------
-        // Lighting Pass rendering
-        //------------------------
-        glQueryCounter(queryIDLighting[0], GL_TIMESTAMP);
-        glBindFramebuffer(GL_FRAMEBUFFER, postprocessFBO);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (gBufferCompactMode && lightVolumes)
+        {
+            lightingPositionTarget = renderGraph.createTarget("Depth Copy", renderGraph.getFormat("Depth"), renderWidth, renderHeight);
 
-        lightingBRDFShader.useShader();
+            GLuint depthCopyPass = renderGraph.addPass("Depth Copy", [&]()
+            {
+                renderGraph.bindReadTarget(depthTarget);
+                glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, renderWidth, renderHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            });
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gAlbedo);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, gEffects);
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, saoBlurBuffer);
-        glActiveTexture(GL_TEXTURE5);
-        envMapHDR.useTexture();
-        glActiveTexture(GL_TEXTURE6);
-        envMapIrradiance.useTexture();
-        glActiveTexture(GL_TEXTURE7);
-        envMapPrefilter.useTexture();
-        glActiveTexture(GL_TEXTURE8);
-        envMapLUT.useTexture();
-
-        lightPoint1.setLightPosition(lightPointPosition1);
-        lightPoint2.setLightPosition(lightPointPosition2);
-        lightPoint3.setLightPosition(lightPointPosition3);
-        lightPoint1.setLightColor(glm::vec4(lightPointColor1, 1.0f));
-        lightPoint2.setLightColor(glm::vec4(lightPointColor2, 1.0f));
-        lightPoint3.setLightColor(glm::vec4(lightPointColor3, 1.0f));
-        lightPoint1.setLightRadius(lightPointRadius1);
-        lightPoint2.setLightRadius(lightPointRadius2);
-        lightPoint3.setLightRadius(lightPointRadius3);
-
-        for (int i = 0; i < Light::lightPointList.size(); i++)
+            renderGraph.readTarget(depthCopyPass, depthTarget);
+            renderGraph.writeTarget(depthCopyPass, lightingPositionTarget);
+        }
+
+
+        //--------------
+        // Lighting Pass
+        //--------------
+        // The depth-stencil is the G-Buffer one, only attached for the light volumes
+        GLuint lightingPass = renderGraph.addPass("Lighting", [&]()
+        {
+            lightingTimer.beginTimer();
+            glClear(GL_COLOR_BUFFER_BIT);
+            glDisable(GL_DEPTH_TEST);
+
+            lightingBRDFShader.useShader();
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(lightingPositionTarget));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(albedoTarget));
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(normalTarget));
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(effectsTarget));
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(saoOutputTarget));
+            glActiveTexture(GL_TEXTURE5);
+            envMapHDR.useTexture();
+            glActiveTexture(GL_TEXTURE7);
+            envMapPrefilter.useTexture();
+            glActiveTexture(GL_TEXTURE8);
+            envMapLUT.useTexture();
+            glActiveTexture(GL_TEXTURE9);
+            cascadedShadow.useShadowMap();
+            glActiveTexture(GL_TEXTURE10);
+            pointShadow.useShadowMap();
+
+            // Only the lights changed by the GUI or the shadow allocation are re-uploaded
+            Profiler::beginZone("Light Upload");
+            lightSystem.renderToUniformBuffer(view);
+            lightSystem.bindUniformBuffer(0);
+            lightSystem.clearDirty();
+            Profiler::endZone();
+            cascadedShadow.renderToShader(lightingBRDFShader, view);
+
+            glUniformMatrix4fv(glGetUniformLocation(lightingBRDFShader.Program, "inverseView"), 1, GL_FALSE, glm::value_ptr(glm::transpose(view)));
+            glUniformMatrix4fv(glGetUniformLocation(lightingBRDFShader.Program, "inverseProj"), 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
+            glUniformMatrix4fv(glGetUniformLocation(lightingBRDFShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniform1f(glGetUniformLocation(lightingBRDFShader.Program, "materialRoughness"), materialRoughness);
+            glUniform1f(glGetUniformLocation(lightingBRDFShader.Program, "materialMetallicity"), materialMetallicity);
+            glUniform3f(glGetUniformLocation(lightingBRDFShader.Program, "materialF0"), materialF0.r, materialF0.g, materialF0.b);
+            glUniform1f(glGetUniformLocation(lightingBRDFShader.Program, "ambientIntensity"), ambientIntensity);
+            glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gBufferView"), gBufferView);
+            glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gBufferCompact"), gBufferCompactMode);
+            glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "pointMode"), pointMode && lightingMode == 1);
+            glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "directionalMode"), directionalMode);
+            glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "shadowMode"), directionalMode && shadowMode);
+            glUniform1f(glGetUniformLocation(lightingBRDFShader.Program, "shadowBias"), shadowBias);
+            glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "pointShadowMode"), pointShadowMode);
+            glUniform1f(glGetUniformLocation(lightingBRDFShader.Program, "pointShadowBias"), pointShadowBias);
+            glUniform1f(glGetUniformLocation(lightingBRDFShader.Program, "pointShadowTexelSize"), 2.0f / pointShadow.getResolution());
+            glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "iblMode"), iblMode);
+            glUniform3fv(glGetUniformLocation(lightingBRDFShader.Program, "shIrradiance"), IrradianceSH::coefficientCount, irradianceSH.getCoefficients());
+            glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "attenuationMode"), attenuationMode);
+
+            quadRender.drawShape();
+
+            // Tiled deferred point lights, added on top of the fullscreen pass output
+            if (pointMode && lightingMode == 2)
+            {
+                lightSystem.renderToBuffer(view);
+                lightSystem.bindLightBuffer(0);
+
+                lightingTiledShader.useShader();
+
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(lightingPositionTarget));
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(albedoTarget));
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(normalTarget));
+                glActiveTexture(GL_TEXTURE3);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(effectsTarget));
+
+                glUniform1i(glGetUniformLocation(lightingTiledShader.Program, "lightPointCount"), lightSystem.getLightBufferCount());
+                glUniform1i(glGetUniformLocation(lightingTiledShader.Program, "attenuationMode"), attenuationMode);
+                glUniform1i(glGetUniformLocation(lightingTiledShader.Program, "viewportWidth"), renderWidth);
+                glUniform1i(glGetUniformLocation(lightingTiledShader.Program, "viewportHeight"), renderHeight);
+                glUniform3f(glGetUniformLocation(lightingTiledShader.Program, "materialF0"), materialF0.r, materialF0.g, materialF0.b);
+                glUniformMatrix4fv(glGetUniformLocation(lightingTiledShader.Program, "inverseProj"), 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
+                glUniform1i(glGetUniformLocation(lightingTiledShader.Program, "gBufferCompact"), gBufferCompactMode);
+
+                if (gBufferView == 1)
+                {
+                    glBindImageTexture(0, renderGraph.getTexture(lightingTarget), 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+                    glDispatchCompute((renderWidth + 15) / 16, (renderHeight + 15) / 16, 1);
+                    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+                }
+            }
+
+            // Light volumes : a bounding sphere per point light, only the pixels inside it are shaded
+            if (lightVolumes)
+            {
+                lightSystem.computeViewSpace(view);
+
+                lightingPointShader.useShader();
+                glUniformMatrix4fv(glGetUniformLocation(lightingPointShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+                glUniform2f(glGetUniformLocation(lightingPointShader.Program, "viewportSize"), (float)renderWidth, (float)renderHeight);
+                glUniform3f(glGetUniformLocation(lightingPointShader.Program, "materialF0"), materialF0.r, materialF0.g, materialF0.b);
+                glUniform1i(glGetUniformLocation(lightingPointShader.Program, "attenuationMode"), attenuationMode);
+                glUniformMatrix4fv(glGetUniformLocation(lightingPointShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+                glUniformMatrix4fv(glGetUniformLocation(lightingPointShader.Program, "inverseProj"), 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
+                glUniform1i(glGetUniformLocation(lightingPointShader.Program, "gBufferCompact"), gBufferCompactMode);
+                glUniform1i(glGetUniformLocation(lightingPointShader.Program, "pointShadowMode"), pointShadowMode);
+                glUniform1f(glGetUniformLocation(lightingPointShader.Program, "pointShadowBias"), pointShadowBias);
+                glUniform1f(glGetUniformLocation(lightingPointShader.Program, "pointShadowTexelSize"), 2.0f / pointShadow.getResolution());
+                GLint pointPositionLocation = glGetUniformLocation(lightingPointShader.Program, "lightPositionRadius");
+                GLint pointColorLocation = glGetUniformLocation(lightingPointShader.Program, "lightColor");
+                GLint pointShadowLayerLocation = glGetUniformLocation(lightingPointShader.Program, "lightShadowLayer");
+
+                lightingStencilShader.useShader();
+                glUniformMatrix4fv(glGetUniformLocation(lightingStencilShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+                GLint stencilPositionLocation = glGetUniformLocation(lightingStencilShader.Program, "lightPositionRadius");
+
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(lightingPositionTarget));
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(albedoTarget));
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(normalTarget));
+                glActiveTexture(GL_TEXTURE3);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(effectsTarget));
+
+                glEnable(GL_STENCIL_TEST);
+                glDepthMask(GL_FALSE);
+                glBlendEquation(GL_FUNC_ADD);
+                glBlendFunc(GL_ONE, GL_ONE);
+
+                for (GLuint i = 0; i < lightSystem.getLightCount(); i++)
+                {
+                    if (lightSystem.lightType[i] != LIGHT_POINT)
+                        continue;
+
+                    glm::vec4 lightPositionRadius = glm::vec4(lightSystem.lightViewX[i], lightSystem.lightViewY[i], lightSystem.lightViewZ[i], lightSystem.lightRadius[i]);
+
+                    // Stencil pass : the volume faces hidden by the scene mark the pixels, +1 for the back faces and -1 for the front ones,
+                    // so that only the geometry lying between both ends up with a non-zero value
+                    lightingStencilShader.useShader();
+                    glUniform4fv(stencilPositionLocation, 1, glm::value_ptr(lightPositionRadius));
+
+                    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                    glEnable(GL_DEPTH_TEST);
+                    glDisable(GL_CULL_FACE);
+                    glDisable(GL_BLEND);
+                    glStencilFunc(GL_ALWAYS, 0, 0);
+                    glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+                    glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+
+                    sphereRender.drawShape();
+
+                    // Lighting pass : back faces only, which still covers the volume when the camera is inside of it,
+                    // the marked pixels are reset on the way so the next light starts from a clean stencil
+                    lightingPointShader.useShader();
+                    glUniform4fv(pointPositionLocation, 1, glm::value_ptr(lightPositionRadius));
+                    glUniform4f(pointColorLocation, lightSystem.lightColorR[i], lightSystem.lightColorG[i], lightSystem.lightColorB[i], lightSystem.lightColorA[i]);
+                    glUniform1i(pointShadowLayerLocation, lightSystem.lightShadowLayer[i]);
+
+                    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                    glDisable(GL_DEPTH_TEST);
+                    glEnable(GL_CULL_FACE);
+                    glCullFace(GL_FRONT);
+                    glEnable(GL_BLEND);
+                    glStencilFunc(GL_NOTEQUAL, 0, 0xFF);
+                    glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+
+                    sphereRender.drawShape();
+                }
+
+                glCullFace(GL_BACK);
+                glDisable(GL_CULL_FACE);
+                glDisable(GL_BLEND);
+                glDisable(GL_STENCIL_TEST);
+                glDepthMask(GL_TRUE);
+            }
+
+            glEnable(GL_DEPTH_TEST);
+            lightingTimer.endTimer();
+        });
+
+        renderGraph.readTarget(lightingPass, lightingPositionTarget);
+        renderGraph.readTarget(lightingPass, albedoTarget);
+        renderGraph.readTarget(lightingPass, normalTarget);
+        renderGraph.readTarget(lightingPass, effectsTarget);
+
+        // The SAO is only shown by its G-Buffer view here, it is otherwise applied in the postprocess pass
+        if (saoMode && gBufferView == 8)
+            renderGraph.readTarget(lightingPass, saoOutputTarget);
+
+        renderGraph.writeTarget(lightingPass, lightingTarget);
+
+        if (lightVolumes)
+            renderGraph.writeTarget(lightingPass, depthTarget);
+
+
+        //---------
+        // TAA Pass
+        //---------
+        // Resolves into the history texture of this frame, which the next one reads back
+        if (taaActive)
         {
-            Light::lightPointList[i].renderToShader(lightingBRDFShader, camera);
+            GLuint taaPass = renderGraph.addPass("TAA", [&]()
+            {
+                taaTimer.beginTimer();
+
+                taaShader.useShader();
+                glUniform1i(glGetUniformLocation(taaShader.Program, "gBufferCompact"), gBufferCompactMode);
+                glUniform1i(glGetUniformLocation(taaShader.Program, "taaHistoryValid"), taaHistoryValid);
+                glUniform1f(glGetUniformLocation(taaShader.Program, "taaFeedback"), taaFeedback);
+                glUniform1f(glGetUniformLocation(taaShader.Program, "taaClipGamma"), taaClipGamma);
+
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(lightingTarget));
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(taaHistoryTarget));
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(effectsTarget));
+                glActiveTexture(GL_TEXTURE3);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(positionTarget));
+
+                quadRender.drawShape();
+
+                taaTimer.endTimer();
+            });
+
+            renderGraph.readTarget(taaPass, lightingTarget);
+            renderGraph.readTarget(taaPass, taaHistoryTarget);
+            renderGraph.readTarget(taaPass, effectsTarget);
+            renderGraph.readTarget(taaPass, positionTarget);
+            renderGraph.writeTarget(taaPass, taaTarget);
         }
 
-        lightDirectional1.setLightDirection(lightDirectionalDirection1);
-        lightDirectional1.setLightColor(glm::vec4(lightDirectionalColor1, 1.0f));
 
-        for (int i = 0; i < Light::lightDirectionalList.size(); i++)
+        //-------------
+        // Upscale Pass
+        //-------------
+        // Only declared below the window resolution
+        if (renderScale < 1.0f)
         {
-            Light::lightDirectionalList[i].renderToShader(lightingBRDFShader, camera);
+            GLuint upscalePass = renderGraph.addPass("Upscale", [&]()
+            {
+                upscaleTimer.beginTimer();
+
+                upscaleShader.useShader();
+                glUniform1f(glGetUniformLocation(upscaleShader.Program, "upscaleSharpness"), upscaleSharpness);
+
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(taaTarget));
+
+                quadRender.drawShape();
+
+                upscaleTimer.endTimer();
+            });
+
+            renderGraph.readTarget(upscalePass, taaTarget);
+            renderGraph.writeTarget(upscalePass, upscaleTarget);
         }
 
-        glUniformMatrix4fv(glGetUniformLocation(lightingBRDFShader.Program, "inverseView"), 1, GL_FALSE, glm::value_ptr(glm::transpose(view)));
-        glUniformMatrix4fv(glGetUniformLocation(lightingBRDFShader.Program, "inverseProj"), 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
-        glUniformMatrix4fv(glGetUniformLocation(lightingBRDFShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniform1f(glGetUniformLocation(lightingBRDFShader.Program, "materialRoughness"), materialRoughness);
-        glUniform1f(glGetUniformLocation(lightingBRDFShader.Program, "materialMetallicity"), materialMetallicity);
-        glUniform3f(glGetUniformLocation(lightingBRDFShader.Program, "materialF0"), materialF0.r, materialF0.g, materialF0.b);
-        glUniform1f(glGetUniformLocation(lightingBRDFShader.Program, "ambientIntensity"), ambientIntensity);
-        glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gBufferView"), gBufferView);
-        glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "pointMode"), pointMode);
-        glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "directionalMode"), directionalMode);
-        glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "iblMode"), iblMode);
-        glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "attenuationMode"), attenuationMode);
-
-        quadRender.drawShape();
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glQueryCounter(queryIDLighting[1], GL_TIMESTAMP);
-
-
-        //-------------------------------
-        // Post-processing Pass rendering
-        //-------------------------------
-        glQueryCounter(queryIDPostprocess[0], GL_TIMESTAMP);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        firstpassPPShader.useShader();
-        glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "gBufferView"), gBufferView);
-        glUniform2f(glGetUniformLocation(firstpassPPShader.Program, "screenTextureSize"), 1.0f / WIDTH, 1.0f / HEIGHT);
-        glUniform1f(glGetUniformLocation(firstpassPPShader.Program, "cameraAperture"), cameraAperture);
-        glUniform1f(glGetUniformLocation(firstpassPPShader.Program, "cameraShutterSpeed"), cameraShutterSpeed);
-        glUniform1f(glGetUniformLocation(firstpassPPShader.Program, "cameraISO"), cameraISO);
-        glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "saoMode"), saoMode);
-        glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "fxaaMode"), fxaaMode);
-        glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "motionBlurMode"), motionBlurMode);
-        glUniform1f(glGetUniformLocation(firstpassPPShader.Program, "motionBlurScale"), int(ImGui::GetIO().Framerate) / 60.0f);
-        glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "motionBlurMaxSamples"), motionBlurMaxSamples);
-        glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "tonemappingMode"), tonemappingMode);
+        //---------------------
+        // Velocity Tiles Pass
+        //---------------------
+        // Longest velocity of every 16x16 tile, then of its 3x3 neighbourhood, driving the motion blur gather
+        if (motionBlurMode)
+        {
+            GLuint velocityTilePass = renderGraph.addPass("Velocity Tiles", [&]()
+            {
+                velocityTileTimer.beginTimer();
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, postprocessBuffer);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, saoBlurBuffer);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, gEffects);
+                velocityTileMaxShader.useShader();
+                glUniform1i(glGetUniformLocation(velocityTileMaxShader.Program, "gBufferCompact"), gBufferCompactMode);
 
-        quadRender.drawShape();
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(effectsTarget));
+                glBindImageTexture(0, renderGraph.getTexture(velocityTileMaxTarget), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
 
-        glQueryCounter(queryIDPostprocess[1], GL_TIMESTAMP);
+                glDispatchCompute(velocityTilesX, velocityTilesY, 1);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
 
+                velocityNeighborMaxShader.useShader();
 
-        //-----------------------
-        // Forward Pass rendering
-        //-----------------------
-        glQueryCounter(queryIDForward[0], GL_TIMESTAMP);
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(velocityTileMaxTarget));
+                glBindImageTexture(0, renderGraph.getTexture(velocityNeighborMaxTarget), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
 
-        // Copy the depth informations from the Geometry Pass into the default framebuffer
-        glBlitFramebuffer(0, 0, WIDTH, HEIGHT, 0, 0, WIDTH, HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glDispatchCompute((velocityTilesX + 15) / 16, (velocityTilesY + 15) / 16, 1);
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+                velocityTileTimer.endTimer();
+            });
 
-        // Shape(s) rendering
-        if (pointMode)
+            renderGraph.readTarget(velocityTilePass, effectsTarget);
+            renderGraph.writeImage(velocityTilePass, velocityTileMaxTarget);
+            renderGraph.writeImage(velocityTilePass, velocityNeighborMaxTarget);
+        }
+
+
+        //------------------
+        // Postprocess Pass
+        //------------------
+        GLuint postprocessPass = renderGraph.addPass("Postprocess", [&]()
         {
-            simpleShader.useShader();
-            glUniformMatrix4fv(glGetUniformLocation(simpleShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-            glUniformMatrix4fv(glGetUniformLocation(simpleShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            postprocessTimer.beginTimer();
+            glClear(GL_COLOR_BUFFER_BIT);
 
-            for (int i = 0; i < Light::lightPointList.size(); i++)
-            {
-                glUniform4f(glGetUniformLocation(simpleShader.Program, "lightColor"), Light::lightPointList[i].getLightColor().r, Light::lightPointList[i].getLightColor().g, Light::lightPointList[i].getLightColor().b, Light::lightPointList[i].getLightColor().a);
+            firstpassPPShader.useShader();
+            glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "gBufferView"), gBufferView);
+            glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "gBufferCompact"), gBufferCompactMode);
+            glUniform1f(glGetUniformLocation(firstpassPPShader.Program, "cameraAperture"), cameraAperture);
+            glUniform1f(glGetUniformLocation(firstpassPPShader.Program, "cameraShutterSpeed"), cameraShutterSpeed);
+            glUniform1f(glGetUniformLocation(firstpassPPShader.Program, "cameraISO"), cameraISO);
+            glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "saoMode"), saoMode);
+            glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "motionBlurMode"), motionBlurMode);
+            glUniform1f(glGetUniformLocation(firstpassPPShader.Program, "motionBlurScale"), int(ImGui::GetIO().Framerate) / 60.0f);
+            glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "motionBlurMaxSamples"), motionBlurMaxSamples);
+            glUniform2f(glGetUniformLocation(firstpassPPShader.Program, "cameraClip"), 0.1f, 100.0f);
+            glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "tonemappingMode"), tonemappingMode);
 
-                if (Light::lightPointList[i].isMesh())
-                    Light::lightPointList[i].lightMesh.drawShape(simpleShader, view, projection, camera);
-            }
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(upscaleTarget));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(saoOutputTarget));
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(effectsTarget));
+            glActiveTexture(GL_TEXTURE3);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(positionTarget));
+            glActiveTexture(GL_TEXTURE4);
+            glBindTexture(GL_TEXTURE_2D, renderGraph.getTexture(velocityNeighborMaxTarget));
+
+            quadRender.drawShape();
+
+            postprocessTimer.endTimer();
+        });
+
+        renderGraph.readTarget(postprocessPass, upscaleTarget);
+
+        if (saoMode)
+            renderGraph.readTarget(postprocessPass, saoOutputTarget);
+
+        if (motionBlurMode)
+        {
+            renderGraph.readTarget(postprocessPass, effectsTarget);
+            renderGraph.readTarget(postprocessPass, positionTarget);
+            renderGraph.readTarget(postprocessPass, velocityNeighborMaxTarget);
         }
-        glQueryCounter(queryIDForward[1], GL_TIMESTAMP);
 
+        renderGraph.writeTarget(postprocessPass, backbufferTarget);
+
+
+        //-------------
+        // Forward Pass
+        //-------------
+        GLuint forwardPass = renderGraph.addPass("Forward", [&]()
+        {
+            forwardTimer.beginTimer();
+
+            // Copy the depth informations from the Geometry Pass into the default framebuffer
+            renderGraph.bindReadTarget(depthTarget);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, WIDTH, HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            // Shape(s) rendering
+            if (pointMode)
+                lightSystem.renderLightMeshes(simpleShader, view, projection, camera);
 
-        //----------------
-        // ImGui rendering
-        //----------------
-        glQueryCounter(queryIDGUI[0], GL_TIMESTAMP);
-        ImGui::Render();
-        glQueryCounter(queryIDGUI[1], GL_TIMESTAMP);
+            // Clustered forward+ : a translucent sphere lit by the point lights binned into the froxels
+            if (clusteredMode)
+            {
+                clusterGrid.setFrustum(projection, 0.1f, 100.0f);
+                lightSystem.renderToClusters(clusterGrid, view);
+                lightSystem.bindLightBuffer(0);
+                lightSystem.bindClusterBuffers(1, 2);
+
+                clusteredForwardShader.useShader();
+                glUniform1i(glGetUniformLocation(clusteredForwardShader.Program, "pointMode"), pointMode);
+                glUniform1i(glGetUniformLocation(clusteredForwardShader.Program, "clusterDebug"), clusterDebugMode);
+                glUniform1i(glGetUniformLocation(clusteredForwardShader.Program, "attenuationMode"), attenuationMode);
+                glUniform3ui(glGetUniformLocation(clusteredForwardShader.Program, "clusterGridSize"), clusterGrid.getTilesX(), clusterGrid.getTilesY(), clusterGrid.getSlices());
+                glUniform2f(glGetUniformLocation(clusteredForwardShader.Program, "clusterDepth"), clusterGrid.getZNear(), clusterGrid.getSlices() / std::log(clusterGrid.getZFar() / clusterGrid.getZNear()));
+                glUniform2f(glGetUniformLocation(clusteredForwardShader.Program, "viewportSize"), (float)WIDTH, (float)HEIGHT);
+                glUniform3f(glGetUniformLocation(clusteredForwardShader.Program, "albedoColor"), albedoColor.r, albedoColor.g, albedoColor.b);
+                glUniform3f(glGetUniformLocation(clusteredForwardShader.Program, "materialF0"), materialF0.r, materialF0.g, materialF0.b);
+                glUniform1f(glGetUniformLocation(clusteredForwardShader.Program, "materialRoughness"), materialRoughness);
+                glUniform1f(glGetUniformLocation(clusteredForwardShader.Program, "materialMetallicity"), materialMetallicity);
+                glUniform1f(glGetUniformLocation(clusteredForwardShader.Program, "materialOpacity"), forwardOpacity);
+                glUniform1f(glGetUniformLocation(clusteredForwardShader.Program, "ambientIntensity"), ambientIntensity);
+
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+                glEnable(GL_CULL_FACE);
+
+                forwardSphereRender.setShapePosition(forwardSpherePosition);
+                forwardSphereRender.drawShape(clusteredForwardShader, view, projection, camera);
+
+                glDisable(GL_CULL_FACE);
+                glDisable(GL_BLEND);
+            }
+            forwardTimer.endTimer();
+        });
+
+        renderGraph.readTarget(forwardPass, depthTarget);
+        renderGraph.writeTarget(forwardPass, backbufferTarget);
+
+
+        //---------
+        // GUI Pass
+        //---------
+        GLuint guiPass = renderGraph.addPass("GUI", [&]()
+        {
+            guiTimer.beginTimer();
+            ImGui::Render();
+            guiTimer.endTimer();
+        });
+
+        renderGraph.writeTarget(guiPass, backbufferTarget);
+
+
+        Profiler::endZone();
+
+
+        //-----------------------
+        // Render graph execution
+        //-----------------------
+        renderGraph.compileGraph();
+        renderGraph.executeGraph();
+
+        prevProjViewModel = projViewModel;
+
+        if (taaActive)
+        {
+            taaHistoryIndex ^= 1;
+            taaHistoryValid = true;
+        }
+
+        if (saoTemporalActive)
+        {
+            saoHistoryIndex ^= 1;
+            saoHistoryValid = true;
+            saoTemporalFrame++;
+        }
 
 
         //--------------
         // GPU profiling
         //--------------
-        GLint stopGeometryTimerAvailable = 0;
-        GLint stopLightingTimerAvailable = 0;
-        GLint stopSAOTimerAvailable = 0;
-        GLint stopPostprocessTimerAvailable = 0;
-        GLint stopForwardTimerAvailable = 0;
-        GLint stopGUITimerAvailable = 0;
-
-        while (!stopGeometryTimerAvailable && !stopLightingTimerAvailable && !stopSAOTimerAvailable && !stopPostprocessTimerAvailable && !stopForwardTimerAvailable && !stopGUITimerAvailable)
+        // Non-blocking, each timer only reads back the frames the GPU has already finished
+        geometryTimer.updateTimer();
+        lightingTimer.updateTimer();
+
+        for (GLuint i = 0; i < 3; i++)
         {
-            glGetQueryObjectiv(queryIDGeometry[1], GL_QUERY_RESULT_AVAILABLE, &stopGeometryTimerAvailable);
-            glGetQueryObjectiv(queryIDLighting[1], GL_QUERY_RESULT_AVAILABLE, &stopLightingTimerAvailable);
-            glGetQueryObjectiv(queryIDSAO[1], GL_QUERY_RESULT_AVAILABLE, &stopSAOTimerAvailable);
-            glGetQueryObjectiv(queryIDPostprocess[1], GL_QUERY_RESULT_AVAILABLE, &stopPostprocessTimerAvailable);
-            glGetQueryObjectiv(queryIDForward[1], GL_QUERY_RESULT_AVAILABLE, &stopForwardTimerAvailable);
-            glGetQueryObjectiv(queryIDGUI[1], GL_QUERY_RESULT_AVAILABLE, &stopGUITimerAvailable);
+            saoTimer[0][i].updateTimer();
+            saoTimer[1][i].updateTimer();
         }
 
-        glGetQueryObjectui64v(queryIDGeometry[0], GL_QUERY_RESULT, &startGeometryTime);
-        glGetQueryObjectui64v(queryIDGeometry[1], GL_QUERY_RESULT, &stopGeometryTime);
-        glGetQueryObjectui64v(queryIDLighting[0], GL_QUERY_RESULT, &startLightingTime);
-        glGetQueryObjectui64v(queryIDLighting[1], GL_QUERY_RESULT, &stopLightingTime);
-        glGetQueryObjectui64v(queryIDSAO[0], GL_QUERY_RESULT, &startSAOTime);
-        glGetQueryObjectui64v(queryIDSAO[1], GL_QUERY_RESULT, &stopSAOTime);
-        glGetQueryObjectui64v(queryIDPostprocess[0], GL_QUERY_RESULT, &startPostprocessTime);
-        glGetQueryObjectui64v(queryIDPostprocess[1], GL_QUERY_RESULT, &stopPostprocessTime);
-        glGetQueryObjectui64v(queryIDForward[0], GL_QUERY_RESULT, &startForwardTime);
-        glGetQueryObjectui64v(queryIDForward[1], GL_QUERY_RESULT, &stopForwardTime);
-        glGetQueryObjectui64v(queryIDGUI[0], GL_QUERY_RESULT, &startGUITime);
-        glGetQueryObjectui64v(queryIDGUI[1], GL_QUERY_RESULT, &stopGUITime);
-
-        deltaGeometryTime = (stopGeometryTime - startGeometryTime) / 1000000.0;
-        deltaLightingTime = (stopLightingTime - startLightingTime) / 1000000.0;
-        deltaSAOTime = (stopSAOTime - startSAOTime) / 1000000.0;
-        deltaPostprocessTime = (stopPostprocessTime - startPostprocessTime) / 1000000.0;
-        deltaForwardTime = (stopForwardTime - startForwardTime) / 1000000.0;
-        deltaGUITime = (stopGUITime - startGUITime) / 1000000.0;
+        taaTimer.updateTimer();
+        upscaleTimer.updateTimer();
+        velocityTileTimer.updateTimer();
+        postprocessTimer.updateTimer();
+        forwardTimer.updateTimer();
+        guiTimer.updateTimer();
+        shadowTimer.updateTimer();
+        pointShadowTimer.updateTimer();
+
+        for (GLuint i = 0; i < CascadedShadow::cascadeMax; i++)
+            cascadeTimer[i].updateTimer();
+
+
+        //-------------------
+        // Dynamic resolution
+        //-------------------
+        // The scene passes are taken as costing in proportion to their pixel count, the others as fixed : the scale moves towards
+        // what would fit them in the budget left, damped since the timings come in a few frames late. The applied scale is then
+        // snapped to 1/16 steps, only moving past half a step of hysteresis, so the graph only reallocates its targets on a step change
+        if (dynamicResolutionMode)
+        {
+            GLfloat scaledTime = geometryTimer.getTime() + lightingTimer.getTime() + (saoMode ? saoTimer[saoComputeMode][saoResolution].getTime() : 0.0f)
+                                 + (taaMode ? taaTimer.getTime() : 0.0f) + (motionBlurMode ? velocityTileTimer.getTime() : 0.0f);
+            GLfloat fixedTime = shadowTimer.getTime() + pointShadowTimer.getTime() + (renderScale < 1.0f ? upscaleTimer.getTime() : 0.0f) + postprocessTimer.getTime()
+                                + forwardTimer.getTime() + guiTimer.getTime();
 
+            if (scaledTime > 0.0f)
+            {
+                GLfloat scaleRatio = std::sqrt(std::max(dynamicResolutionBudget - fixedTime, 0.1f * scaledTime) / scaledTime);
+                renderScaleGoal = glm::clamp(renderScaleGoal * (1.0f + 0.1f * (scaleRatio - 1.0f)), renderScaleMin, 1.0f);
+            }
+
+            if (std::abs(renderScaleGoal - renderScale) > 0.75f / 16.0f)
+                renderScale = glm::clamp(std::round(renderScaleGoal * 16.0f) / 16.0f, renderScaleMin, 1.0f);
+        }
+        else
+            renderScaleGoal = renderScale;
+
+        Profiler::beginZone("Swap Buffers");
         glfwSwapBuffers(window);
+        Profiler::endZone();
+
+        Profiler::endFrame();
     }
 
     //---------
     // Cleaning
     //---------
+    Shader::stopWatching();
     ImGui_ImplGlfwGL3_Shutdown();
     glfwTerminate();
 
@@ -723,6 +1545,13 @@ void imGuiSetup()
             ImGui::TreePop();
         }
 
+        if (ImGui::TreeNode("G-Buffer"))
+        {
+            ImGui::Checkbox("Compact layout", &gBufferCompactMode);
+
+            ImGui::TreePop();
+        }
+
         if (ImGui::TreeNode("Lighting"))
         {
             if (ImGui::TreeNode("Mode"))
@@ -734,31 +1563,66 @@ void imGuiSetup()
                 ImGui::TreePop();
             }
 
+            if (ImGui::TreeNode("Point lights path"))
+            {
+                ImGui::RadioButton("Fullscreen", &lightingMode, 1);
+                ImGui::RadioButton("Tiled (compute)", &lightingMode, 2);
+                ImGui::RadioButton("Light volumes (stencil)", &lightingMode, 3);
+
+                if (ImGui::SliderInt("Extra lights", &lightPointExtraCount, 0, 10000))
+                    lightsExtraSetup();
+
+                ImGui::TreePop();
+            }
+
+            if (ImGui::TreeNode("Clustered forward+"))
+            {
+                ImGui::Checkbox("Forward sphere", &clusteredMode);
+                ImGui::Checkbox("Cluster heatmap", &clusterDebugMode);
+                ImGui::SliderFloat("Opacity", &forwardOpacity, 0.0f, 1.0f);
+                ImGui::SliderFloat3("Position", (float*)&forwardSpherePosition, -5.0f, 5.0f);
+
+                ImGui::Text("Clusters : %dx%dx%d", clusterGrid.getTilesX(), clusterGrid.getTilesY(), clusterGrid.getSlices());
+                ImGui::Text("Light indices : %d", (int)clusterGrid.clusterLightIndices.size());
+                ImGui::Text("CPU binning : %.4f ms (%d threads)", clusterGrid.getBinningTime(), clusterGrid.getBinningThreads());
+
+                ImGui::TreePop();
+            }
+
             if (ImGui::TreeNode("Point"))
             {
                 if (ImGui::TreeNode("Position"))
                 {
-                    ImGui::SliderFloat3("Point 1", (float*)&lightPointPosition1, -5.0f, 5.0f);
-                    ImGui::SliderFloat3("Point 2", (float*)&lightPointPosition2, -5.0f, 5.0f);
-                    ImGui::SliderFloat3("Point 3", (float*)&lightPointPosition3, -5.0f, 5.0f);
+                    if (ImGui::SliderFloat3("Point 1", (float*)&lightPointPosition1, -5.0f, 5.0f))
+                        lightSystem.setLightPosition(lightPoint1, lightPointPosition1);
+                    if (ImGui::SliderFloat3("Point 2", (float*)&lightPointPosition2, -5.0f, 5.0f))
+                        lightSystem.setLightPosition(lightPoint2, lightPointPosition2);
+                    if (ImGui::SliderFloat3("Point 3", (float*)&lightPointPosition3, -5.0f, 5.0f))
+                        lightSystem.setLightPosition(lightPoint3, lightPointPosition3);
 
                     ImGui::TreePop();
                 }
 
                 if (ImGui::TreeNode("Color"))
                 {
-                    ImGui::ColorEdit3("Point 1", (float*)&lightPointColor1);
-                    ImGui::ColorEdit3("Point 2", (float*)&lightPointColor2);
-                    ImGui::ColorEdit3("Point 3", (float*)&lightPointColor3);
+                    if (ImGui::ColorEdit3("Point 1", (float*)&lightPointColor1))
+                        lightSystem.setLightColor(lightPoint1, glm::vec4(lightPointColor1, 1.0f));
+                    if (ImGui::ColorEdit3("Point 2", (float*)&lightPointColor2))
+                        lightSystem.setLightColor(lightPoint2, glm::vec4(lightPointColor2, 1.0f));
+                    if (ImGui::ColorEdit3("Point 3", (float*)&lightPointColor3))
+                        lightSystem.setLightColor(lightPoint3, glm::vec4(lightPointColor3, 1.0f));
 
                     ImGui::TreePop();
                 }
 
                 if (ImGui::TreeNode("Radius"))
                 {
-                    ImGui::SliderFloat("Point 1", &lightPointRadius1, 0.0f, 10.0f);
-                    ImGui::SliderFloat("Point 2", &lightPointRadius2, 0.0f, 10.0f);
-                    ImGui::SliderFloat("Point 3", &lightPointRadius3, 0.0f, 10.0f);
+                    if (ImGui::SliderFloat("Point 1", &lightPointRadius1, 0.0f, 10.0f))
+                        lightSystem.setLightRadius(lightPoint1, lightPointRadius1);
+                    if (ImGui::SliderFloat("Point 2", &lightPointRadius2, 0.0f, 10.0f))
+                        lightSystem.setLightRadius(lightPoint2, lightPointRadius2);
+                    if (ImGui::SliderFloat("Point 3", &lightPointRadius3, 0.0f, 10.0f))
+                        lightSystem.setLightRadius(lightPoint3, lightPointRadius3);
 
                     ImGui::TreePop();
                 }
@@ -771,6 +1635,24 @@ void imGuiSetup()
                     ImGui::TreePop();
                 }
 
+                if (ImGui::TreeNode("Shadows"))
+                {
+                    ImGui::Checkbox("Cube shadow maps", &pointShadowMode);
+                    ImGui::SliderFloat("Bias", &pointShadowBias, 0.0f, 0.05f, "%.4f");
+
+                    bool pointShadowChanged = ImGui::RadioButton("256", &pointShadowResolution, 256);
+                    pointShadowChanged |= ImGui::RadioButton("512", &pointShadowResolution, 512);
+                    pointShadowChanged |= ImGui::RadioButton("1024", &pointShadowResolution, 1024);
+                    pointShadowChanged |= ImGui::SliderInt("Budget (MB)", &pointShadowBudget, 4, 256);
+
+                    if (pointShadowChanged)
+                        pointShadow.setShadowMap(pointShadowResolution, pointShadowBudget * 1024 * 1024);
+
+                    ImGui::Text("%d cubes, %.1f MB", pointShadow.getSlotCount(), pointShadow.getMemorySize() / (1024.0f * 1024.0f));
+
+                    ImGui::TreePop();
+                }
+
                 ImGui::TreePop();
             }
 
@@ -778,14 +1660,34 @@ void imGuiSetup()
             {
                 if (ImGui::TreeNode("Direction"))
                 {
-                    ImGui::SliderFloat3("Direction 1", (float*)&lightDirectionalDirection1, -5.0f, 5.0f);
+                    if (ImGui::SliderFloat3("Direction 1", (float*)&lightDirectionalDirection1, -5.0f, 5.0f))
+                        lightSystem.setLightDirection(lightDirectional1, lightDirectionalDirection1);
 
                     ImGui::TreePop();
                 }
 
                 if (ImGui::TreeNode("Color"))
                 {
-                    ImGui::ColorEdit3("Direct. 1", (float*)&lightDirectionalColor1);
+                    if (ImGui::ColorEdit3("Direct. 1", (float*)&lightDirectionalColor1))
+                        lightSystem.setLightColor(lightDirectional1, glm::vec4(lightDirectionalColor1, 1.0f));
+
+                    ImGui::TreePop();
+                }
+
+                if (ImGui::TreeNode("Shadows"))
+                {
+                    ImGui::Checkbox("Cascaded shadow maps", &shadowMode);
+                    ImGui::SliderInt("Cascades", &shadowCascadeCount, 1, CascadedShadow::cascadeMax);
+                    ImGui::SliderFloat("Distance", &shadowDistance, 5.0f, 100.0f);
+                    ImGui::SliderFloat("Split lambda", &shadowSplitLambda, 0.0f, 1.0f);
+                    ImGui::SliderFloat("Bias", &shadowBias, 0.0f, 0.01f, "%.5f");
+
+                    bool shadowResolutionChanged = ImGui::RadioButton("512", &shadowResolution, 512);
+                    shadowResolutionChanged |= ImGui::RadioButton("1024", &shadowResolution, 1024);
+                    shadowResolutionChanged |= ImGui::RadioButton("2048", &shadowResolution, 2048);
+
+                    if (shadowResolutionChanged)
+                        cascadedShadow.setShadowMap(shadowResolution);
 
                     ImGui::TreePop();
                 }
@@ -797,40 +1699,39 @@ void imGuiSetup()
             {
                 if (ImGui::Button("Appartment"))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/appart.hdr", "appartHDR", true);
-                    iblSetup();
+                    iblBakeJob.requestEnvironment("resources/textures/hdr/appart.hdr", "appartHDR");
                 }
 
                 if (ImGui::Button("Pisa"))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/pisa.hdr", "pisaHDR", true);
-                    iblSetup();
+                    iblBakeJob.requestEnvironment("resources/textures/hdr/pisa.hdr", "pisaHDR");
                 }
 
                 if (ImGui::Button("Canyon"))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/canyon.hdr", "canyonHDR", true);
-                    iblSetup();
+                    iblBakeJob.requestEnvironment("resources/textures/hdr/canyon.hdr", "canyonHDR");
                 }
 
                 if (ImGui::Button("Loft"))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/loft.hdr", "loftHDR", true);
-                    iblSetup();
+                    iblBakeJob.requestEnvironment("resources/textures/hdr/loft.hdr", "loftHDR");
                 }
 
                 if (ImGui::Button("Path"))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/path.hdr", "pathHDR", true);
-                    iblSetup();
+                    iblBakeJob.requestEnvironment("resources/textures/hdr/path.hdr", "pathHDR");
                 }
 
                 if (ImGui::Button("Circus"))
                 {
-                    envMapHDR.setTextureHDR("resources/textures/hdr/circus.hdr", "circusHDR", true);
-                    iblSetup();
+                    iblBakeJob.requestEnvironment("resources/textures/hdr/circus.hdr", "circusHDR");
                 }
 
+                ImGui::SliderFloat("Bake Budget (ms)", &iblBakeBudget, 0.25f, 8.0f);
+
+                if (iblBakeJob.isBusy())
+                    ImGui::ProgressBar(iblBakeJob.getProgress(), ImVec2(-1.0f, 0.0f), iblBakeJob.getEnvironmentName().c_str());
+
                 ImGui::TreePop();
             }
 
@@ -842,21 +1743,47 @@ void imGuiSetup()
             if (ImGui::TreeNode("SAO"))
             {
                 ImGui::Checkbox("Enable", &saoMode);
+                ImGui::Checkbox("Compute Shader", &saoComputeMode);
 
                 ImGui::SliderInt("Samples", &saoSamples, 0, 64);
+                ImGui::Checkbox("Temporal", &saoTemporalMode);
+
+                if (saoTemporalMode)
+                {
+                    ImGui::SliderInt("Samples per Frame", &saoTemporalSamples, 1, 8);
+                    ImGui::SliderFloat("Temporal Feedback", &saoTemporalFeedback, 0.01f, 1.0f);
+                    ImGui::SliderFloat("Disocclusion", &saoTemporalDepthThreshold, 0.001f, 0.5f);
+                }
+
                 ImGui::SliderFloat("Radius", &saoRadius, 0.0f, 3.0f);
                 ImGui::SliderInt("Turns", &saoTurns, 0, 16);
                 ImGui::SliderFloat("Bias", &saoBias, 0.0f, 0.1f);
                 ImGui::SliderFloat("Scale", &saoScale, 0.0f, 3.0f);
                 ImGui::SliderFloat("Contrast", &saoContrast, 0.0f, 3.0f);
                 ImGui::SliderInt("Blur Size", &saoBlurSize, 0, 8);
+                ImGui::SliderFloat("Blur Sharpness", &saoBlurSharpness, 0.0f, 64.0f);
+
+                ImGui::Text("Resolution");
+                ImGui::RadioButton("Full", &saoResolution, 0);
+                ImGui::SameLine();
+                ImGui::RadioButton("Half", &saoResolution, 1);
+                ImGui::SameLine();
+                ImGui::RadioButton("Quarter", &saoResolution, 2);
+
+                if (saoResolution)
+                {
+                    ImGui::SliderFloat("Upsample Depth", &saoUpsampleDepthSharpness, 0.0f, 128.0f);
+                    ImGui::SliderFloat("Upsample Normal", &saoUpsampleNormalSharpness, 0.0f, 32.0f);
+                }
 
                 ImGui::TreePop();
             }
 
-            if (ImGui::TreeNode("FXAA"))
+            if (ImGui::TreeNode("TAA"))
             {
-                ImGui::Checkbox("Enable", &fxaaMode);
+                ImGui::Checkbox("Enable", &taaMode);
+                ImGui::SliderFloat("Feedback", &taaFeedback, 0.01f, 1.0f);
+                ImGui::SliderFloat("Clip Gamma", &taaClipGamma, 0.5f, 2.0f);
 
                 ImGui::TreePop();
             }
@@ -881,6 +1808,34 @@ void imGuiSetup()
             ImGui::TreePop();
         }
 
+        if (ImGui::TreeNode("Dynamic Resolution"))
+        {
+            ImGui::Checkbox("Enable", &dynamicResolutionMode);
+
+            if (dynamicResolutionMode)
+            {
+                ImGui::SliderFloat("GPU Budget (ms)", &dynamicResolutionBudget, 4.0f, 33.3f);
+                ImGui::SliderFloat("Min Scale", &renderScaleMin, 0.25f, 1.0f);
+            }
+            else
+                ImGui::SliderFloat("Scale", &renderScale, 0.25f, 1.0f);
+
+            ImGui::SliderFloat("Upscale Sharpness", &upscaleSharpness, 0.0f, 4.0f);
+
+            ImGui::TreePop();
+        }
+
+        if (ImGui::TreeNode("Render Targets"))
+        {
+            ImGui::RadioButton("Reference", &targetFormatPreset, 0);
+            ImGui::SameLine();
+            ImGui::RadioButton("Balanced", &targetFormatPreset, 1);
+            ImGui::SameLine();
+            ImGui::RadioButton("Compact", &targetFormatPreset, 2);
+
+            ImGui::TreePop();
+        }
+
         if (ImGui::TreeNode("Camera"))
         {
             ImGui::SliderFloat("Aperture", &cameraAperture, 1.0f, 32.0f);
@@ -902,6 +1857,8 @@ void imGuiSetup()
                 {
                     objectModel.~Model();
                     objectModel.loadModel("resources/models/sphere/sphere.obj");
+                    cascadedShadow.invalidateCascades();
+                    pointShadow.invalidateLights();
                     modelScale = glm::vec3(0.6f);
                 }
 
@@ -909,6 +1866,8 @@ void imGuiSetup()
                 {
                     objectModel.~Model();
                     objectModel.loadModel("resources/models/teapot/teapot.obj");
+                    cascadedShadow.invalidateCascades();
+                    pointShadow.invalidateLights();
                     modelScale = glm::vec3(0.6f);
                 }
 
@@ -916,6 +1875,8 @@ void imGuiSetup()
                 {
                     objectModel.~Model();
                     objectModel.loadModel("resources/models/shaderball/shaderball.obj");
+                    cascadedShadow.invalidateCascades();
+                    pointShadow.invalidateLights();
                     modelScale = glm::vec3(0.1f);
                 }
 
@@ -966,12 +1927,123 @@ void imGuiSetup()
 
     if (ImGui::CollapsingHeader("Profiling", 0, true, true))
     {
-        ImGui::Text("Geometry Pass :    %.4f ms", deltaGeometryTime);
-        ImGui::Text("Lighting Pass :    %.4f ms", deltaLightingTime);
-        ImGui::Text("SAO Pass :         %.4f ms", deltaSAOTime);
-        ImGui::Text("Postprocess Pass : %.4f ms", deltaPostprocessTime);
-        ImGui::Text("Forward Pass :     %.4f ms", deltaForwardTime);
-        ImGui::Text("GUI Pass :         %.4f ms", deltaGUITime);
+        // Rolling average over the last samples, then their min and max
+        ImGui::Text("Geometry Pass :    %.4f ms [%.4f - %.4f]", geometryTimer.getAverageTime(), geometryTimer.getMinTime(), geometryTimer.getMaxTime());
+        ImGui::Text("Lighting Pass :    %.4f ms [%.4f - %.4f]", lightingTimer.getAverageTime(), lightingTimer.getMinTime(), lightingTimer.getMaxTime());
+        ImGui::Text("    G-Buffer :     %d B/px written, %d B/px read (%+.1f MB/frame vs %s layout)", gBufferPixelBytes(gBufferCompactMode, false), gBufferPixelBytes(gBufferCompactMode, true),
+                    (GLfloat(gBufferPixelBytes(gBufferCompactMode, false) + gBufferPixelBytes(gBufferCompactMode, true)) - GLfloat(gBufferPixelBytes(!gBufferCompactMode, false) + gBufferPixelBytes(!gBufferCompactMode, true)))
+                    * GLuint(WIDTH * renderScale + 0.5f) * GLuint(HEIGHT * renderScale + 0.5f) / (1024.0f * 1024.0f),
+                    gBufferCompactMode ? "full" : "compact");
+        ImGui::Text("SAO Pass :         %.4f ms%s", saoMode ? saoTimer[saoComputeMode][saoResolution].getAverageTime() : 0.0f, saoMode ? "" : " (culled)");
+
+        if (saoMode && saoTemporalMode)
+            ImGui::Text("    Temporal :     %d taps per frame, %d samples over %d frames", (saoSamples + saoSampleStride - 1) / saoSampleStride, saoSamples, saoSampleStride);
+
+        ImGui::Text("    Fragment :     %.4f / %.4f / %.4f ms (full / half / quarter)", saoTimer[0][0].getAverageTime(), saoTimer[0][1].getAverageTime(), saoTimer[0][2].getAverageTime());
+        ImGui::Text("    Compute :      %.4f / %.4f / %.4f ms (full / half / quarter)", saoTimer[1][0].getAverageTime(), saoTimer[1][1].getAverageTime(), saoTimer[1][2].getAverageTime());
+        ImGui::Text("Shadow Pass :      %.4f ms [%.4f - %.4f]", shadowTimer.getAverageTime(), shadowTimer.getMinTime(), shadowTimer.getMaxTime());
+
+        for (GLuint i = 0; i < cascadedShadow.getCascadeCount(); i++)
+            ImGui::Text("    Cascade %d :    %.4f ms, %d draws%s", i, cascadeQueried[i] ? cascadeTimer[i].getAverageTime() : 0.0f, cascadeDrawCount[i], cascadeQueried[i] ? "" : " (cached)");
+
+        ImGui::Text("Point Shadows :    %.4f ms, %d rendered / %d cached", pointShadowTimer.getAverageTime(), pointShadowRenderedCount, pointShadow.getUsedSlotCount() - pointShadowRenderedCount);
+        ImGui::Text("SH Irradiance :    %.4f ms (CPU, %d threads, on env. map change)", irradianceSH.getComputeTime(), irradianceSH.getComputeThreads());
+        ImGui::Text("IBL Setup :        %.4f ms (cache %s)", deltaIBLSetupTime, iblCacheHit ? "hit" : "miss");
+
+        if (iblBakeJob.isBusy())
+            ImGui::Text("    IBL Bake :     %.4f ms estimated, %d steps, %.0f %%", iblBakeJob.getFrameEstimate(), iblBakeJob.getFrameSteps(), iblBakeJob.getProgress() * 100.0f);
+
+        ImGui::Text("TAA Pass :         %.4f ms%s", taaMode ? taaTimer.getAverageTime() : 0.0f, taaMode ? "" : " (culled)");
+        ImGui::Text("Upscale Pass :     %.4f ms, %d x %d (%.0f %%) to %d x %d%s", upscaleTimer.getAverageTime(), GLuint(WIDTH * renderScale + 0.5f), GLuint(HEIGHT * renderScale + 0.5f),
+                    renderScale * 100.0f, WIDTH, HEIGHT, renderScale < 1.0f ? "" : " (culled)");
+        ImGui::Text("Velocity Tiles :   %.4f ms, %d x %d tiles%s", velocityTileTimer.getAverageTime(), (GLuint(WIDTH * renderScale + 0.5f) + 15) / 16, (GLuint(HEIGHT * renderScale + 0.5f) + 15) / 16,
+                    motionBlurMode ? "" : " (culled)");
+        ImGui::Text("Postprocess Pass : %.4f ms [%.4f - %.4f]", postprocessTimer.getAverageTime(), postprocessTimer.getMinTime(), postprocessTimer.getMaxTime());
+        ImGui::Text("Forward Pass :     %.4f ms [%.4f - %.4f]", forwardTimer.getAverageTime(), forwardTimer.getMinTime(), forwardTimer.getMaxTime());
+        ImGui::Text("GUI Pass :         %.4f ms [%.4f - %.4f]", guiTimer.getAverageTime(), guiTimer.getMinTime(), guiTimer.getMaxTime());
+        ImGui::Text("GPU Timers :       %d frames late, %d samples kept, %d dropped", guiTimer.getLatency(), GPUTimer::sampleCount, guiTimer.getDroppedCount());
+        ImGui::Text("Render Graph :     %d passes (%d culled), %d targets on %d textures", renderGraph.getPassCount(), renderGraph.getCulledCount(), renderGraph.getTargetCount(), renderGraph.getPoolSize());
+        ImGui::Text("    Memory :       %.1f MB peak (%.1f MB unaliased), compiled in %.4f ms", renderGraph.getPeakMemory(), renderGraph.getUnaliasedMemory(), renderGraph.getCompileTime());
+        ImGui::Text("    Bandwidth :    %.1f MB read, %.1f MB written per frame (estimated)", renderGraph.getReadBandwidth(), renderGraph.getWriteBandwidth());
+
+        // Targets of the last compile, the culled ones showing no access
+        if (ImGui::TreeNode("Render Targets"))
+        {
+            ImGui::Columns(5, "renderTargets");
+            ImGui::Text("Target");
+            ImGui::NextColumn();
+            ImGui::Text("Format");
+            ImGui::NextColumn();
+            ImGui::Text("Size");
+            ImGui::NextColumn();
+            ImGui::Text("Memory");
+            ImGui::NextColumn();
+            ImGui::Text("Read / Write");
+            ImGui::NextColumn();
+            ImGui::Separator();
+
+            for (GLuint i = 0; i < renderGraph.getTargetCount(); i++)
+            {
+                const RenderTarget& target = renderGraph.getTarget(i);
+                GLfloat targetMemory = renderGraph.getTargetMemory(i);
+
+                ImGui::Text("%s%s", target.targetName.c_str(), target.targetImported ? " (imported)" : "");
+                ImGui::NextColumn();
+                ImGui::Text("%s", RenderGraph::getFormatName(target.targetFormat));
+                ImGui::NextColumn();
+                ImGui::Text("%d x %d", target.targetWidth, target.targetHeight);
+                ImGui::NextColumn();
+                ImGui::Text("%.2f MB", targetMemory);
+                ImGui::NextColumn();
+                ImGui::Text("%.2f / %.2f MB", targetMemory * target.targetReads, targetMemory * target.targetWrites);
+                ImGui::NextColumn();
+            }
+
+            ImGui::Columns(1);
+            ImGui::TreePop();
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Profiler", 0, true, true))
+    {
+        if (ImGui::Checkbox("Enabled", &profilerMode))
+            Profiler::setEnabled(profilerMode);
+
+        ImGui::SliderInt("Capture Frames", &profilerCaptureFrames, 1, 120);
+
+        if (ImGui::Button("Capture Chrome Trace") && !Profiler::isCapturing())
+            Profiler::startCapture(profilerCaptureFrames, "GLEngine_trace_" + std::to_string(GLuint(glfwGetTime() * 1000.0)) + ".json");
+
+        ImGui::Text("%s", Profiler::getCaptureStatus().c_str());
+
+        // One line per zone, nested under its parent : p50 / p95 / p99 of its last durations, the selected one drawn as a histogram below
+        ImGui::Text("Zone :             p50 / p95 / p99 (ms)");
+
+        for (GLuint i = 0; i < Profiler::getZoneCount(); i++)
+        {
+            ProfilerZone zone = Profiler::getZone(i);
+            GLfloat p50, p95, p99;
+            Profiler::computePercentiles(zone, p50, p95, p99);
+
+            char zoneLabel[128];
+            std::snprintf(zoneLabel, sizeof(zoneLabel), "%*s%s %s : %.3f / %.3f / %.3f##%d", zone.zoneDepth * 2, "", zone.zoneGPU ? "[GPU]" : "[CPU]", zone.zoneName.c_str(), p50, p95, p99, i);
+
+            if (ImGui::Selectable(zoneLabel, profilerZone == GLint(i)))
+                profilerZone = i;
+        }
+
+        if (profilerZone < GLint(Profiler::getZoneCount()))
+        {
+            ProfilerZone zone = Profiler::getZone(profilerZone);
+            std::vector<GLfloat> zoneBuckets(32);
+            GLfloat minTime, maxTime;
+            Profiler::computeHistogram(zone, zoneBuckets, minTime, maxTime);
+
+            char histogramLabel[128];
+            std::snprintf(histogramLabel, sizeof(histogramLabel), "%s : %.3f - %.3f ms", zone.zoneName.c_str(), minTime, maxTime);
+
+            ImGui::PlotHistogram("##ProfilerHistogram", zoneBuckets.data(), zoneBuckets.size(), 0, histogramLabel, 0.0f, FLT_MAX, ImVec2(0, 80));
+        }
     }
 
     if (ImGui::CollapsingHeader("Application Info", 0, true, true))
@@ -995,228 +2067,272 @@ void imGuiSetup()
 }
 
 
-void gBufferSetup()
+void iblSetup()
 {
-    glGenFramebuffers(1, &gBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-
-    // Position
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WIDTH, HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-
-    // Albedo + Roughness
-    glGenTextures(1, &gAlbedo);
-    glBindTexture(GL_TEXTURE_2D, gAlbedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, WIDTH, HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gAlbedo, 0);
-
-    // Normals + Metalness
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WIDTH, HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gNormal, 0);
-
-    // Effects (AO + Velocity)
-    glGenTextures(1, &gEffects);
-    glBindTexture(GL_TEXTURE_2D, gEffects);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, WIDTH, HEIGHT, 0, GL_RGB, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, gEffects, 0);
-
-    // Define the COLOR_ATTACHMENTS for the G-Buffer
-    GLuint attachments[4] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3 };
-    glDrawBuffers(4, attachments);
-
-    // Z-Buffer
-    glGenRenderbuffers(1, &zBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, zBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, WIDTH, HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, zBuffer);
-
-    // Check if the framebuffer is complete before continuing
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete !" << std::endl;
-}
+    GLdouble iblSetupStart = glfwGetTime();
 
+    // Warm startup : the baked outputs of this HDR map are reloaded from the on-disk cache and every bake pass is skipped
+    std::string iblCacheKey = iblCache.computeKey(envMapHDR.getTexPath(), envMapCube.getTexWidth(), envMapPrefilter.getTexWidth(), iblPrefilterMips, iblSampleCount);
+    iblCacheHit = iblCache.loadEnvironment(iblCacheKey, envMapCube, envMapPrefilter, iblPrefilterMips, irradianceSH);
 
-void saoSetup()
-{
-    // SAO Buffer
-    glGenFramebuffers(1, &saoFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, saoFBO);
-    glGenTextures(1, &saoBuffer);
-    glBindTexture(GL_TEXTURE_2D, saoBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, WIDTH, HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, saoBuffer, 0);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "SAO Framebuffer not complete !" << std::endl;
-
-    // SAO Blur Buffer
-    glGenFramebuffers(1, &saoBlurFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, saoBlurFBO);
-    glGenTextures(1, &saoBlurBuffer);
-    glBindTexture(GL_TEXTURE_2D, saoBlurBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, WIDTH, HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, saoBlurBuffer, 0);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "SAO Blur Framebuffer not complete !" << std::endl;
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
+    if (!iblCacheHit)
+    {
+        // Latlong to Cubemap conversion
+        glGenFramebuffers(1, &envToCubeFBO);
+        glGenRenderbuffers(1, &envToCubeRBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, envToCubeFBO);
+        glBindRenderbuffer(GL_RENDERBUFFER, envToCubeRBO);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, envMapCube.getTexWidth(), envMapCube.getTexHeight());
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, envToCubeRBO);
 
+        latlongToCubeShader.useShader();
 
-void postprocessSetup()
-{
-    // Post-processing Buffer
-    glGenFramebuffers(1, &postprocessFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, postprocessFBO);
-
-    glGenTextures(1, &postprocessBuffer);
-    glBindTexture(GL_TEXTURE_2D, postprocessBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, WIDTH, HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, postprocessBuffer, 0);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Postprocess Framebuffer not complete !" << std::endl;
-}
+        glUniformMatrix4fv(glGetUniformLocation(latlongToCubeShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(envMapProjection));
+        glActiveTexture(GL_TEXTURE0);
+        envMapHDR.useTexture();
 
+        glViewport(0, 0, envMapCube.getTexWidth(), envMapCube.getTexHeight());
+        glBindFramebuffer(GL_FRAMEBUFFER, envToCubeFBO);
 
-void iblSetup()
-{
-    // Latlong to Cubemap conversion
-    glGenFramebuffers(1, &envToCubeFBO);
-    glGenRenderbuffers(1, &envToCubeRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, envToCubeFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, envToCubeRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, envMapCube.getTexWidth(), envMapCube.getTexHeight());
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, envToCubeRBO);
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            glUniformMatrix4fv(glGetUniformLocation(latlongToCubeShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(envMapView[i]));
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envMapCube.getTexID(), 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    latlongToCubeShader.useShader();
+            envCubeRender.drawShape();
+        }
 
-    glUniformMatrix4fv(glGetUniformLocation(latlongToCubeShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(envMapProjection));
-    glActiveTexture(GL_TEXTURE0);
-    envMapHDR.useTexture();
+        envMapCube.computeTexMipmap();
 
-    glViewport(0, 0, envMapCube.getTexWidth(), envMapCube.getTexHeight());
-    glBindFramebuffer(GL_FRAMEBUFFER, envToCubeFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glUniformMatrix4fv(glGetUniformLocation(latlongToCubeShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(envMapView[i]));
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envMapCube.getTexID(), 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        // Diffuse irradiance, projected on 9 SH coefficients straight from the latlong texels, on the CPU
+        std::vector<GLfloat> envMapData;
+        envMapHDR.getTexData(envMapData);
+        irradianceSH.computeCoefficients(envMapData.data(), envMapHDR.getTexWidth(), envMapHDR.getTexHeight(), envMapHDR.texComponents);
 
-        envCubeRender.drawShape();
-    }
+        // Prefilter cubemap
+        prefilterIBLShader.useShader();
 
-    envMapCube.computeTexMipmap();
+        glUniformMatrix4fv(glGetUniformLocation(prefilterIBLShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(envMapProjection));
+        envMapCube.useTexture();
+
+        glGenFramebuffers(1, &prefilterFBO);
+        glGenRenderbuffers(1, &prefilterRBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, prefilterFBO);
+
+        for (unsigned int mip = 0; mip < iblPrefilterMips; ++mip)
+        {
+            unsigned int mipWidth = envMapPrefilter.getTexWidth() * std::pow(0.5, mip);
+            unsigned int mipHeight = envMapPrefilter.getTexHeight() * std::pow(0.5, mip);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glBindRenderbuffer(GL_RENDERBUFFER, prefilterRBO);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
 
-    // Diffuse irradiance capture
-    glGenFramebuffers(1, &irradianceFBO);
-    glGenRenderbuffers(1, &irradianceRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, irradianceFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, irradianceRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, envMapIrradiance.getTexWidth(), envMapIrradiance.getTexHeight());
+            glViewport(0, 0, mipWidth, mipHeight);
 
-    irradianceIBLShader.useShader();
+            float roughness = (float)mip / (float)(iblPrefilterMips - 1);
+
+            glUniform1f(glGetUniformLocation(prefilterIBLShader.Program, "roughness"), roughness);
+            glUniform1f(glGetUniformLocation(prefilterIBLShader.Program, "cubeResolutionWidth"), envMapPrefilter.getTexWidth());
+            glUniform1f(glGetUniformLocation(prefilterIBLShader.Program, "cubeResolutionHeight"), envMapPrefilter.getTexHeight());
+
+            for (unsigned int i = 0; i < 6; ++i)
+            {
+                glUniformMatrix4fv(glGetUniformLocation(prefilterIBLShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(envMapView[i]));
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envMapPrefilter.getTexID(), mip);
+
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+                envCubeRender.drawShape();
+            }
+        }
 
-    glUniformMatrix4fv(glGetUniformLocation(irradianceIBLShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(envMapProjection));
-    glActiveTexture(GL_TEXTURE0);
-    envMapCube.useTexture();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    glViewport(0, 0, envMapIrradiance.getTexWidth(), envMapIrradiance.getTexHeight());
-    glBindFramebuffer(GL_FRAMEBUFFER, irradianceFBO);
+        iblCache.saveEnvironment(iblCacheKey, envMapCube, envMapPrefilter, iblPrefilterMips, irradianceSH);
+    }
 
-    for (unsigned int i = 0; i < 6; ++i)
+    // The BRDF LUT does not depend on the environment, it is shipped baked and only rendered if its file is missing
+    if (!iblLUTReady)
     {
-        glUniformMatrix4fv(glGetUniformLocation(irradianceIBLShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(envMapView[i]));
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envMapIrradiance.getTexID(), 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (!iblCache.loadLUT("resources/textures/ibl/brdf_lut.bin", envMapLUT))
+        {
+            // BRDF LUT
+            glGenFramebuffers(1, &brdfLUTFBO);
+            glGenRenderbuffers(1, &brdfLUTRBO);
+            glBindFramebuffer(GL_FRAMEBUFFER, brdfLUTFBO);
+            glBindRenderbuffer(GL_RENDERBUFFER, brdfLUTRBO);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, envMapLUT.getTexWidth(), envMapLUT.getTexHeight());
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, envMapLUT.getTexID(), 0);
+
+            glViewport(0, 0, envMapLUT.getTexWidth(), envMapLUT.getTexHeight());
+            integrateIBLShader.useShader();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            quadRender.drawShape();
 
-        envCubeRender.drawShape();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            iblCache.saveLUT("resources/textures/ibl/brdf_lut.bin", envMapLUT);
+        }
+
+        iblLUTReady = true;
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, WIDTH, HEIGHT);
+
+    glFinish();
+    deltaIBLSetupTime = GLfloat((glfwGetTime() - iblSetupStart) * 1000.0);
+}
+
+
+void samplersSetup()
+{
+    lightingBRDFShader.useShader();
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gPosition"), 0);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gAlbedo"), 1);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gNormal"), 2);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "gEffects"), 3);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "sao"), 4);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "envMap"), 5);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "envMapPrefilter"), 7);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "envMapLUT"), 8);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "shadowMap"), 9);
+    glUniform1i(glGetUniformLocation(lightingBRDFShader.Program, "pointShadowMap"), 10);
+    glUniformBlockBinding(lightingBRDFShader.Program, glGetUniformBlockIndex(lightingBRDFShader.Program, "LightBlock"), 0);
+
+    saoShader.useShader();
+    glUniform1i(glGetUniformLocation(saoShader.Program, "saoDepth"), 0);
+    glUniform1i(glGetUniformLocation(saoShader.Program, "gNormal"), 1);
+
+    saoComputeShader.useShader();
+    glUniform1i(glGetUniformLocation(saoComputeShader.Program, "saoDepth"), 0);
+    glUniform1i(glGetUniformLocation(saoComputeShader.Program, "gNormal"), 1);
+
+    saoPyramidShader.useShader();
+    glUniform1i(glGetUniformLocation(saoPyramidShader.Program, "gPosition"), 0);
+
+    saoTemporalShader.useShader();
+    glUniform1i(glGetUniformLocation(saoTemporalShader.Program, "saoInput"), 0);
+    glUniform1i(glGetUniformLocation(saoTemporalShader.Program, "saoHistory"), 1);
+    glUniform1i(glGetUniformLocation(saoTemporalShader.Program, "gEffects"), 2);
+
+    saoUpsampleShader.useShader();
+    glUniform1i(glGetUniformLocation(saoUpsampleShader.Program, "saoInput"), 0);
+    glUniform1i(glGetUniformLocation(saoUpsampleShader.Program, "saoDepth"), 1);
+    glUniform1i(glGetUniformLocation(saoUpsampleShader.Program, "gNormal"), 2);
+
+    lightingTiledShader.useShader();
+    glUniform1i(glGetUniformLocation(lightingTiledShader.Program, "gPosition"), 0);
+    glUniform1i(glGetUniformLocation(lightingTiledShader.Program, "gAlbedo"), 1);
+    glUniform1i(glGetUniformLocation(lightingTiledShader.Program, "gNormal"), 2);
+    glUniform1i(glGetUniformLocation(lightingTiledShader.Program, "gEffects"), 3);
+
+    lightingPointShader.useShader();
+    glUniform1i(glGetUniformLocation(lightingPointShader.Program, "gPosition"), 0);
+    glUniform1i(glGetUniformLocation(lightingPointShader.Program, "gAlbedo"), 1);
+    glUniform1i(glGetUniformLocation(lightingPointShader.Program, "gNormal"), 2);
+    glUniform1i(glGetUniformLocation(lightingPointShader.Program, "gEffects"), 3);
+    glUniform1i(glGetUniformLocation(lightingPointShader.Program, "pointShadowMap"), 10);
+
+    firstpassPPShader.useShader();
+    glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "sao"), 1);
+    glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "gEffects"), 2);
+    glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "gPosition"), 3);
+    glUniform1i(glGetUniformLocation(firstpassPPShader.Program, "velocityNeighborMax"), 4);
+
+    upscaleShader.useShader();
+    glUniform1i(glGetUniformLocation(upscaleShader.Program, "upscaleInput"), 0);
+
+    taaShader.useShader();
+    glUniform1i(glGetUniformLocation(taaShader.Program, "taaInput"), 0);
+    glUniform1i(glGetUniformLocation(taaShader.Program, "taaHistory"), 1);
+    glUniform1i(glGetUniformLocation(taaShader.Program, "gEffects"), 2);
+    glUniform1i(glGetUniformLocation(taaShader.Program, "gPosition"), 3);
+
+    latlongToCubeShader.useShader();
+    glUniform1i(glGetUniformLocation(latlongToCubeShader.Program, "envMap"), 0);
 
-    // Prefilter cubemap
     prefilterIBLShader.useShader();
+    glUniform1i(glGetUniformLocation(prefilterIBLShader.Program, "envMap"), 0);
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(prefilterIBLShader.Program, "projection"), 1, GL_FALSE, glm::value_ptr(envMapProjection));
-    envMapCube.useTexture();
 
-    glGenFramebuffers(1, &prefilterFBO);
-    glGenRenderbuffers(1, &prefilterRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, prefilterFBO);
+void lightsExtraSetup()
+{
+    // Randomly scattered point lights to stress the tiled/clustered paths, only the first three have gizmos
+    std::mt19937 lightRandom(lightPointExtraList.size());
+    std::uniform_real_distribution<float> lightPositionRandom(-5.0f, 5.0f);
+    std::uniform_real_distribution<float> lightColorRandom(0.0f, 1.0f);
+    std::uniform_real_distribution<float> lightRadiusRandom(0.3f, 1.0f);
 
-    unsigned int maxMipLevels = 5;
+    while (lightPointExtraList.size() < (size_t)lightPointExtraCount)
+    {
+        glm::vec3 position(lightPositionRandom(lightRandom), lightPositionRandom(lightRandom) * 0.3f + 1.0f, lightPositionRandom(lightRandom));
+        glm::vec4 color(lightColorRandom(lightRandom), lightColorRandom(lightRandom), lightColorRandom(lightRandom), 1.0f);
+
+        lightPointExtraList.push_back(lightSystem.addPointLight(position, color, lightRadiusRandom(lightRandom), false));
+    }
 
-    for (unsigned int mip = 0; mip < maxMipLevels; ++mip)
+    while (lightPointExtraList.size() > (size_t)lightPointExtraCount)
     {
-        unsigned int mipWidth = envMapPrefilter.getTexWidth() * std::pow(0.5, mip);
-        unsigned int mipHeight = envMapPrefilter.getTexHeight() * std::pow(0.5, mip);
+        lightSystem.removeLight(lightPointExtraList.back());
+        lightPointExtraList.pop_back();
+    }
+}
 
-        glBindRenderbuffer(GL_RENDERBUFFER, prefilterRBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, mipWidth, mipHeight);
 
-        glViewport(0, 0, mipWidth, mipHeight);
+void shadowInvalidateModel(glm::mat4& modelMatrix)
+{
+    glm::vec3 boundsMin = objectModel.getBoundsMin();
+    glm::vec3 boundsMax = objectModel.getBoundsMax();
 
-        float roughness = (float)mip / (float)(maxMipLevels - 1);
+    glm::vec3 boundsCenter = glm::vec3(modelMatrix * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+    GLfloat boundsScale = std::max(glm::length(glm::vec3(modelMatrix[0])), std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
 
-        glUniform1f(glGetUniformLocation(prefilterIBLShader.Program, "roughness"), roughness);
-        glUniform1f(glGetUniformLocation(prefilterIBLShader.Program, "cubeResolutionWidth"), envMapPrefilter.getTexWidth());
-        glUniform1f(glGetUniformLocation(prefilterIBLShader.Program, "cubeResolutionHeight"), envMapPrefilter.getTexHeight());
+    cascadedShadow.invalidateBounds(boundsCenter, glm::length(boundsMax - boundsMin) * 0.5f * boundsScale);
+    pointShadow.invalidateBounds(boundsCenter, glm::length(boundsMax - boundsMin) * 0.5f * boundsScale);
+}
 
-        for (unsigned int i = 0; i < 6; ++i)
-        {
-            glUniformMatrix4fv(glGetUniformLocation(prefilterIBLShader.Program, "view"), 1, GL_FALSE, glm::value_ptr(envMapView[i]));
-            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, envMapPrefilter.getTexID(), mip);
 
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// Ping-ponged history textures (TAA, temporal SAO), filtered for the reprojected fetches. Imported into the
+// render graph since they outlive the frame
+void historySetup(GLuint historyTexture[2], GLuint width, GLuint height, GLenum format)
+{
+    glDeleteTextures(2, historyTexture);
+    glGenTextures(2, historyTexture);
 
-            envCubeRender.drawShape();
-        }
+    for (GLuint i = 0; i < 2; i++)
+    {
+        glBindTexture(GL_TEXTURE_2D, historyTexture[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
 
-    // BRDF LUT
-    glGenFramebuffers(1, &brdfLUTFBO);
-    glGenRenderbuffers(1, &brdfLUTRBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, brdfLUTFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, brdfLUTRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, envMapLUT.getTexWidth(), envMapLUT.getTexHeight());
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, envMapLUT.getTexID(), 0);
 
-    glViewport(0, 0, envMapLUT.getTexWidth(), envMapLUT.getTexHeight());
-    integrateIBLShader.useShader();
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// Per pixel, from the formats of the current preset : everything the geometry pass writes (depth-stencil included),
+// or what the lighting pass reads back, the compact layout reading the depth as its position
+GLuint gBufferPixelBytes(bool compactLayout, bool lightingRead)
+{
+    GLuint pixelBits = RenderGraph::getFormatBits(renderGraph.getFormat("Albedo"))
+                     + RenderGraph::getFormatBits(renderGraph.getFormat(compactLayout ? "Normal (Compact)" : "Normal"))
+                     + RenderGraph::getFormatBits(renderGraph.getFormat(compactLayout ? "Effects (Compact)" : "Effects"));
 
-    quadRender.drawShape();
+    if (!compactLayout)
+        pixelBits += RenderGraph::getFormatBits(renderGraph.getFormat("Position"));
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (compactLayout || !lightingRead)
+        pixelBits += RenderGraph::getFormatBits(renderGraph.getFormat("Depth"));
 
-    glViewport(0, 0, WIDTH, HEIGHT);
+    return pixelBits / 8;
 }
 
 
@@ -1265,6 +2381,9 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     if (keys[GLFW_KEY_9])
         gBufferView = 9;
 
+    if (keys[GLFW_KEY_0])
+        gBufferView = 10;
+
     if (key >= 0 && key < 1024)
     {
         if (action == GLFW_PRESS)
@@ -1308,3 +2427,4 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
     if (cameraMode)
         camera.scrollCall(yoffset);
 }
+
@@ -0,0 +1,159 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "gputimer.h"
+
+
+GPUTimer::GPUTimer()
+{
+    for (GLuint i = 0; i < frameCount; ++i)
+    {
+        this->timerQueries[i][0] = 0;
+        this->timerQueries[i][1] = 0;
+        this->timerFrame[i] = 0;
+        this->timerPending[i] = false;
+    }
+
+    for (GLuint i = 0; i < sampleCount; ++i)
+        this->timerSamples[i] = 0.0f;
+}
+
+
+GPUTimer::~GPUTimer()
+{
+
+}
+
+
+// Needs the GL context, the timers themselves being globals
+void GPUTimer::setTimer()
+{
+    for (GLuint i = 0; i < frameCount; ++i)
+        glGenQueries(2, this->timerQueries[i]);
+}
+
+
+void GPUTimer::beginTimer()
+{
+    glQueryCounter(this->timerQueries[this->frameIndex][0], GL_TIMESTAMP);
+    this->timerBegun = true;
+}
+
+
+void GPUTimer::endTimer()
+{
+    if (!this->timerBegun)
+        return;
+
+    glQueryCounter(this->timerQueries[this->frameIndex][1], GL_TIMESTAMP);
+    this->timerPending[this->frameIndex] = true;
+    this->timerFrame[this->frameIndex] = this->frameNumber;
+    this->timerBegun = false;
+}
+
+
+// Once per frame, after the last pass : reads back what is available, then moves on to the next pair of the ring.
+// A pair still pending by then (the GPU being more than frameCount frames behind) is dropped and reissued
+void GPUTimer::updateTimer()
+{
+    this->pollQueries();
+
+    this->frameNumber++;
+    this->frameIndex = (this->frameIndex + 1) % frameCount;
+    this->timerBegun = false;
+
+    if (this->timerPending[this->frameIndex])
+    {
+        this->timerPending[this->frameIndex] = false;
+        this->droppedCount++;
+    }
+}
+
+
+// Oldest pairs first, so that the samples keep their frame order
+void GPUTimer::pollQueries()
+{
+    for (GLuint i = 1; i <= frameCount; ++i)
+    {
+        GLuint slot = (this->frameIndex + i) % frameCount;
+
+        if (!this->timerPending[slot])
+            continue;
+
+        GLint resultAvailable = 0;
+        glGetQueryObjectiv(this->timerQueries[slot][1], GL_QUERY_RESULT_AVAILABLE, &resultAvailable);
+
+        // Timestamps complete in order, a later pair cannot be ready either
+        if (!resultAvailable)
+            break;
+
+        GLuint64 startTime, stopTime;
+        glGetQueryObjectui64v(this->timerQueries[slot][0], GL_QUERY_RESULT, &startTime);
+        glGetQueryObjectui64v(this->timerQueries[slot][1], GL_QUERY_RESULT, &stopTime);
+
+        this->timerSamples[this->sampleIndex] = (stopTime - startTime) / 1000000.0f;
+        this->sampleIndex = (this->sampleIndex + 1) % sampleCount;
+
+        if (this->sampleTotal < sampleCount)
+            this->sampleTotal++;
+
+        this->lastLatency = GLuint(this->frameNumber - this->timerFrame[slot]);
+        this->timerPending[slot] = false;
+    }
+}
+
+
+// Last sample read back, in ms
+GLfloat GPUTimer::getTime()
+{
+    if (!this->sampleTotal)
+        return 0.0f;
+
+    return this->timerSamples[(this->sampleIndex + sampleCount - 1) % sampleCount];
+}
+
+
+GLfloat GPUTimer::getMinTime()
+{
+    if (!this->sampleTotal)
+        return 0.0f;
+
+    return *std::min_element(this->timerSamples, this->timerSamples + this->sampleTotal);
+}
+
+
+GLfloat GPUTimer::getAverageTime()
+{
+    GLfloat totalTime = 0.0f;
+
+    for (GLuint i = 0; i < this->sampleTotal; ++i)
+        totalTime += this->timerSamples[i];
+
+    return this->sampleTotal ? totalTime / this->sampleTotal : 0.0f;
+}
+
+
+GLfloat GPUTimer::getMaxTime()
+{
+    if (!this->sampleTotal)
+        return 0.0f;
+
+    return *std::max_element(this->timerSamples, this->timerSamples + this->sampleTotal);
+}
+
+
+// Frames between the issue of the last sample and its readback
+GLuint GPUTimer::getLatency()
+{
+    return this->lastLatency;
+}
+
+
+GLuint GPUTimer::getDroppedCount()
+{
+    return this->droppedCount;
+}
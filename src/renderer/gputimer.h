@@ -0,0 +1,52 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+
+// GPU time of a pass, measured with a ring of timestamp query pairs a few frames deep : a frame only reads back the pairs
+// whose results are already available, so the CPU never waits on the GPU, and the timings come in a few frames late.
+// The last samples are kept for rolling min/avg/max
+class GPUTimer
+{
+    public:
+        static const GLuint frameCount = 4;
+        static const GLuint sampleCount = 64;
+
+        GPUTimer();
+        ~GPUTimer();
+        void setTimer();
+        void beginTimer();
+        void endTimer();
+        void updateTimer();
+        GLfloat getTime();
+        GLfloat getMinTime();
+        GLfloat getAverageTime();
+        GLfloat getMaxTime();
+        GLuint getLatency();
+        GLuint getDroppedCount();
+
+    private:
+        GLuint timerQueries[frameCount][2];
+        GLuint64 timerFrame[frameCount];
+        bool timerPending[frameCount];
+        bool timerBegun = false;
+        GLuint frameIndex = 0;
+        GLuint64 frameNumber = 0;
+
+        GLfloat timerSamples[sampleCount];
+        GLuint sampleIndex = 0;
+        GLuint sampleTotal = 0;
+        GLuint lastLatency = 0;
+        GLuint droppedCount = 0;
+
+        void pollQueries();
+};
+
+#endif
@@ -0,0 +1,530 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "profiler.h"
+
+
+static const GLuint invalidZone = 0xFFFFFFFF;
+
+
+// Closed zone, times in microseconds since the profiler start as in the trace-event format
+struct ProfilerEvent
+{
+    GLuint eventZone;
+    GLdouble eventStart;
+    GLdouble eventDuration;
+};
+
+
+// GPU zone waiting for its pair of timestamps, the end query following the begin one
+struct ProfilerGPUEvent
+{
+    GLuint eventZone;
+    GLuint eventQuery;
+};
+
+
+// Queries of one frame of the ring, with the CPU and GPU clocks sampled at its start to bring the timestamps on the CPU timeline
+struct ProfilerFrame
+{
+    GLuint64 frameNumber = 0;
+    bool framePending = false;
+    GLdouble frameCPUTime = 0.0;
+    GLint64 frameGPUTime = 0;
+    std::vector<GLuint> frameQueries;
+    GLuint queryUsed = 0;
+    GLuint lastQuery = 0;
+    std::vector<ProfilerGPUEvent> frameEvents;
+};
+
+
+// Zone stack of a thread, zones opened while the profiler was disabled being kept as invalid entries
+struct ProfilerThread
+{
+    GLuint threadIndex = 0;
+    std::vector<std::pair<GLuint, GLdouble>> zoneStack;
+};
+
+
+// Shared by every thread, allocated once and never freed so that worker threads still closing zones at exit never see it destroyed
+struct ProfilerState
+{
+    std::mutex profilerMutex;
+    std::chrono::high_resolution_clock::time_point profilerStart;
+    std::atomic<bool> profilerEnabled;
+    bool pendingEnabled = true;
+    bool contextReady = false;
+
+    std::vector<ProfilerZone> profilerZones;
+    std::map<std::string, GLuint> zoneIndices;
+    std::vector<std::string> threadNames;
+
+    ProfilerFrame gpuFrames[Profiler::frameCount];
+    std::vector<std::pair<GLuint, GLuint>> gpuStack;
+    GLuint frameIndex = 0;
+    GLuint64 frameNumber = 0;
+
+    bool captureActive = false;
+    GLuint64 captureFirst = 0;
+    GLuint64 captureLast = 0;
+    std::string capturePath;
+    std::string captureStatus;
+    std::vector<ProfilerEvent> captureEvents;
+
+    ProfilerState() : profilerStart(std::chrono::high_resolution_clock::now()), profilerEnabled(true)
+    {
+        this->threadNames.push_back("GPU");
+    }
+};
+
+
+static ProfilerState& getProfilerState()
+{
+    static ProfilerState* profilerState = new ProfilerState();
+
+    return *profilerState;
+}
+
+
+static GLdouble getProfilerTime(ProfilerState& state)
+{
+    return std::chrono::duration<GLdouble, std::micro>(std::chrono::high_resolution_clock::now() - state.profilerStart).count();
+}
+
+
+// Threads are registered by name, so that the short-lived workers spawned again every frame keep reusing the same timeline
+static ProfilerThread& getProfilerThread(ProfilerState& state, const std::string& name = std::string())
+{
+    static thread_local ProfilerThread profilerThread;
+
+    if (!profilerThread.threadIndex)
+    {
+        std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+
+        std::string threadName = name.empty() ? "Thread " + std::to_string(state.threadNames.size()) : name;
+        std::vector<std::string>::iterator threadIndex = std::find(state.threadNames.begin() + 1, state.threadNames.end(), threadName);
+
+        profilerThread.threadIndex = GLuint(threadIndex - state.threadNames.begin());
+
+        if (threadIndex == state.threadNames.end())
+            state.threadNames.push_back(threadName);
+    }
+
+    return profilerThread;
+}
+
+
+// Zones are told apart by name, thread and timeline, under the profiler lock
+static GLuint getZoneIndex(ProfilerState& state, const char* name, GLuint thread, GLuint depth, bool gpu)
+{
+    std::string zoneKey = std::string(name) + '\n' + std::to_string(thread) + (gpu ? "G" : "C");
+    std::map<std::string, GLuint>::iterator zoneIndex = state.zoneIndices.find(zoneKey);
+
+    if (zoneIndex != state.zoneIndices.end())
+        return zoneIndex->second;
+
+    ProfilerZone zone;
+    zone.zoneName = name;
+    zone.zoneThread = thread;
+    zone.zoneDepth = depth;
+    zone.zoneGPU = gpu;
+    zone.sampleIndex = 0;
+    state.profilerZones.push_back(zone);
+
+    return state.zoneIndices[zoneKey] = GLuint(state.profilerZones.size() - 1);
+}
+
+
+static void addEvent(ProfilerState& state, GLuint64 frame, const ProfilerEvent& event)
+{
+    ProfilerZone& zone = state.profilerZones[event.eventZone];
+    GLfloat duration = GLfloat(event.eventDuration / 1000.0);
+
+    if (zone.zoneSamples.size() < Profiler::sampleCount)
+        zone.zoneSamples.push_back(duration);
+    else
+        zone.zoneSamples[zone.sampleIndex] = duration;
+
+    zone.sampleIndex = (zone.sampleIndex + 1) % Profiler::sampleCount;
+
+    if (state.captureActive && frame >= state.captureFirst && frame <= state.captureLast)
+        state.captureEvents.push_back(event);
+}
+
+
+static void writeJSONString(std::ofstream& file, const std::string& text)
+{
+    file << '"';
+
+    for (char character : text)
+    {
+        if (character == '"' || character == '\\')
+            file << '\\';
+
+        file << character;
+    }
+
+    file << '"';
+}
+
+
+static bool writeTrace(ProfilerState& state)
+{
+    std::ofstream file(state.capturePath.c_str());
+
+    if (!file)
+        return false;
+
+    std::sort(state.captureEvents.begin(), state.captureEvents.end(), [](const ProfilerEvent& a, const ProfilerEvent& b)
+    {
+        return a.eventStart < b.eventStart;
+    });
+
+    file << "{\"traceEvents\":[\n";
+
+    for (GLuint i = 0; i < state.threadNames.size(); ++i)
+    {
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":";
+        writeJSONString(file, state.threadNames[i]);
+        file << "}},\n";
+
+        // Keeps the GPU timeline under the threads
+        file << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"sort_index\":" << (i ? i : state.threadNames.size()) << "}},\n";
+    }
+
+    file << std::fixed;
+    file.precision(3);
+
+    for (size_t i = 0; i < state.captureEvents.size(); ++i)
+    {
+        const ProfilerEvent& event = state.captureEvents[i];
+        const ProfilerZone& zone = state.profilerZones[event.eventZone];
+
+        file << "{\"name\":";
+        writeJSONString(file, zone.zoneName);
+        file << ",\"cat\":\"" << (zone.zoneGPU ? "GPU" : "CPU") << "\",\"ph\":\"X\",\"ts\":" << event.eventStart << ",\"dur\":" << event.eventDuration
+             << ",\"pid\":0,\"tid\":" << zone.zoneThread << "}" << (i + 1 < state.captureEvents.size() ? ",\n" : "\n");
+    }
+
+    file << "],\"displayTimeUnit\":\"ms\"}\n";
+
+    return bool(file);
+}
+
+
+// Oldest frames first, a frame being read back only once its last timestamp is available (they complete in order)
+static void pollFrames(ProfilerState& state)
+{
+    for (GLuint i = 1; i <= Profiler::frameCount; ++i)
+    {
+        ProfilerFrame& frame = state.gpuFrames[(state.frameIndex + i) % Profiler::frameCount];
+
+        if (!frame.framePending)
+            continue;
+
+        GLint resultAvailable = 0;
+        glGetQueryObjectiv(frame.frameQueries[frame.lastQuery], GL_QUERY_RESULT_AVAILABLE, &resultAvailable);
+
+        if (!resultAvailable)
+            break;
+
+        for (const ProfilerGPUEvent& gpuEvent : frame.frameEvents)
+        {
+            GLuint64 startTime, stopTime;
+            glGetQueryObjectui64v(frame.frameQueries[gpuEvent.eventQuery], GL_QUERY_RESULT, &startTime);
+            glGetQueryObjectui64v(frame.frameQueries[gpuEvent.eventQuery + 1], GL_QUERY_RESULT, &stopTime);
+
+            ProfilerEvent event;
+            event.eventZone = gpuEvent.eventZone;
+            event.eventStart = frame.frameCPUTime + GLdouble(GLint64(startTime) - frame.frameGPUTime) / 1000.0;
+            event.eventDuration = GLdouble(stopTime - startTime) / 1000.0;
+
+            std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+            addEvent(state, frame.frameNumber, event);
+        }
+
+        frame.framePending = false;
+    }
+}
+
+
+// Needs the GL context, GPU zones being ignored until then
+void Profiler::setProfiler()
+{
+    ProfilerState& state = getProfilerState();
+
+    state.contextReady = true;
+    setThreadName("Main");
+}
+
+
+// Applied at the next frame start, so that no frame mixes both states
+void Profiler::setEnabled(bool enabled)
+{
+    getProfilerState().pendingEnabled = enabled;
+}
+
+
+void Profiler::setThreadName(const std::string& name)
+{
+    ProfilerState& state = getProfilerState();
+    ProfilerThread& thread = getProfilerThread(state, name);
+
+    std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+    state.threadNames[thread.threadIndex] = name;
+}
+
+
+void Profiler::beginFrame()
+{
+    ProfilerState& state = getProfilerState();
+    state.profilerEnabled = state.pendingEnabled;
+
+    // A frame the GPU has not finished after a whole ring is dropped, its queries being reissued
+    ProfilerFrame& frame = state.gpuFrames[state.frameIndex];
+    frame.framePending = false;
+    frame.frameNumber = state.frameNumber;
+    frame.queryUsed = 0;
+    frame.frameEvents.clear();
+
+    if (state.profilerEnabled && state.contextReady)
+    {
+        glGetInteger64v(GL_TIMESTAMP, &frame.frameGPUTime);
+        frame.frameCPUTime = getProfilerTime(state);
+    }
+
+    beginZone("Frame");
+}
+
+
+void Profiler::endFrame()
+{
+    ProfilerState& state = getProfilerState();
+
+    endZone();
+
+    ProfilerFrame& frame = state.gpuFrames[state.frameIndex];
+    frame.framePending = !frame.frameEvents.empty();
+
+    if (state.contextReady)
+        pollFrames(state);
+
+    std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+
+    state.frameIndex = (state.frameIndex + 1) % frameCount;
+    state.frameNumber++;
+
+    // Written once the GPU zones of the last captured frame are in, or dropped
+    if (state.captureActive && state.frameNumber > state.captureLast + frameCount)
+    {
+        state.captureActive = false;
+        state.captureStatus = (writeTrace(state) ? "Written " : "FAILED writing ") + state.capturePath
+                            + " (" + std::to_string(state.captureEvents.size()) + " events)";
+        state.captureEvents.clear();
+
+        if (state.captureStatus[0] == 'F')
+            std::cerr << "PROFILER - " << state.captureStatus << std::endl;
+    }
+}
+
+
+void Profiler::beginZone(const char* name)
+{
+    ProfilerState& state = getProfilerState();
+    ProfilerThread& thread = getProfilerThread(state);
+    GLuint zone = invalidZone;
+
+    if (state.profilerEnabled)
+    {
+        std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+        zone = getZoneIndex(state, name, thread.threadIndex, GLuint(thread.zoneStack.size()), false);
+    }
+
+    thread.zoneStack.push_back(std::make_pair(zone, getProfilerTime(state)));
+}
+
+
+void Profiler::endZone()
+{
+    ProfilerState& state = getProfilerState();
+    ProfilerThread& thread = getProfilerThread(state);
+
+    if (thread.zoneStack.empty())
+        return;
+
+    std::pair<GLuint, GLdouble> zoneEntry = thread.zoneStack.back();
+    thread.zoneStack.pop_back();
+
+    if (zoneEntry.first == invalidZone)
+        return;
+
+    ProfilerEvent event;
+    event.eventZone = zoneEntry.first;
+    event.eventStart = zoneEntry.second;
+    event.eventDuration = getProfilerTime(state) - zoneEntry.second;
+
+    std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+    addEvent(state, state.frameNumber, event);
+}
+
+
+void Profiler::beginGPUZone(const char* name)
+{
+    ProfilerState& state = getProfilerState();
+
+    if (!state.profilerEnabled || !state.contextReady)
+    {
+        state.gpuStack.push_back(std::make_pair(invalidZone, 0u));
+        return;
+    }
+
+    ProfilerFrame& frame = state.gpuFrames[state.frameIndex];
+
+    if (frame.frameQueries.size() < frame.queryUsed + 2)
+    {
+        frame.frameQueries.resize(frame.queryUsed + 2);
+        glGenQueries(2, &frame.frameQueries[frame.queryUsed]);
+    }
+
+    GLuint zone;
+
+    {
+        std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+        zone = getZoneIndex(state, name, gpuThread, GLuint(state.gpuStack.size()), true);
+    }
+
+    glQueryCounter(frame.frameQueries[frame.queryUsed], GL_TIMESTAMP);
+    glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+
+    state.gpuStack.push_back(std::make_pair(zone, frame.queryUsed));
+    frame.queryUsed += 2;
+}
+
+
+void Profiler::endGPUZone()
+{
+    ProfilerState& state = getProfilerState();
+
+    if (state.gpuStack.empty())
+        return;
+
+    std::pair<GLuint, GLuint> zoneEntry = state.gpuStack.back();
+    state.gpuStack.pop_back();
+
+    if (zoneEntry.first == invalidZone)
+        return;
+
+    ProfilerFrame& frame = state.gpuFrames[state.frameIndex];
+    ProfilerGPUEvent gpuEvent = { zoneEntry.first, zoneEntry.second };
+
+    glPopDebugGroup();
+    glQueryCounter(frame.frameQueries[zoneEntry.second + 1], GL_TIMESTAMP);
+    frame.lastQuery = zoneEntry.second + 1;
+    frame.frameEvents.push_back(gpuEvent);
+}
+
+
+// Records the next frames, the trace being written a few frames after the last one, once its GPU zones came back
+void Profiler::startCapture(GLuint frames, const std::string& path)
+{
+    ProfilerState& state = getProfilerState();
+
+    std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+
+    if (state.captureActive)
+        return;
+
+    state.captureActive = true;
+    state.captureFirst = state.frameNumber + 1;
+    state.captureLast = state.captureFirst + std::max(frames, 1u) - 1;
+    state.capturePath = path;
+    state.captureStatus = "Capturing...";
+    state.captureEvents.clear();
+}
+
+
+bool Profiler::isCapturing()
+{
+    ProfilerState& state = getProfilerState();
+
+    std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+
+    return state.captureActive;
+}
+
+
+std::string Profiler::getCaptureStatus()
+{
+    ProfilerState& state = getProfilerState();
+
+    std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+
+    return state.captureStatus;
+}
+
+
+GLuint Profiler::getZoneCount()
+{
+    ProfilerState& state = getProfilerState();
+
+    std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+
+    return GLuint(state.profilerZones.size());
+}
+
+
+// Copy, the worker threads keep adding samples meanwhile
+ProfilerZone Profiler::getZone(GLuint zone)
+{
+    ProfilerState& state = getProfilerState();
+
+    std::lock_guard<std::mutex> profilerLock(state.profilerMutex);
+
+    return state.profilerZones[zone];
+}
+
+
+// Nearest-rank percentiles of the kept samples, in ms
+void Profiler::computePercentiles(const ProfilerZone& zone, GLfloat& p50, GLfloat& p95, GLfloat& p99)
+{
+    p50 = p95 = p99 = 0.0f;
+
+    if (zone.zoneSamples.empty())
+        return;
+
+    std::vector<GLfloat> sortedSamples(zone.zoneSamples);
+    std::sort(sortedSamples.begin(), sortedSamples.end());
+
+    GLuint lastSample = GLuint(sortedSamples.size() - 1);
+
+    p50 = sortedSamples[GLuint(lastSample * 0.50f + 0.5f)];
+    p95 = sortedSamples[GLuint(lastSample * 0.95f + 0.5f)];
+    p99 = sortedSamples[GLuint(lastSample * 0.99f + 0.5f)];
+}
+
+
+// Distribution of the kept samples over the buckets, evenly spread between their min and max
+void Profiler::computeHistogram(const ProfilerZone& zone, std::vector<GLfloat>& buckets, GLfloat& minTime, GLfloat& maxTime)
+{
+    std::fill(buckets.begin(), buckets.end(), 0.0f);
+    minTime = maxTime = 0.0f;
+
+    if (zone.zoneSamples.empty() || buckets.empty())
+        return;
+
+    minTime = *std::min_element(zone.zoneSamples.begin(), zone.zoneSamples.end());
+    maxTime = *std::max_element(zone.zoneSamples.begin(), zone.zoneSamples.end());
+
+    GLfloat bucketScale = buckets.size() / std::max(maxTime - minTime, 1e-6f);
+
+    for (GLfloat sample : zone.zoneSamples)
+        buckets[std::min(GLuint((sample - minTime) * bucketScale), GLuint(buckets.size() - 1))] += 1.0f;
+}
@@ -0,0 +1,72 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+
+// Named zone of a thread (or of the GPU), with its last durations for the percentiles and the histogram
+struct ProfilerZone
+{
+    std::string zoneName;
+    GLuint zoneThread;
+    GLuint zoneDepth;
+    bool zoneGPU;
+    std::vector<GLfloat> zoneSamples;
+    GLuint sampleIndex;
+};
+
+
+// Scoped markers : nested CPU zones are recorded per thread, GPU zones with timestamp queries read back a few frames late
+// (without ever waiting on the GPU) and wrapped in KHR_debug groups for the GPU debuggers. Every zone keeps its last
+// durations for the in-app histogram, and a range of frames can be captured and written out as Chrome trace-event JSON
+// (chrome://tracing, Perfetto). GPU zones are only allowed on the thread owning the GL context
+class Profiler
+{
+    public:
+        static const GLuint frameCount = 4;
+        static const GLuint sampleCount = 256;
+        static const GLuint gpuThread = 0;
+
+        static void setProfiler();
+        static void setEnabled(bool enabled);
+        static void setThreadName(const std::string& name);
+        static void beginFrame();
+        static void endFrame();
+        static void beginZone(const char* name);
+        static void endZone();
+        static void beginGPUZone(const char* name);
+        static void endGPUZone();
+        static void startCapture(GLuint frames, const std::string& path);
+        static bool isCapturing();
+        static std::string getCaptureStatus();
+        static GLuint getZoneCount();
+        static ProfilerZone getZone(GLuint zone);
+        static void computePercentiles(const ProfilerZone& zone, GLfloat& p50, GLfloat& p95, GLfloat& p99);
+        static void computeHistogram(const ProfilerZone& zone, std::vector<GLfloat>& buckets, GLfloat& minTime, GLfloat& maxTime);
+};
+
+
+// CPU zone covering its own scope
+class ProfilerScope
+{
+    public:
+        ProfilerScope(const char* name) { Profiler::beginZone(name); }
+        ~ProfilerScope() { Profiler::endZone(); }
+};
+
+
+// GPU zone covering its own scope, along with the CPU zone of the submission
+class ProfilerGPUScope
+{
+    public:
+        ProfilerGPUScope(const char* name) { Profiler::beginZone(name); Profiler::beginGPUZone(name); }
+        ~ProfilerGPUScope() { Profiler::endGPUZone(); Profiler::endZone(); }
+};
+
+#endif
@@ -0,0 +1,698 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+
+#include "rendergraph.h"
+#include "profiler.h"
+
+
+RenderGraph::RenderGraph()
+{
+
+}
+
+
+RenderGraph::~RenderGraph()
+{
+
+}
+
+
+// The graph is declared from scratch every frame, only the pool and the FBO cache persist
+void RenderGraph::beginGraph()
+{
+    this->graphTargets.clear();
+    this->graphPasses.clear();
+    this->graphOutputs.clear();
+}
+
+
+// Mipmapped targets (depth pyramids...) only share entries with the same level count, their levels being written by the passes
+GLuint RenderGraph::createTarget(const std::string& name, GLenum format, GLuint width, GLuint height, GLuint levels)
+{
+    RenderTarget target = { name, format, width, height, levels, false, 0, -1, -1, 0, 0 };
+    this->graphTargets.push_back(target);
+
+    return GLuint(this->graphTargets.size() - 1);
+}
+
+
+// Textures owned outside of the graph (history buffers...), a texture of 0 standing for the default framebuffer
+GLuint RenderGraph::importTarget(const std::string& name, GLuint texture, GLenum format, GLuint width, GLuint height)
+{
+    RenderTarget target = { name, format, width, height, 1, true, texture, -1, -1, 0, 0 };
+    this->graphTargets.push_back(target);
+
+    return GLuint(this->graphTargets.size() - 1);
+}
+
+
+GLuint RenderGraph::addPass(const std::string& name, const std::function<void()>& execute)
+{
+    RenderPass pass;
+    pass.passName = name;
+    pass.passExecute = execute;
+    pass.passCulled = false;
+    this->graphPasses.push_back(pass);
+
+    return GLuint(this->graphPasses.size() - 1);
+}
+
+
+void RenderGraph::readTarget(GLuint pass, GLuint target)
+{
+    this->graphPasses[pass].passReads.push_back(target);
+}
+
+
+void RenderGraph::writeTarget(GLuint pass, GLuint target)
+{
+    this->graphPasses[pass].passWrites.push_back(target);
+}
+
+
+// Written through image stores, the target is not attached to the pass framebuffer
+void RenderGraph::writeImage(GLuint pass, GLuint target)
+{
+    this->graphPasses[pass].passImageWrites.push_back(target);
+}
+
+
+void RenderGraph::setOutput(GLuint target)
+{
+    this->graphOutputs.push_back(target);
+}
+
+
+// The table persists across frames, the targets picking their format from it when they are declared
+void RenderGraph::setFormatTable(const std::vector<RenderFormat>& table)
+{
+    this->formatTable = table;
+}
+
+
+void RenderGraph::setFormatPreset(GLuint preset)
+{
+    this->formatPreset = preset;
+}
+
+
+GLenum RenderGraph::getFormat(const std::string& name)
+{
+    for (const RenderFormat& format : this->formatTable)
+    {
+        if (format.formatTarget == name && !format.formatPresets.empty())
+            return format.formatPresets[std::min(this->formatPreset, GLuint(format.formatPresets.size() - 1))];
+    }
+
+    std::cout << "Render Graph Format not found ! (" << name << ")" << std::endl;
+
+    return GL_RGBA16F;
+}
+
+
+void RenderGraph::compileGraph()
+{
+    ProfilerScope compileScope("Render Graph Compile");
+    std::chrono::high_resolution_clock::time_point compileStart = std::chrono::high_resolution_clock::now();
+
+    // Culling, backwards from the outputs : a pass is kept when it writes a target needed by a later kept pass.
+    // Writes are treated as read-modify-write (a pass may only add to a target), so the earlier writers stay needed too
+    std::vector<bool> targetNeeded(this->graphTargets.size(), false);
+
+    for (GLuint output : this->graphOutputs)
+        targetNeeded[output] = true;
+
+    this->culledCount = 0;
+
+    for (GLint i = GLint(this->graphPasses.size()) - 1; i >= 0; --i)
+    {
+        RenderPass& pass = this->graphPasses[i];
+        bool passNeeded = false;
+
+        for (GLuint target : pass.passWrites)
+            passNeeded = passNeeded || targetNeeded[target];
+
+        for (GLuint target : pass.passImageWrites)
+            passNeeded = passNeeded || targetNeeded[target];
+
+        pass.passCulled = !passNeeded;
+
+        if (pass.passCulled)
+        {
+            this->culledCount++;
+            continue;
+        }
+
+        for (GLuint target : pass.passReads)
+            targetNeeded[target] = true;
+    }
+
+    // Lifetimes, as the range of kept passes touching each target, along with their read and write counts
+    for (RenderTarget& target : this->graphTargets)
+    {
+        target.targetFirstPass = -1;
+        target.targetLastPass = -1;
+        target.targetReads = 0;
+        target.targetWrites = 0;
+
+        if (!target.targetImported)
+            target.targetTexture = 0;
+    }
+
+    for (GLuint i = 0; i < this->graphPasses.size(); ++i)
+    {
+        const RenderPass& pass = this->graphPasses[i];
+
+        if (pass.passCulled)
+            continue;
+
+        std::vector<GLuint> passTargets(pass.passReads);
+        passTargets.insert(passTargets.end(), pass.passWrites.begin(), pass.passWrites.end());
+        passTargets.insert(passTargets.end(), pass.passImageWrites.begin(), pass.passImageWrites.end());
+
+        for (GLuint index : passTargets)
+        {
+            RenderTarget& target = this->graphTargets[index];
+
+            if (target.targetFirstPass < 0)
+                target.targetFirstPass = i;
+
+            target.targetLastPass = i;
+        }
+
+        for (GLuint index : pass.passReads)
+            this->graphTargets[index].targetReads++;
+
+        for (GLuint index : pass.passWrites)
+            this->graphTargets[index].targetWrites++;
+
+        for (GLuint index : pass.passImageWrites)
+            this->graphTargets[index].targetWrites++;
+    }
+
+    // Bandwidth estimate : every access is taken as one full pass over the target and its levels, which overestimates
+    // the sparse reads (SAO taps in the depth pyramid...) but ranks the formats by their real cost
+    this->readBandwidth = 0.0f;
+    this->writeBandwidth = 0.0f;
+
+    for (GLuint i = 0; i < this->graphTargets.size(); ++i)
+    {
+        this->readBandwidth += this->getTargetMemory(i) * this->graphTargets[i].targetReads;
+        this->writeBandwidth += this->getTargetMemory(i) * this->graphTargets[i].targetWrites;
+    }
+
+    // Pool mapping, in order of first use : a target takes the first compatible entry which is free again by then
+    std::vector<GLuint> targetOrder;
+
+    for (GLuint i = 0; i < this->graphTargets.size(); ++i)
+    {
+        if (!this->graphTargets[i].targetImported && this->graphTargets[i].targetFirstPass >= 0)
+            targetOrder.push_back(i);
+    }
+
+    std::stable_sort(targetOrder.begin(), targetOrder.end(), [this](GLuint a, GLuint b)
+    {
+        return this->graphTargets[a].targetFirstPass < this->graphTargets[b].targetFirstPass;
+    });
+
+    for (RenderPoolEntry& entry : this->poolEntries)
+    {
+        entry.entryBusyUntil = -1;
+        entry.entryUsed = false;
+    }
+
+    size_t poolSize = this->poolEntries.size();
+
+    this->unaliasedMemory = 0.0f;
+
+    for (GLuint index : targetOrder)
+    {
+        RenderTarget& target = this->graphTargets[index];
+        GLint entryIndex = this->acquireEntry(target);
+        RenderPoolEntry& entry = this->poolEntries[entryIndex];
+
+        entry.entryBusyUntil = target.targetLastPass;
+        target.targetTexture = this->getEntryView(entry, target.targetFormat);
+
+        this->unaliasedMemory += getLevelsMemory(target.targetWidth, target.targetHeight, target.targetLevels, getFormatBits(target.targetFormat));
+    }
+
+    bool poolChanged = this->poolEntries.size() != poolSize;
+
+    // Entries left unused by this compile are released, and with them every cached FBO which might reference their textures
+    for (GLint i = GLint(this->poolEntries.size()) - 1; i >= 0; --i)
+    {
+        if (this->poolEntries[i].entryUsed)
+            continue;
+
+        this->releaseEntry(this->poolEntries[i]);
+        this->poolEntries.erase(this->poolEntries.begin() + i);
+        poolChanged = true;
+    }
+
+    if (poolChanged)
+    {
+        for (const std::pair<const std::vector<GLuint>, GLuint>& fbo : this->fboCache)
+            glDeleteFramebuffers(1, &fbo.second);
+
+        this->fboCache.clear();
+    }
+
+    this->peakMemory = 0.0f;
+
+    for (const RenderPoolEntry& entry : this->poolEntries)
+        this->peakMemory += getLevelsMemory(entry.entryWidth, entry.entryHeight, entry.entryLevels, entry.entryBits);
+
+    this->compileTime = std::chrono::duration<GLfloat, std::milli>(std::chrono::high_resolution_clock::now() - compileStart).count();
+}
+
+
+void RenderGraph::executeGraph()
+{
+    for (const RenderPass& pass : this->graphPasses)
+    {
+        if (pass.passCulled)
+            continue;
+
+        // Every pass is a profiler zone of its own, on both timelines
+        ProfilerGPUScope passScope(pass.passName.c_str());
+
+        this->bindPassFramebuffer(pass);
+        pass.passExecute();
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+// 0 for a culled (or never written) transient target, which then reads as black when bound
+GLuint RenderGraph::getTexture(GLuint target)
+{
+    return this->graphTargets[target].targetTexture;
+}
+
+
+bool RenderGraph::isPassCulled(GLuint pass)
+{
+    return this->graphPasses[pass].passCulled;
+}
+
+
+// Framebuffer holding a single target, bound for reading (blits from a transient target)
+void RenderGraph::bindReadTarget(GLuint target)
+{
+    const RenderTarget& readTarget = this->graphTargets[target];
+    std::vector<GLuint> colorTextures;
+    GLuint depthTexture = 0;
+
+    if (isDepthFormat(readTarget.targetFormat))
+        depthTexture = readTarget.targetTexture;
+    else
+        colorTextures.push_back(readTarget.targetTexture);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, this->getFramebuffer(colorTextures, depthTexture, readTarget.targetFormat, readTarget.targetName));
+}
+
+
+GLuint RenderGraph::getPassCount()
+{
+    return GLuint(this->graphPasses.size());
+}
+
+
+GLuint RenderGraph::getCulledCount()
+{
+    return this->culledCount;
+}
+
+
+GLuint RenderGraph::getPoolSize()
+{
+    return GLuint(this->poolEntries.size());
+}
+
+
+GLuint RenderGraph::getTargetCount()
+{
+    return GLuint(this->graphTargets.size());
+}
+
+
+const RenderTarget& RenderGraph::getTarget(GLuint target)
+{
+    return this->graphTargets[target];
+}
+
+
+// Size of the target alone, in MB, whether it ends up aliased in the pool or not
+GLfloat RenderGraph::getTargetMemory(GLuint target)
+{
+    const RenderTarget& memoryTarget = this->graphTargets[target];
+
+    return getLevelsMemory(memoryTarget.targetWidth, memoryTarget.targetHeight, memoryTarget.targetLevels, getFormatBits(memoryTarget.targetFormat));
+}
+
+
+// Memory of the pool textures backing the transient targets of the last compile, in MB
+GLfloat RenderGraph::getPeakMemory()
+{
+    return this->peakMemory;
+}
+
+
+// Memory the same targets would take with a texture each, in MB
+GLfloat RenderGraph::getUnaliasedMemory()
+{
+    return this->unaliasedMemory;
+}
+
+
+// Estimated traffic of the kept passes of the last compile, in MB per frame
+GLfloat RenderGraph::getReadBandwidth()
+{
+    return this->readBandwidth;
+}
+
+
+GLfloat RenderGraph::getWriteBandwidth()
+{
+    return this->writeBandwidth;
+}
+
+
+GLfloat RenderGraph::getCompileTime()
+{
+    return this->compileTime;
+}
+
+
+// Texel size of the sized internal formats, the texture view classes of the GL 4.3 specification being the formats of the same size
+GLuint RenderGraph::getFormatBits(GLenum format)
+{
+    switch (format)
+    {
+        case GL_RGBA32F:
+        case GL_RGBA32UI:
+        case GL_RGBA32I:
+            return 128;
+
+        case GL_RGB32F:
+        case GL_RGB32UI:
+        case GL_RGB32I:
+            return 96;
+
+        case GL_RGBA16F:
+        case GL_RG32F:
+        case GL_RGBA16UI:
+        case GL_RG32UI:
+        case GL_RGBA16I:
+        case GL_RG32I:
+        case GL_RGBA16:
+        case GL_RGBA16_SNORM:
+        case GL_DEPTH32F_STENCIL8:
+            return 64;
+
+        case GL_RGB16F:
+        case GL_RGB16UI:
+        case GL_RGB16I:
+        case GL_RGB16:
+        case GL_RGB16_SNORM:
+            return 48;
+
+        case GL_RG16F:
+        case GL_R11F_G11F_B10F:
+        case GL_R32F:
+        case GL_RGB10_A2UI:
+        case GL_RGBA8UI:
+        case GL_RG16UI:
+        case GL_R32UI:
+        case GL_RGBA8I:
+        case GL_RG16I:
+        case GL_R32I:
+        case GL_RGB10_A2:
+        case GL_RGBA8:
+        case GL_RG16:
+        case GL_RGBA8_SNORM:
+        case GL_SRGB8_ALPHA8:
+        case GL_RG16_SNORM:
+        case GL_RGB9_E5:
+        case GL_DEPTH24_STENCIL8:
+        case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH_COMPONENT32:
+            return 32;
+
+        case GL_RGB8:
+        case GL_RGB8UI:
+        case GL_RGB8I:
+        case GL_RGB8_SNORM:
+        case GL_SRGB8:
+        case GL_DEPTH_COMPONENT24:
+            return 24;
+
+        case GL_R16F:
+        case GL_RG8UI:
+        case GL_R16UI:
+        case GL_RG8I:
+        case GL_R16I:
+        case GL_RG8:
+        case GL_R16:
+        case GL_RG8_SNORM:
+        case GL_R16_SNORM:
+        case GL_DEPTH_COMPONENT16:
+            return 16;
+
+        case GL_R8UI:
+        case GL_R8I:
+        case GL_R8:
+        case GL_R8_SNORM:
+            return 8;
+
+        default:
+            return 0;
+    }
+}
+
+
+// Size of a texture and its mip chain, in MB
+GLfloat RenderGraph::getLevelsMemory(GLuint width, GLuint height, GLuint levels, GLuint bits)
+{
+    GLfloat levelsMemory = 0.0f;
+
+    for (GLuint level = 0; level < levels; ++level)
+        levelsMemory += GLfloat(std::max(width >> level, 1u)) * std::max(height >> level, 1u) * bits / 8.0f / (1024.0f * 1024.0f);
+
+    return levelsMemory;
+}
+
+
+bool RenderGraph::isDepthFormat(GLenum format)
+{
+    return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32 || format == GL_DEPTH_COMPONENT32F
+        || format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+
+const char* RenderGraph::getFormatName(GLenum format)
+{
+    switch (format)
+    {
+        case GL_RGBA32F: return "RGBA32F";
+        case GL_RGB32F: return "RGB32F";
+        case GL_RGBA16F: return "RGBA16F";
+        case GL_RGB16F: return "RGB16F";
+        case GL_RG32F: return "RG32F";
+        case GL_RG16F: return "RG16F";
+        case GL_R32F: return "R32F";
+        case GL_R16F: return "R16F";
+        case GL_R11F_G11F_B10F: return "R11G11B10F";
+        case GL_RGB9_E5: return "RGB9E5";
+        case GL_RGB10_A2: return "RGB10A2";
+        case GL_RGBA16: return "RGBA16";
+        case GL_RG16: return "RG16";
+        case GL_R16: return "R16";
+        case GL_RGBA8: return "RGBA8";
+        case GL_SRGB8_ALPHA8: return "SRGB8A8";
+        case GL_RG8: return "RG8";
+        case GL_R8: return "R8";
+        case GL_DEPTH24_STENCIL8: return "D24S8";
+        case GL_DEPTH32F_STENCIL8: return "D32FS8";
+        case GL_DEPTH_COMPONENT32F: return "D32F";
+        case GL_DEPTH_COMPONENT24: return "D24";
+        case GL_DEPTH_COMPONENT16: return "D16";
+
+        default:
+            return "Unknown";
+    }
+}
+
+
+// Color targets alias any entry of their texel size through a texture view, depth targets (which cannot be viewed
+// as another format) and unknown formats only reuse entries of their exact format
+GLint RenderGraph::acquireEntry(const RenderTarget& target)
+{
+    GLuint targetBits = getFormatBits(target.targetFormat);
+    bool exactFormat = isDepthFormat(target.targetFormat) || targetBits == 0;
+
+    for (GLuint i = 0; i < this->poolEntries.size(); ++i)
+    {
+        RenderPoolEntry& entry = this->poolEntries[i];
+
+        if (entry.entryWidth != target.targetWidth || entry.entryHeight != target.targetHeight || entry.entryLevels != target.targetLevels
+            || entry.entryBusyUntil >= target.targetFirstPass)
+            continue;
+
+        if (exactFormat ? entry.entryFormat != target.targetFormat : (isDepthFormat(entry.entryFormat) || entry.entryBits != targetBits))
+            continue;
+
+        entry.entryUsed = true;
+
+        return i;
+    }
+
+    RenderPoolEntry entry;
+    entry.entryFormat = target.targetFormat;
+    entry.entryWidth = target.targetWidth;
+    entry.entryHeight = target.targetHeight;
+    entry.entryLevels = target.targetLevels;
+    entry.entryBits = targetBits;
+    entry.entryBusyUntil = -1;
+    entry.entryUsed = true;
+
+    // Immutable storage, required for texture views
+    glGenTextures(1, &entry.entryTexture);
+    glBindTexture(GL_TEXTURE_2D, entry.entryTexture);
+    glTexStorage2D(GL_TEXTURE_2D, target.targetLevels, target.targetFormat, target.targetWidth, target.targetHeight);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, target.targetLevels > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    this->poolEntries.push_back(entry);
+
+    return GLint(this->poolEntries.size() - 1);
+}
+
+
+GLuint RenderGraph::getEntryView(RenderPoolEntry& entry, GLenum format)
+{
+    if (format == entry.entryFormat)
+        return entry.entryTexture;
+
+    for (const std::pair<GLenum, GLuint>& view : entry.entryViews)
+    {
+        if (view.first == format)
+            return view.second;
+    }
+
+    GLuint viewTexture;
+    glGenTextures(1, &viewTexture);
+    glTextureView(viewTexture, GL_TEXTURE_2D, entry.entryTexture, format, 0, entry.entryLevels, 0, 1);
+    glBindTexture(GL_TEXTURE_2D, viewTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, entry.entryLevels > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    entry.entryViews.push_back(std::make_pair(format, viewTexture));
+
+    return viewTexture;
+}
+
+
+void RenderGraph::releaseEntry(RenderPoolEntry& entry)
+{
+    for (const std::pair<GLenum, GLuint>& view : entry.entryViews)
+        glDeleteTextures(1, &view.second);
+
+    glDeleteTextures(1, &entry.entryTexture);
+    entry.entryViews.clear();
+}
+
+
+// Color writes go to the attachments in declaration order, a depth format to the depth (and stencil) attachment,
+// and a pass drawing to the default framebuffer binds it instead. Passes with no attachment (compute) bind nothing
+void RenderGraph::bindPassFramebuffer(const RenderPass& pass)
+{
+    if (pass.passWrites.empty())
+        return;
+
+    const RenderTarget& sizeTarget = this->graphTargets[pass.passWrites[0]];
+    std::vector<GLuint> colorTextures;
+    GLuint depthTexture = 0;
+    GLenum depthFormat = GL_NONE;
+    bool defaultFramebuffer = false;
+
+    for (GLuint index : pass.passWrites)
+    {
+        const RenderTarget& target = this->graphTargets[index];
+
+        if (target.targetImported && target.targetTexture == 0)
+            defaultFramebuffer = true;
+        else if (isDepthFormat(target.targetFormat))
+        {
+            depthTexture = target.targetTexture;
+            depthFormat = target.targetFormat;
+        }
+        else
+            colorTextures.push_back(target.targetTexture);
+    }
+
+    glViewport(0, 0, sizeTarget.targetWidth, sizeTarget.targetHeight);
+
+    if (defaultFramebuffer)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, this->getFramebuffer(colorTextures, depthTexture, depthFormat, pass.passName));
+}
+
+
+GLuint RenderGraph::getFramebuffer(const std::vector<GLuint>& colorTextures, GLuint depthTexture, GLenum depthFormat, const std::string& name)
+{
+    std::vector<GLuint> fboKey(colorTextures);
+    fboKey.push_back(depthTexture);
+
+    std::map<std::vector<GLuint>, GLuint>::iterator cachedFBO = this->fboCache.find(fboKey);
+
+    if (cachedFBO != this->fboCache.end())
+        return cachedFBO->second;
+
+    GLuint passFBO;
+    glGenFramebuffers(1, &passFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, passFBO);
+
+    std::vector<GLenum> attachments;
+
+    for (GLuint i = 0; i < colorTextures.size(); ++i)
+    {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorTextures[i], 0);
+        attachments.push_back(GL_COLOR_ATTACHMENT0 + i);
+    }
+
+    if (depthTexture)
+    {
+        bool depthStencil = depthFormat == GL_DEPTH24_STENCIL8 || depthFormat == GL_DEPTH32F_STENCIL8;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, depthStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    }
+
+    if (attachments.empty())
+        glDrawBuffer(GL_NONE);
+    else
+        glDrawBuffers(GLsizei(attachments.size()), attachments.data());
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Render Graph Framebuffer not complete ! (" << name << ")" << std::endl;
+
+    this->fboCache[fboKey] = passFBO;
+
+    return passFBO;
+}
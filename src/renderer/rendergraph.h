@@ -0,0 +1,131 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <map>
+#include <functional>
+
+#include <glad/glad.h>
+
+
+// Render target declared to the graph, either transient (backed by the pool during its lifetime only) or imported
+struct RenderTarget
+{
+    std::string targetName;
+    GLenum targetFormat;
+    GLuint targetWidth;
+    GLuint targetHeight;
+    GLuint targetLevels;
+    bool targetImported;
+    GLuint targetTexture;       // Resolved by compileGraph() for the transient ones, 0 for the default framebuffer
+    GLint targetFirstPass;
+    GLint targetLastPass;
+    GLuint targetReads;         // Kept passes reading and writing the target, for the bandwidth estimate
+    GLuint targetWrites;
+};
+
+
+// Row of the format table : the format of a target in every format preset, the last one standing for the presets past the end
+struct RenderFormat
+{
+    std::string formatTarget;
+    std::vector<GLenum> formatPresets;
+};
+
+
+// Pass with its declared accesses, the color writes being attached in declaration order (depth formats go to the depth attachment)
+struct RenderPass
+{
+    std::string passName;
+    std::function<void()> passExecute;
+    std::vector<GLuint> passReads;
+    std::vector<GLuint> passWrites;
+    std::vector<GLuint> passImageWrites;
+    bool passCulled;
+};
+
+
+// Storage of the pool : immutable texture storage, shared by every target of the same size and texel size (and by texture views
+// of the other formats of that view class) as long as their lifetimes in the frame do not overlap
+struct RenderPoolEntry
+{
+    GLuint entryTexture;
+    GLenum entryFormat;
+    GLuint entryWidth;
+    GLuint entryHeight;
+    GLuint entryLevels;
+    GLuint entryBits;
+    GLint entryBusyUntil;
+    bool entryUsed;
+    std::vector<std::pair<GLenum, GLuint>> entryViews;
+};
+
+
+// Frame graph of the deferred pipeline : the passes and their targets are declared again every frame, then compileGraph() culls
+// the passes whose outputs nobody reads, computes the target lifetimes and maps them on the pool, and executeGraph() runs the
+// remaining passes with their framebuffer bound (FBOs are cached per attachment set)
+class RenderGraph
+{
+    public:
+        RenderGraph();
+        ~RenderGraph();
+        void beginGraph();
+        GLuint createTarget(const std::string& name, GLenum format, GLuint width, GLuint height, GLuint levels = 1);
+        GLuint importTarget(const std::string& name, GLuint texture, GLenum format, GLuint width, GLuint height);
+        GLuint addPass(const std::string& name, const std::function<void()>& execute);
+        void readTarget(GLuint pass, GLuint target);
+        void writeTarget(GLuint pass, GLuint target);
+        void writeImage(GLuint pass, GLuint target);
+        void setOutput(GLuint target);
+        void setFormatTable(const std::vector<RenderFormat>& table);
+        void setFormatPreset(GLuint preset);
+        GLenum getFormat(const std::string& name);
+        void compileGraph();
+        void executeGraph();
+        GLuint getTexture(GLuint target);
+        void bindReadTarget(GLuint target);
+        bool isPassCulled(GLuint pass);
+        GLuint getPassCount();
+        GLuint getCulledCount();
+        GLuint getPoolSize();
+        GLuint getTargetCount();
+        const RenderTarget& getTarget(GLuint target);
+        GLfloat getTargetMemory(GLuint target);
+        GLfloat getPeakMemory();
+        GLfloat getUnaliasedMemory();
+        GLfloat getReadBandwidth();
+        GLfloat getWriteBandwidth();
+        GLfloat getCompileTime();
+        static GLuint getFormatBits(GLenum format);
+        static bool isDepthFormat(GLenum format);
+        static const char* getFormatName(GLenum format);
+        static GLfloat getLevelsMemory(GLuint width, GLuint height, GLuint levels, GLuint bits);
+
+    private:
+        std::vector<RenderTarget> graphTargets;
+        std::vector<RenderPass> graphPasses;
+        std::vector<GLuint> graphOutputs;
+        std::vector<RenderPoolEntry> poolEntries;
+        std::map<std::vector<GLuint>, GLuint> fboCache;
+        std::vector<RenderFormat> formatTable;
+
+        GLuint culledCount = 0;
+        GLuint formatPreset = 0;
+        GLfloat peakMemory = 0.0f;
+        GLfloat unaliasedMemory = 0.0f;
+        GLfloat readBandwidth = 0.0f;
+        GLfloat writeBandwidth = 0.0f;
+        GLfloat compileTime = 0.0f;
+
+        GLint acquireEntry(const RenderTarget& target);
+        GLuint getEntryView(RenderPoolEntry& entry, GLenum format);
+        void releaseEntry(RenderPoolEntry& entry);
+        void bindPassFramebuffer(const RenderPass& pass);
+        GLuint getFramebuffer(const std::vector<GLuint>& colorTextures, GLuint depthTexture, GLenum depthFormat, const std::string& name);
+};
+
+#endif
@@ -0,0 +1,152 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "iblcache.h"
+
+
+static void readCube(Texture& cube, GLuint mips, std::vector<GLushort>& texels)
+{
+    texels.resize(IBLFile::computeTexelCount(cube.getTexWidth(), mips, 6, cube.texComponents));
+    GLushort* texelData = texels.data();
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cube.getTexID());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    for (GLuint mip = 0; mip < mips; ++mip)
+    {
+        for (GLuint face = 0; face < 6; ++face)
+        {
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, cube.texFormat, GL_HALF_FLOAT, texelData);
+            texelData += size_t(cube.getTexWidth() >> mip) * (cube.getTexWidth() >> mip) * cube.texComponents;
+        }
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+
+static void uploadCube(Texture& cube, GLuint mips, const std::vector<GLushort>& texels)
+{
+    const GLushort* texelData = texels.data();
+
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cube.getTexID());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    for (GLuint mip = 0; mip < mips; ++mip)
+    {
+        GLuint mipSize = cube.getTexWidth() >> mip;
+
+        for (GLuint face = 0; face < 6; ++face)
+        {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, cube.texInternalFormat, mipSize, mipSize, 0, cube.texFormat, GL_HALF_FLOAT, texelData);
+            texelData += size_t(mipSize) * mipSize * cube.texComponents;
+        }
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+
+IBLCache::IBLCache()
+{
+
+}
+
+
+IBLCache::~IBLCache()
+{
+
+}
+
+
+void IBLCache::setCacheDirectory(std::string directory)
+{
+    this->cacheDirectory = directory;
+}
+
+
+std::string IBLCache::getCachePath(const std::string& key)
+{
+    return this->cacheDirectory + key + ".ibl";
+}
+
+
+std::string IBLCache::computeKey(const std::string& hdrPath, GLuint cubeSize, GLuint prefilterSize, GLuint prefilterMips, GLuint sampleCount)
+{
+    return IBLFile::computeKey(hdrPath, cubeSize, prefilterSize, prefilterMips, sampleCount);
+}
+
+
+// Nothing is uploaded unless the whole entry could be read, the environment cube mips are rebuilt from its base level
+bool IBLCache::loadEnvironment(const std::string& key, Texture& envMapCube, Texture& envMapPrefilter, GLuint prefilterMips, IrradianceSH& irradianceSH)
+{
+    std::vector<GLushort> cubeTexels, prefilterTexels;
+    float shCoefficients[IBLFile::shFloatCount];
+
+    if (key.empty() || !IBLFile::readEnvironment(this->getCachePath(key), envMapCube.getTexWidth(), envMapPrefilter.getTexWidth(), prefilterMips,
+                                                 envMapCube.texComponents, cubeTexels, shCoefficients, prefilterTexels))
+        return false;
+
+    uploadCube(envMapCube, 1, cubeTexels);
+    envMapCube.computeTexMipmap();
+    uploadCube(envMapPrefilter, prefilterMips, prefilterTexels);
+    irradianceSH.setCoefficients(shCoefficients);
+
+    return true;
+}
+
+
+void IBLCache::saveEnvironment(const std::string& key, Texture& envMapCube, Texture& envMapPrefilter, GLuint prefilterMips, IrradianceSH& irradianceSH)
+{
+    if (key.empty())
+        return;
+
+    std::vector<GLushort> cubeTexels, prefilterTexels;
+    std::string cachePath = this->getCachePath(key);
+
+    readCube(envMapCube, 1, cubeTexels);
+    readCube(envMapPrefilter, prefilterMips, prefilterTexels);
+
+    if (!IBLFile::writeEnvironment(cachePath, envMapCube.getTexWidth(), envMapPrefilter.getTexWidth(), prefilterMips, envMapCube.texComponents,
+                                   cubeTexels, irradianceSH.getCoefficients(), prefilterTexels))
+        std::cerr << "IBL CACHE - FAILED WRITING : " << cachePath << std::endl;
+}
+
+
+bool IBLCache::loadLUT(const std::string& lutPath, Texture& envMapLUT)
+{
+    std::vector<GLushort> texels;
+
+    if (!IBLFile::readLUT(lutPath, envMapLUT.getTexWidth(), envMapLUT.texComponents, texels))
+        return false;
+
+    glBindTexture(GL_TEXTURE_2D, envMapLUT.getTexID());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, envMapLUT.texInternalFormat, envMapLUT.getTexWidth(), envMapLUT.getTexHeight(), 0, envMapLUT.texFormat, GL_HALF_FLOAT, texels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    return true;
+}
+
+
+void IBLCache::saveLUT(const std::string& lutPath, Texture& envMapLUT)
+{
+    std::vector<GLushort> texels(size_t(envMapLUT.getTexWidth()) * envMapLUT.getTexHeight() * envMapLUT.texComponents);
+
+    glBindTexture(GL_TEXTURE_2D, envMapLUT.getTexID());
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(GL_TEXTURE_2D, 0, envMapLUT.texFormat, GL_HALF_FLOAT, texels.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (!IBLFile::writeLUT(lutPath, envMapLUT.getTexWidth(), envMapLUT.texComponents, texels))
+        std::cerr << "IBL CACHE - FAILED WRITING : " << lutPath << std::endl;
+}
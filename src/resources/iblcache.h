@@ -0,0 +1,37 @@
+#ifndef IBLCACHE_H
+#define IBLCACHE_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "texture.h"
+#include "iblfile.h"
+#include "irradiancesh.h"
+
+
+// Baked IBL outputs kept on disk between runs : the environment cube, the prefiltered mips and the SH irradiance of an HDR map,
+// keyed by a hash of the HDR file content and of the bake parameters. The BRDF LUT does not depend on the environment,
+// it is shipped as a data file of its own and only baked when that file is missing. The file layout itself lives in IBLFile
+class IBLCache
+{
+    public:
+        IBLCache();
+        ~IBLCache();
+        void setCacheDirectory(std::string directory);
+        std::string getCachePath(const std::string& key);
+        std::string computeKey(const std::string& hdrPath, GLuint cubeSize, GLuint prefilterSize, GLuint prefilterMips, GLuint sampleCount);
+        bool loadEnvironment(const std::string& key, Texture& envMapCube, Texture& envMapPrefilter, GLuint prefilterMips, IrradianceSH& irradianceSH);
+        void saveEnvironment(const std::string& key, Texture& envMapCube, Texture& envMapPrefilter, GLuint prefilterMips, IrradianceSH& irradianceSH);
+        bool loadLUT(const std::string& lutPath, Texture& envMapLUT);
+        void saveLUT(const std::string& lutPath, Texture& envMapLUT);
+
+    private:
+        std::string cacheDirectory = "resources/cache/ibl/";
+};
+
+#endif
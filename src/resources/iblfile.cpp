@@ -0,0 +1,137 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <cstring>
+
+#include "iblfile.h"
+
+
+const char iblCubeMagic[8] = "IBLCUBE";
+const char iblLUTMagic[8] = "IBLLUT";
+
+
+// FNV-1a over the HDR file content then over the bake parameters, an empty key meaning the HDR file could not be read
+std::string IBLFile::computeKey(const std::string& hdrPath, unsigned int cubeSize, unsigned int prefilterSize, unsigned int prefilterMips, unsigned int sampleCount)
+{
+    std::ifstream hdrFile(hdrPath.c_str(), std::ios::binary);
+
+    if (!hdrFile)
+        return std::string();
+
+    unsigned long long keyHash = 14695981039346656037ull;
+    std::vector<char> fileChunk(1 << 16);
+
+    while (hdrFile)
+    {
+        hdrFile.read(fileChunk.data(), fileChunk.size());
+
+        for (std::streamsize i = 0; i < hdrFile.gcount(); ++i)
+            keyHash = (keyHash ^ (unsigned char)fileChunk[i]) * 1099511628211ull;
+    }
+
+    unsigned int bakeParameters[5] = { fileVersion, cubeSize, prefilterSize, prefilterMips, sampleCount };
+    const unsigned char* parameterBytes = reinterpret_cast<const unsigned char*>(bakeParameters);
+
+    for (size_t i = 0; i < sizeof(bakeParameters); ++i)
+        keyHash = (keyHash ^ parameterBytes[i]) * 1099511628211ull;
+
+    std::stringstream keyStream;
+    keyStream << std::hex << keyHash;
+
+    return keyStream.str();
+}
+
+
+size_t IBLFile::computeTexelCount(unsigned int size, unsigned int mips, unsigned int faces, unsigned int components)
+{
+    size_t texelCount = 0;
+
+    for (unsigned int mip = 0; mip < mips; ++mip)
+        texelCount += size_t(size >> mip) * (size >> mip) * faces * components;
+
+    return texelCount;
+}
+
+
+bool IBLFile::readEnvironment(const std::string& path, unsigned int cubeSize, unsigned int prefilterSize, unsigned int prefilterMips, unsigned int components,
+                              std::vector<unsigned short>& cubeTexels, float* shCoefficients, std::vector<unsigned short>& prefilterTexels)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+
+    if (!file || !readSection(file, iblCubeMagic, cubeSize, 1, 6, components, cubeTexels))
+        return false;
+
+    file.read(reinterpret_cast<char*>(shCoefficients), shFloatCount * sizeof(float));
+
+    return file && readSection(file, iblCubeMagic, prefilterSize, prefilterMips, 6, components, prefilterTexels);
+}
+
+
+bool IBLFile::writeEnvironment(const std::string& path, unsigned int cubeSize, unsigned int prefilterSize, unsigned int prefilterMips, unsigned int components,
+                               const std::vector<unsigned short>& cubeTexels, const float* shCoefficients, const std::vector<unsigned short>& prefilterTexels)
+{
+    std::ofstream file(path.c_str(), std::ios::binary);
+
+    if (!file)
+        return false;
+
+    writeSection(file, iblCubeMagic, cubeSize, 1, components, cubeTexels);
+    file.write(reinterpret_cast<const char*>(shCoefficients), shFloatCount * sizeof(float));
+    writeSection(file, iblCubeMagic, prefilterSize, prefilterMips, components, prefilterTexels);
+
+    return bool(file);
+}
+
+
+bool IBLFile::readLUT(const std::string& path, unsigned int size, unsigned int components, std::vector<unsigned short>& texels)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+
+    return file && readSection(file, iblLUTMagic, size, 1, 1, components, texels);
+}
+
+
+bool IBLFile::writeLUT(const std::string& path, unsigned int size, unsigned int components, const std::vector<unsigned short>& texels)
+{
+    std::ofstream file(path.c_str(), std::ios::binary);
+
+    if (!file)
+        return false;
+
+    writeSection(file, iblLUTMagic, size, 1, components, texels);
+
+    return bool(file);
+}
+
+
+void IBLFile::writeSection(std::ofstream& file, const char* magic, unsigned int size, unsigned int mips, unsigned int components, const std::vector<unsigned short>& texels)
+{
+    IBLFileHeader header;
+    std::memcpy(header.fileMagic, magic, sizeof(header.fileMagic));
+    header.fileVersion = fileVersion;
+    header.texSize = size;
+    header.texMips = mips;
+    header.texComponents = components;
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(texels.data()), texels.size() * sizeof(unsigned short));
+}
+
+
+// Fails on any mismatch with the expected layout, the caller then falls back to baking
+bool IBLFile::readSection(std::ifstream& file, const char* magic, unsigned int size, unsigned int mips, unsigned int faces, unsigned int components, std::vector<unsigned short>& texels)
+{
+    IBLFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    if (!file || std::memcmp(header.fileMagic, magic, sizeof(header.fileMagic)) || header.fileVersion != fileVersion
+        || header.texSize != size || header.texMips != mips || header.texComponents != components)
+        return false;
+
+    texels.resize(computeTexelCount(size, mips, faces, components));
+    file.read(reinterpret_cast<char*>(texels.data()), texels.size() * sizeof(unsigned short));
+
+    return bool(file);
+}
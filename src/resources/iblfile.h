@@ -0,0 +1,44 @@
+#ifndef IBLFILE_H
+#define IBLFILE_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+
+
+// On-disk layout of the baked IBL data, shared by the engine cache and the offline CPU baker, thus free of any GL call.
+// An environment entry is a cube section (environment cube base level), the SH irradiance coefficients, then a cube section
+// (prefiltered mips). The LUT file is a single 2D section. Texels are half floats, faces in +X, -X, +Y, -Y, +Z, -Z order and mip after mip
+class IBLFile
+{
+    public:
+        // Bumped whenever the bake shaders or the file layout change, which invalidates every cache entry
+        static const unsigned int fileVersion = 1;
+        static const unsigned int shFloatCount = 27;
+
+        struct IBLFileHeader
+        {
+            char fileMagic[8];
+            unsigned int fileVersion;
+            unsigned int texSize;
+            unsigned int texMips;
+            unsigned int texComponents;
+        };
+
+        static std::string computeKey(const std::string& hdrPath, unsigned int cubeSize, unsigned int prefilterSize, unsigned int prefilterMips, unsigned int sampleCount);
+        static size_t computeTexelCount(unsigned int size, unsigned int mips, unsigned int faces, unsigned int components);
+        static bool readEnvironment(const std::string& path, unsigned int cubeSize, unsigned int prefilterSize, unsigned int prefilterMips, unsigned int components,
+                                    std::vector<unsigned short>& cubeTexels, float* shCoefficients, std::vector<unsigned short>& prefilterTexels);
+        static bool writeEnvironment(const std::string& path, unsigned int cubeSize, unsigned int prefilterSize, unsigned int prefilterMips, unsigned int components,
+                                     const std::vector<unsigned short>& cubeTexels, const float* shCoefficients, const std::vector<unsigned short>& prefilterTexels);
+        static bool readLUT(const std::string& path, unsigned int size, unsigned int components, std::vector<unsigned short>& texels);
+        static bool writeLUT(const std::string& path, unsigned int size, unsigned int components, const std::vector<unsigned short>& texels);
+
+    private:
+        static void writeSection(std::ofstream& file, const char* magic, unsigned int size, unsigned int mips, unsigned int components, const std::vector<unsigned short>& texels);
+        static bool readSection(std::ifstream& file, const char* magic, unsigned int size, unsigned int mips, unsigned int faces, unsigned int components, std::vector<unsigned short>& texels);
+};
+
+#endif
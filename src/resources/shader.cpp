@@ -2,12 +2,159 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <map>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 #include <glad/glad.h>
 
 #include "shader.h"
 
 
+#ifndef GL_COMPLETION_STATUS_ARB
+#define GL_COMPLETION_STATUS_ARB 0x91B1    // ARB/KHR_parallel_shader_compile, not exposed by our GLAD build
+#endif
+
+
+// Shared between the render thread and the inotify thread, allocated once and never freed so that
+// the global Shader objects can still unregister themselves at exit, whatever the static destruction order
+struct ShaderWatcher
+{
+    std::mutex watchMutex;
+    std::vector<Shader*> watchedShaders;
+    std::set<Shader*> modifiedShaders;
+    std::map<int, std::string> watchedDirectories;
+    std::thread watchThread;
+    std::atomic<bool> watchRunning;
+    int inotifyFD = -1;
+    bool parallelCompile = false;
+
+    ShaderWatcher() : watchRunning(false) {}
+};
+
+
+static ShaderWatcher& getShaderWatcher()
+{
+    static ShaderWatcher* shaderWatcher = new ShaderWatcher();
+
+    return *shaderWatcher;
+}
+
+
+static std::string getFileDirectory(const std::string& path)
+{
+    size_t separator = path.find_last_of('/');
+
+    return (separator == std::string::npos) ? std::string(".") : path.substr(0, separator);
+}
+
+
+static std::string getFileName(const std::string& path)
+{
+    size_t separator = path.find_last_of('/');
+
+    return (separator == std::string::npos) ? path : path.substr(separator + 1);
+}
+
+
+static std::string getStageName(GLenum stage)
+{
+    if (stage == GL_VERTEX_SHADER)
+        return "VERTEX";
+    else if (stage == GL_GEOMETRY_SHADER)
+        return "GEOMETRY";
+    else if (stage == GL_FRAGMENT_SHADER)
+        return "FRAGMENT";
+    else if (stage == GL_COMPUTE_SHADER)
+        return "COMPUTE";
+
+    return "UNKNOWN";
+}
+
+
+// Must be called with the watch mutex locked
+static void addDirectoryWatch(ShaderWatcher& watcher, const std::string& directory)
+{
+#ifdef __linux__
+    if (watcher.inotifyFD < 0)
+        return;
+
+    for (auto& watchedDirectory : watcher.watchedDirectories)
+    {
+        if (watchedDirectory.second == directory)
+            return;
+    }
+
+    // Watching the directory rather than the file itself, as most editors save by replacing the file
+    int watchDescriptor = inotify_add_watch(watcher.inotifyFD, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+
+    if (watchDescriptor < 0)
+        std::cout << "ERROR::SHADER::HOTRELOAD::CANNOT_WATCH " << directory << std::endl;
+    else
+        watcher.watchedDirectories[watchDescriptor] = directory;
+#else
+    (void)watcher;
+    (void)directory;
+#endif
+}
+
+
+#ifdef __linux__
+static void watchShaderFiles()
+{
+    ShaderWatcher& watcher = getShaderWatcher();
+    alignas(inotify_event) char eventBuffer[4096];
+
+    while (watcher.watchRunning)
+    {
+        pollfd pollDescriptor = { watcher.inotifyFD, POLLIN, 0 };
+
+        if (poll(&pollDescriptor, 1, 100) <= 0)
+            continue;
+
+        ssize_t eventLength = read(watcher.inotifyFD, eventBuffer, sizeof(eventBuffer));
+
+        if (eventLength <= 0)
+            continue;
+
+        std::lock_guard<std::mutex> watchLock(watcher.watchMutex);
+
+        for (char* eventPtr = eventBuffer; eventPtr < eventBuffer + eventLength; )
+        {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(eventPtr);
+            eventPtr += sizeof(inotify_event) + event->len;
+
+            if (event->len == 0)
+                continue;
+
+            const std::string& directory = watcher.watchedDirectories[event->wd];
+            std::string fileName(event->name);
+
+            for (Shader* shader : watcher.watchedShaders)
+            {
+                for (auto& stage : shader->getShaderStages())
+                {
+                    if (getFileDirectory(stage.second) == directory && getFileName(stage.second) == fileName)
+                        watcher.modifiedShaders.insert(shader);
+                }
+            }
+        }
+    }
+}
+#endif
+
+
+
 Shader::Shader()
 {
 
@@ -16,92 +163,304 @@ Shader::Shader()
 
 Shader::~Shader()
 {
+    ShaderWatcher& watcher = getShaderWatcher();
+    std::lock_guard<std::mutex> watchLock(watcher.watchMutex);
 
+    watcher.watchedShaders.erase(std::remove(watcher.watchedShaders.begin(), watcher.watchedShaders.end(), this), watcher.watchedShaders.end());
+    watcher.modifiedShaders.erase(this);
 }
 
 
 void Shader::setShader(const GLchar* vertexPath, const GLchar* fragmentPath)
 {
-    // Shaders reading
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
+    std::vector<std::pair<GLenum, std::string>> stages;
+    stages.push_back(std::make_pair(GL_VERTEX_SHADER, std::string(vertexPath)));
+    stages.push_back(std::make_pair(GL_FRAGMENT_SHADER, std::string(fragmentPath)));
 
-    vShaderFile.exceptions(std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::badbit);
+    this->setShaderStages(stages);
+}
+
+
+void Shader::setShader(const GLchar* vertexPath, const GLchar* geometryPath, const GLchar* fragmentPath)
+{
+    std::vector<std::pair<GLenum, std::string>> stages;
+    stages.push_back(std::make_pair(GL_VERTEX_SHADER, std::string(vertexPath)));
+    stages.push_back(std::make_pair(GL_GEOMETRY_SHADER, std::string(geometryPath)));
+    stages.push_back(std::make_pair(GL_FRAGMENT_SHADER, std::string(fragmentPath)));
+
+    this->setShaderStages(stages);
+}
+
+
+void Shader::setShader(const GLchar* computePath)
+{
+    std::vector<std::pair<GLenum, std::string>> stages;
+    stages.push_back(std::make_pair(GL_COMPUTE_SHADER, std::string(computePath)));
+
+    this->setShaderStages(stages);
+}
 
-    try
+
+void Shader::useShader()
+{
+    glUseProgram(this->Program);
+}
+
+
+const std::vector<std::pair<GLenum, std::string>>& Shader::getShaderStages()
+{
+    return this->shaderStages;
+}
+
+
+void Shader::startWatching()
+{
+    ShaderWatcher& watcher = getShaderWatcher();
+
+    if (watcher.watchRunning)
+        return;
+
+    // Without parallel compilation the driver compiles when we first query the program status,
+    // so the reload still happens off the frame in which the file was saved, but blocks once
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+
+    for (GLint i = 0; i < extensionCount; ++i)
     {
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
+        std::string extensionName = (const char*)glGetStringi(GL_EXTENSIONS, i);
 
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        vShaderFile.close();
-        fShaderFile.close();
+        if (extensionName == "GL_ARB_parallel_shader_compile" || extensionName == "GL_KHR_parallel_shader_compile")
+            watcher.parallelCompile = true;
+    }
+
+#ifdef __linux__
+    std::lock_guard<std::mutex> watchLock(watcher.watchMutex);
+
+    watcher.inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
 
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+    if (watcher.inotifyFD < 0)
+    {
+        std::cout << "ERROR::SHADER::HOTRELOAD::INOTIFY_INIT_FAILED" << std::endl;
+        return;
     }
 
-    catch (std::ifstream::failure e)
+    for (Shader* shader : watcher.watchedShaders)
     {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        for (auto& stage : shader->getShaderStages())
+            addDirectoryWatch(watcher, getFileDirectory(stage.second));
     }
 
-    const GLchar* vShaderCode = vertexCode.c_str();
-    const GLchar * fShaderCode = fragmentCode.c_str();
+    watcher.watchRunning = true;
+    watcher.watchThread = std::thread(watchShaderFiles);
+#else
+    std::cout << "SHADER::HOTRELOAD::UNSUPPORTED_PLATFORM" << std::endl;
+#endif
+}
 
-    // Shaders compilation
-    GLuint vertex, fragment;
-    GLint success;
-    GLchar infoLog[512];
 
-    // Vertex Shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
+void Shader::stopWatching()
+{
+    ShaderWatcher& watcher = getShaderWatcher();
+
+    if (!watcher.watchRunning)
+        return;
 
-    if (!success)
+    watcher.watchRunning = false;
+    watcher.watchThread.join();
+
+#ifdef __linux__
+    close(watcher.inotifyFD);
+#endif
+
+    watcher.inotifyFD = -1;
+    watcher.watchedDirectories.clear();
+}
+
+
+void Shader::setShaderStages(const std::vector<std::pair<GLenum, std::string>>& stages)
+{
+    // Register the shader for hot-reloading, the watcher thread reads the stages under the same lock
     {
-        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+        ShaderWatcher& watcher = getShaderWatcher();
+        std::lock_guard<std::mutex> watchLock(watcher.watchMutex);
+
+        this->shaderStages = stages;
+
+        if (std::find(watcher.watchedShaders.begin(), watcher.watchedShaders.end(), this) == watcher.watchedShaders.end())
+            watcher.watchedShaders.push_back(this);
+
+        for (auto& stage : this->shaderStages)
+            addDirectoryWatch(watcher, getFileDirectory(stage.second));
     }
 
-    // Fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
+    this->Program = this->compileProgram(true);
+}
+
+
+bool Shader::updateShaders()
+{
+    ShaderWatcher& watcher = getShaderWatcher();
+    std::set<Shader*> reloadShaders;
+    std::vector<Shader*> currentShaders;
 
-    if (!success)
     {
-        glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+        std::lock_guard<std::mutex> watchLock(watcher.watchMutex);
+        reloadShaders.swap(watcher.modifiedShaders);
+        currentShaders = watcher.watchedShaders;
+    }
+
+    for (Shader* shader : reloadShaders)
+        shader->beginReload();
+
+    bool programSwapped = false;
+
+    for (Shader* shader : currentShaders)
+    {
+        if (shader->pendingProgram && shader->endReload())
+            programSwapped = true;
+    }
+
+    return programSwapped;
+}
+
+
+GLuint Shader::compileProgram(bool waitCompletion)
+{
+    GLuint program = glCreateProgram();
+    std::vector<GLuint> shaders;
+
+    for (auto& stage : this->shaderStages)
+    {
+        // Shaders reading
+        std::string shaderCode;
+        std::ifstream shaderFile;
+
+        shaderFile.exceptions(std::ifstream::badbit);
+
+        try
+        {
+            shaderFile.open(stage.second);
+            std::stringstream shaderStream;
+
+            shaderStream << shaderFile.rdbuf();
+            shaderFile.close();
+
+            shaderCode = shaderStream.str();
+        }
+
+        catch (std::ifstream::failure e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ : " << stage.second << std::endl;
+        }
+
+        const GLchar* shaderCodePtr = shaderCode.c_str();
+
+        // Shader compilation, which returns immediately if the driver compiles in parallel
+        GLuint shader = glCreateShader(stage.first);
+        glShaderSource(shader, 1, &shaderCodePtr, NULL);
+        glCompileShader(shader);
+        glAttachShader(program, shader);
+
+        shaders.push_back(shader);
     }
 
     // Shader Program
-    this->Program = glCreateProgram();
-    glAttachShader(this->Program, vertex);
-    glAttachShader(this->Program, fragment);
-    glLinkProgram(this->Program);
-    glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
+    glLinkProgram(program);
+
+    if (waitCompletion)
+    {
+        this->checkProgram(program, shaders);
+
+        for (GLuint shader : shaders)
+            glDeleteShader(shader);
+    }
+    else
+    {
+        this->pendingShaders = shaders;
+    }
+
+    return program;
+}
+
+
+bool Shader::checkProgram(GLuint program, std::vector<GLuint>& shaders)
+{
+    GLint success;
+    GLchar infoLog[512];
+
+    for (GLuint shader : shaders)
+    {
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+
+        if (!success)
+        {
+            GLint shaderType;
+            glGetShaderiv(shader, GL_SHADER_TYPE, &shaderType);
+            glGetShaderInfoLog(shader, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::" << getStageName(shaderType) << "::COMPILATION_FAILED\n" << infoLog << std::endl;
+        }
+    }
+
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
 
     if (!success)
     {
-        glGetProgramInfoLog(this->Program, 512, NULL, infoLog);
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
     }
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    return success == GL_TRUE;
 }
 
 
-void Shader::useShader()
+void Shader::beginReload()
 {
-    glUseProgram(this->Program);
+    // A newer save supersedes a rebuild still in flight
+    if (this->pendingProgram)
+    {
+        for (GLuint shader : this->pendingShaders)
+            glDeleteShader(shader);
+
+        glDeleteProgram(this->pendingProgram);
+        this->pendingShaders.clear();
+    }
+
+    this->pendingProgram = this->compileProgram(false);
+}
+
+
+bool Shader::endReload()
+{
+    if (getShaderWatcher().parallelCompile)
+    {
+        GLint compileCompleted = GL_FALSE;
+        glGetProgramiv(this->pendingProgram, GL_COMPLETION_STATUS_ARB, &compileCompleted);
+
+        if (!compileCompleted)
+            return false;
+    }
+
+    bool programLinked = this->checkProgram(this->pendingProgram, this->pendingShaders);
+
+    for (GLuint shader : this->pendingShaders)
+        glDeleteShader(shader);
+
+    this->pendingShaders.clear();
+
+    // The previous program keeps rendering if the new one failed to build
+    if (programLinked)
+    {
+        glDeleteProgram(this->Program);
+        this->Program = this->pendingProgram;
+
+        std::cout << "SHADER::RELOADED : " << this->shaderStages.back().second << std::endl;
+    }
+    else
+    {
+        glDeleteProgram(this->pendingProgram);
+    }
+
+    this->pendingProgram = 0;
+
+    return programLinked;
 }
@@ -5,6 +5,8 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <utility>
 
 #include <glad/glad.h>
 
@@ -17,7 +19,27 @@ class Shader
         Shader();
         ~Shader();
         void setShader(const GLchar* vertexPath, const GLchar* fragmentPath);
+        void setShader(const GLchar* vertexPath, const GLchar* geometryPath, const GLchar* fragmentPath);
+        void setShader(const GLchar* computePath);
         void useShader();
+        const std::vector<std::pair<GLenum, std::string>>& getShaderStages();
+
+        // Hot-reload : the shader source files are watched on a background thread,
+        // and a modified program is rebuilt asynchronously, then swapped only once it linked successfully
+        static void startWatching();
+        static void stopWatching();
+        static bool updateShaders();
+
+    private:
+        std::vector<std::pair<GLenum, std::string>> shaderStages;
+        std::vector<GLuint> pendingShaders;
+        GLuint pendingProgram = 0;
+
+        void setShaderStages(const std::vector<std::pair<GLenum, std::string>>& stages);
+        GLuint compileProgram(bool waitCompletion);
+        bool checkProgram(GLuint program, std::vector<GLuint>& shaders);
+        void beginReload();
+        bool endReload();
 };
 
 #endif
@@ -3,6 +3,7 @@
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <cmath>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -77,6 +78,46 @@ GLfloat quadVertices[] = {
 };
 
 
+// UV sphere of radius 1, built once on the first use, same 8 floats vertex layout as the cube
+const GLuint sphereSegments = 16;
+const GLuint sphereRings = 12;
+std::vector<GLfloat> sphereVertices;
+
+
+void computeSphereVertices()
+{
+    const GLfloat PI = 3.14159265359f;
+
+    for (GLuint ring = 0; ring < sphereRings; ++ring)
+    {
+        for (GLuint segment = 0; segment < sphereSegments; ++segment)
+        {
+            // Counter-clockwise seen from the outside
+            GLuint quadCorners[6][2] = { { ring, segment }, { ring + 1, segment + 1 }, { ring + 1, segment },
+                                         { ring, segment }, { ring, segment + 1 }, { ring + 1, segment + 1 } };
+
+            for (GLuint corner = 0; corner < 6; ++corner)
+            {
+                GLfloat u = GLfloat(quadCorners[corner][1]) / sphereSegments;
+                GLfloat v = GLfloat(quadCorners[corner][0]) / sphereRings;
+                GLfloat phi = u * 2.0f * PI;
+                GLfloat theta = v * PI;
+                glm::vec3 normal = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+
+                sphereVertices.push_back(normal.x);
+                sphereVertices.push_back(normal.y);
+                sphereVertices.push_back(normal.z);
+                sphereVertices.push_back(normal.x);
+                sphereVertices.push_back(normal.y);
+                sphereVertices.push_back(normal.z);
+                sphereVertices.push_back(u);
+                sphereVertices.push_back(v);
+            }
+        }
+    }
+}
+
+
 Shape::Shape()
 {
 
@@ -106,6 +147,13 @@ void Shape::setShape(std::string type, glm::vec3 position)
         glBufferData(GL_ARRAY_BUFFER, sizeof(planeVertices), planeVertices, GL_STATIC_DRAW);
     else if (type == "quad")
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+    else if (type == "sphere")
+    {
+        if (sphereVertices.empty())
+            computeSphereVertices();
+
+        glBufferData(GL_ARRAY_BUFFER, sphereVertices.size() * sizeof(GLfloat), &sphereVertices[0], GL_STATIC_DRAW);
+    }
 
     glBindVertexArray(this->shapeVAO);
 
@@ -156,6 +204,8 @@ void Shape::drawShape(Shader& lightingShader, glm::mat4& view, glm::mat4& projec
         glDrawArrays(GL_TRIANGLES, 0, 6);
     else if (this->shapeType == "quad")
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    else if (this->shapeType == "sphere")
+        glDrawArrays(GL_TRIANGLES, 0, sphereRings * sphereSegments * 6);
 
     glBindVertexArray(0);
 }
@@ -171,6 +221,8 @@ void Shape::drawShape()
         glDrawArrays(GL_TRIANGLES, 0, 6);
     else if (this->shapeType == "quad")
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    else if (this->shapeType == "sphere")
+        glDrawArrays(GL_TRIANGLES, 0, sphereRings * sphereSegments * 6);
 
     glBindVertexArray(0);
 }
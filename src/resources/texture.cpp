@@ -45,6 +45,7 @@ void Texture::setTexture(const char* texPath, std::string texName, bool texFlip)
     this->texHeight = height;
     this->texComponents = numComponents;
     this->texName = texName;
+    this->texPath = tempPath;
 
     if (texData)
     {
@@ -101,6 +102,7 @@ void Texture::setTextureHDR(const char* texPath, std::string texName, bool texFl
         this->texHeight = height;
         this->texComponents = numComponents;
         this->texName = texName;
+        this->texPath = tempPath;
 
         if (texData)
         {
@@ -296,6 +298,19 @@ void Texture::computeTexMipmap()
 }
 
 
+// Base level read back as floats, texComponents per texel, for the CPU-side processing of HDR textures
+void Texture::getTexData(std::vector<GLfloat>& texData)
+{
+    texData.resize(this->texWidth * this->texHeight * this->texComponents);
+
+    glBindTexture(this->texType, this->texID);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glGetTexImage(this->texType, 0, this->texFormat, GL_FLOAT, texData.data());
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(this->texType, 0);
+}
+
+
 GLuint Texture::getTexID()
 {
     return this->texID;
@@ -320,6 +335,12 @@ std::string Texture::getTexName()
 }
 
 
+std::string Texture::getTexPath()
+{
+    return this->texPath;
+}
+
+
 void Texture::useTexture()
 {
     glBindTexture(this->texType, this->texID);
@@ -16,7 +16,7 @@ class Texture
         GLuint texID, texWidth, texHeight, texComponents;
         GLfloat anisoFilterLevel;
         GLenum texType, texInternalFormat, texFormat;
-        std::string texName;
+        std::string texName, texPath;
 
         Texture();
         ~Texture();
@@ -26,10 +26,12 @@ class Texture
         void setTextureCube(std::vector<const char*>& faces, bool texFlip);
         void setTextureCube(GLuint width, GLenum format, GLenum internalFormat, GLenum type, GLenum minFilter);
         void computeTexMipmap();
+        void getTexData(std::vector<GLfloat>& texData);
         GLuint getTexID();
         GLuint getTexWidth();
         GLuint getTexHeight();
         std::string getTexName();
+        std::string getTexPath();
         void useTexture();
 };
 
@@ -0,0 +1,349 @@
+// GLEngine by Joshua Senouf - 2016
+// Credits to Joey de Vries (LearnOpenGL) and Kevin Fung (Glitter)
+
+
+#include "iblbaker.h"
+#include "iblfile.h"
+#include "irradiancesh.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+
+//---------------------------------
+// Bake parameters, as in glengine.cpp
+//---------------------------------
+
+const unsigned int cubeSize = 512;
+const unsigned int prefilterSize = 128;
+const unsigned int prefilterMips = 5;
+const unsigned int sampleCount = 1024;
+const unsigned int lutSize = 512;
+
+// Tolerances of the verification : SIMD paths against the scalar shader ports (float summation order only),
+// then against GPU outputs (half floats, seamless cube filtering and GPU transcendentals)
+const float referenceTolerance = 1e-3f;
+const float gpuLUTTolerance = 4e-3f;
+const float gpuCubeTolerance = 0.01f;
+const float gpuPrefilterTolerance = 0.03f;
+
+
+//---------------------
+// Functions prototypes
+//---------------------
+
+void printUsage();
+void packHalf(const std::vector<float>& texels, std::vector<unsigned short>& halfTexels);
+float computeRelativeError(float value, float reference);
+float computeRMSRelativeError(const unsigned short* texels, const unsigned short* referenceTexels, size_t texelCount);
+bool verifyReference(IBLBaker& iblBaker);
+bool verifyGPUEnvironment(const std::string& referencePath, const std::vector<unsigned short>& cubeTexels, const std::vector<unsigned short>& prefilterTexels);
+bool verifyGPULUT(const std::string& referencePath, const std::vector<unsigned short>& lutTexels);
+
+
+int main(int argc, char* argv[])
+{
+    std::string hdrPath, outputDirectory = "resources/cache/ibl/", lutPath, referencePath, referenceLUTPath;
+    unsigned int threadCount = 0;
+    bool verifyMode = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if (argument == "-o" && i + 1 < argc)
+            outputDirectory = argv[++i];
+        else if (argument == "-lut" && i + 1 < argc)
+            lutPath = argv[++i];
+        else if (argument == "-threads" && i + 1 < argc)
+            threadCount = unsigned(std::atoi(argv[++i]));
+        else if (argument == "-verify")
+            verifyMode = true;
+        else if (argument == "-reference" && i + 1 < argc)
+            referencePath = argv[++i];
+        else if (argument == "-reference-lut" && i + 1 < argc)
+            referenceLUTPath = argv[++i];
+        else if (hdrPath.empty() && argument[0] != '-')
+            hdrPath = argument;
+        else
+        {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (hdrPath.empty())
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    if (!outputDirectory.empty() && outputDirectory.back() != '/' && outputDirectory.back() != '\\')
+        outputDirectory += '/';
+
+
+    //-----------
+    // Environment
+    //-----------
+    // Loaded flipped, like Texture::setTextureHDR(), so that the latlong rows and the SH projection match the engine
+    int width, height, numComponents;
+    stbi_set_flip_vertically_on_load(true);
+    float* texData = stbi_loadf(hdrPath.c_str(), &width, &height, &numComponents, 0);
+
+    if (!texData || numComponents < 3)
+    {
+        std::cerr << "HDR TEXTURE - FAILED LOADING : " << hdrPath << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    IBLBaker iblBaker;
+    IrradianceSH irradianceSH;
+
+    iblBaker.setThreadCount(threadCount);
+    iblBaker.setEnvironment(texData, width, height, numComponents);
+
+
+    //-----------
+    // Bake
+    //-----------
+    irradianceSH.computeCoefficients(texData, width, height, numComponents, threadCount);
+    iblBaker.bakeCube(cubeSize);
+    iblBaker.bakePrefilter(prefilterSize, prefilterMips, sampleCount);
+
+    std::cout << "IBL Baker : " << hdrPath << " (" << width << "x" << height << "), " << iblBaker.getThreadCount() << " threads" << std::endl;
+    std::cout << "    SH Irradiance : " << irradianceSH.getComputeTime() << " ms" << std::endl;
+    std::cout << "    Cube :          " << iblBaker.getCubeTime() << " ms" << std::endl;
+    std::cout << "    Prefilter :     " << iblBaker.getPrefilterTime() << " ms" << std::endl;
+
+    std::vector<unsigned short> cubeTexels, prefilterTexels, lutTexels;
+    packHalf(iblBaker.getCube(), cubeTexels);
+    packHalf(iblBaker.getPrefilter(), prefilterTexels);
+
+    bool bakeLUT = !lutPath.empty() || verifyMode || !referenceLUTPath.empty();
+
+    if (bakeLUT)
+    {
+        iblBaker.bakeLUT(lutSize, sampleCount);
+        packHalf(iblBaker.getLUT(), lutTexels);
+
+        std::cout << "    BRDF LUT :      " << iblBaker.getLUTTime() << " ms" << std::endl;
+    }
+
+
+    //-----------
+    // Output
+    //-----------
+    // Same key as the engine cache, so that the entry is picked up by iblSetup() as-is
+    std::string cacheKey = IBLFile::computeKey(hdrPath, cubeSize, prefilterSize, prefilterMips, sampleCount);
+    std::string cachePath = outputDirectory + cacheKey + ".ibl";
+    bool bakeSucceeded = true;
+
+    if (!IBLFile::writeEnvironment(cachePath, cubeSize, prefilterSize, prefilterMips, 3, cubeTexels, irradianceSH.getCoefficients(), prefilterTexels))
+    {
+        std::cerr << "IBL BAKER - FAILED WRITING : " << cachePath << std::endl;
+        bakeSucceeded = false;
+    }
+
+    else
+        std::cout << "Environment written : " << cachePath << std::endl;
+
+    if (!lutPath.empty())
+    {
+        if (!IBLFile::writeLUT(lutPath, lutSize, 2, lutTexels))
+        {
+            std::cerr << "IBL BAKER - FAILED WRITING : " << lutPath << std::endl;
+            bakeSucceeded = false;
+        }
+
+        else
+            std::cout << "BRDF LUT written : " << lutPath << std::endl;
+    }
+
+
+    //-----------
+    // Verification
+    //-----------
+    if (verifyMode)
+        bakeSucceeded &= verifyReference(iblBaker);
+
+    if (!referencePath.empty())
+        bakeSucceeded &= verifyGPUEnvironment(referencePath, cubeTexels, prefilterTexels);
+
+    if (!referenceLUTPath.empty())
+        bakeSucceeded &= verifyGPULUT(referenceLUTPath, lutTexels);
+
+    stbi_image_free(texData);
+
+    return bakeSucceeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+
+void printUsage()
+{
+    std::cout << "Usage : IBLBaker <environment.hdr> [-o <cache directory>] [-lut <brdf_lut.bin>] [-threads <count>]" << std::endl;
+    std::cout << "                 [-verify] [-reference <GPU cache entry.ibl>] [-reference-lut <GPU brdf_lut.bin>]" << std::endl;
+    std::cout << "    -verify :        checks the threaded SIMD bake against scalar ports of prefilterIBL.frag and integrateIBL.frag" << std::endl;
+    std::cout << "    -reference :     compares with an entry written by the engine cache from the GPU passes" << std::endl;
+    std::cout << "    -reference-lut : compares with a LUT written from integrateIBL.frag" << std::endl;
+}
+
+
+void packHalf(const std::vector<float>& texels, std::vector<unsigned short>& halfTexels)
+{
+    halfTexels.resize(texels.size());
+
+    for (size_t i = 0; i < texels.size(); ++i)
+        halfTexels[i] = glm::packHalf1x16(texels[i]);
+}
+
+
+float computeRelativeError(float value, float reference)
+{
+    return std::abs(value - reference) / std::max(std::abs(reference), 1e-2f);
+}
+
+
+// A regular subset of texels is recomputed with the scalar shader ports, every mip and face of the prefilter and the whole LUT range
+bool verifyReference(IBLBaker& iblBaker)
+{
+    const unsigned int gridSize = 8;
+    const std::vector<float>& prefilterTexels = iblBaker.getPrefilter();
+    const std::vector<float>& lutTexels = iblBaker.getLUT();
+    bool verifySucceeded = true;
+    size_t mipOffset = 0;
+
+    for (unsigned int mip = 0; mip < prefilterMips; ++mip)
+    {
+        unsigned int mipSize = prefilterSize >> mip;
+        unsigned int gridStep = std::max(1u, mipSize / gridSize);
+        float roughness = float(mip) / float(prefilterMips - 1);
+        float maxError = 0.0f;
+
+        for (unsigned int face = 0; face < 6; ++face)
+        {
+            for (unsigned int y = gridStep / 2; y < mipSize; y += gridStep)
+            {
+                for (unsigned int x = gridStep / 2; x < mipSize; x += gridStep)
+                {
+                    glm::vec3 N = glm::normalize(IBLBaker::computeCubeDirection(face, (x + 0.5f) / mipSize, (y + 0.5f) / mipSize));
+                    glm::vec3 reference = iblBaker.computeReferencePrefilter(N, roughness, prefilterSize, sampleCount);
+                    const float* texel = prefilterTexels.data() + mipOffset + ((size_t(face) * mipSize + y) * mipSize + x) * 3;
+
+                    for (unsigned int channel = 0; channel < 3; ++channel)
+                        maxError = std::max(maxError, computeRelativeError(texel[channel], reference[channel]));
+                }
+            }
+        }
+
+        std::printf("Verify prefilter mip %u (roughness %.2f) : max relative error %.6f\n", mip, roughness, maxError);
+        verifySucceeded &= maxError <= referenceTolerance;
+        mipOffset += size_t(mipSize) * mipSize * 6 * 3;
+    }
+
+    float maxLUTError = 0.0f;
+
+    for (unsigned int y = 0; y < lutSize; y += lutSize / (gridSize * 4))
+    {
+        for (unsigned int x = 0; x < lutSize; x += lutSize / (gridSize * 4))
+        {
+            glm::vec2 reference = iblBaker.computeReferenceBRDF((x + 0.5f) / lutSize, (y + 0.5f) / lutSize, sampleCount);
+            const float* texel = lutTexels.data() + (size_t(y) * lutSize + x) * 2;
+
+            maxLUTError = std::max(maxLUTError, std::max(std::abs(texel[0] - reference.x), std::abs(texel[1] - reference.y)));
+        }
+    }
+
+    std::printf("Verify BRDF LUT : max absolute error %.6f\n", maxLUTError);
+    verifySucceeded &= maxLUTError <= referenceTolerance;
+
+    std::cout << (verifySucceeded ? "Verification against the shader ports passed" : "Verification against the shader ports FAILED") << std::endl;
+
+    return verifySucceeded;
+}
+
+
+// RMS of the relative error per section, the maximum being dominated by a few texels along the seams
+float computeRMSRelativeError(const unsigned short* texels, const unsigned short* referenceTexels, size_t texelCount)
+{
+    double errorSum = 0.0;
+
+    for (size_t i = 0; i < texelCount; ++i)
+    {
+        float error = computeRelativeError(glm::unpackHalf1x16(texels[i]), glm::unpackHalf1x16(referenceTexels[i]));
+        errorSum += double(error) * error;
+    }
+
+    return float(std::sqrt(errorSum / std::max(texelCount, size_t(1))));
+}
+
+
+bool verifyGPUEnvironment(const std::string& referencePath, const std::vector<unsigned short>& cubeTexels, const std::vector<unsigned short>& prefilterTexels)
+{
+    std::vector<unsigned short> referenceCubeTexels, referencePrefilterTexels;
+    float referenceSH[IBLFile::shFloatCount];
+
+    if (!IBLFile::readEnvironment(referencePath, cubeSize, prefilterSize, prefilterMips, 3, referenceCubeTexels, referenceSH, referencePrefilterTexels))
+    {
+        std::cerr << "IBL BAKER - FAILED LOADING REFERENCE : " << referencePath << std::endl;
+        return false;
+    }
+
+    float cubeError = computeRMSRelativeError(cubeTexels.data(), referenceCubeTexels.data(), cubeTexels.size());
+    bool verifySucceeded = cubeError <= gpuCubeTolerance;
+
+    std::printf("Verify GPU cube : RMS relative error %.6f\n", cubeError);
+
+    size_t mipOffset = 0;
+
+    for (unsigned int mip = 0; mip < prefilterMips; ++mip)
+    {
+        size_t mipTexelCount = size_t(prefilterSize >> mip) * (prefilterSize >> mip) * 6 * 3;
+        float mipError = computeRMSRelativeError(prefilterTexels.data() + mipOffset, referencePrefilterTexels.data() + mipOffset, mipTexelCount);
+
+        std::printf("Verify GPU prefilter mip %u : RMS relative error %.6f\n", mip, mipError);
+        verifySucceeded &= mipError <= gpuPrefilterTolerance;
+        mipOffset += mipTexelCount;
+    }
+
+    std::cout << (verifySucceeded ? "Verification against the GPU environment passed" : "Verification against the GPU environment FAILED") << std::endl;
+
+    return verifySucceeded;
+}
+
+
+bool verifyGPULUT(const std::string& referencePath, const std::vector<unsigned short>& lutTexels)
+{
+    std::vector<unsigned short> referenceTexels;
+
+    if (!IBLFile::readLUT(referencePath, lutSize, 2, referenceTexels))
+    {
+        std::cerr << "IBL BAKER - FAILED LOADING REFERENCE : " << referencePath << std::endl;
+        return false;
+    }
+
+    float maxError = 0.0f;
+
+    for (size_t i = 0; i < lutTexels.size(); ++i)
+        maxError = std::max(maxError, std::abs(glm::unpackHalf1x16(lutTexels[i]) - glm::unpackHalf1x16(referenceTexels[i])));
+
+    bool verifySucceeded = maxError <= gpuLUTTolerance;
+
+    std::printf("Verify GPU BRDF LUT : max absolute error %.6f\n", maxError);
+    std::cout << (verifySucceeded ? "Verification against the GPU LUT passed" : "Verification against the GPU LUT FAILED") << std::endl;
+
+    return verifySucceeded;
+}
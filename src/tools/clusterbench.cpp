@@ -0,0 +1,223 @@
+// GLEngine by Joshua Senouf - 2016
+// Credits to Joey de Vries (LearnOpenGL) and Kevin Fung (Glitter)
+
+
+#include "clustergrid.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+#include <iostream>
+
+
+//---------------------------------
+// Grid parameters, as in glengine.cpp
+//---------------------------------
+
+const unsigned int viewWidth = 1280;
+const unsigned int viewHeight = 720;
+const float viewFOV = glm::radians(45.0f);
+const float viewNear = 0.1f;
+const float viewFar = 100.0f;
+
+// Same layout as the light buffer of LightSystem : view-space position and radius, then the color
+const unsigned int lightStride = 8;
+
+
+//---------------------
+// Functions prototypes
+//---------------------
+
+void printUsage();
+void generateLights(std::vector<float>& lightData, unsigned int lightCount, unsigned int seed);
+bool verifyReference(ClusterGrid& clusterGrid, const std::vector<float>& lightData, unsigned int lightCount);
+bool verifySlices(ClusterGrid& clusterGrid);
+
+
+int main(int argc, char* argv[])
+{
+    std::vector<unsigned int> lightCounts = { 1024, 10000, 50000 };
+    unsigned int threadCount = 0;
+    unsigned int frameCount = 20;
+    bool verifyMode = true;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string argument = argv[i];
+
+        if (argument == "-lights" && i + 1 < argc)
+            lightCounts = { unsigned(std::atoi(argv[++i])) };
+        else if (argument == "-threads" && i + 1 < argc)
+            threadCount = unsigned(std::atoi(argv[++i]));
+        else if (argument == "-frames" && i + 1 < argc)
+            frameCount = std::max(unsigned(std::atoi(argv[++i])), 1u);
+        else if (argument == "-no-verify")
+            verifyMode = false;
+        else
+        {
+            printUsage();
+            return EXIT_FAILURE;
+        }
+    }
+
+    ClusterGrid clusterGrid;
+    clusterGrid.setFrustum(glm::perspective(viewFOV, float(viewWidth) / float(viewHeight), viewNear, viewFar), viewNear, viewFar);
+
+    std::cout << "Cluster Bench : " << clusterGrid.getTilesX() << "x" << clusterGrid.getTilesY() << "x" << clusterGrid.getSlices() << " clusters" << std::endl;
+
+    bool benchSucceeded = verifyMode ? verifySlices(clusterGrid) : true;
+
+    for (unsigned int lightCount : lightCounts)
+    {
+        std::vector<float> lightData;
+        generateLights(lightData, lightCount, lightCount);
+
+        // Binning time over several frames, the first one warming up the allocations
+        float timeTotal = 0.0f;
+        float timeMin = 1e30f;
+
+        clusterGrid.binLights(lightData.data(), lightStride, lightCount, threadCount);
+
+        for (unsigned int frame = 0; frame < frameCount; ++frame)
+        {
+            clusterGrid.binLights(lightData.data(), lightStride, lightCount, threadCount);
+            timeTotal += clusterGrid.getBinningTime();
+            timeMin = std::min(timeMin, clusterGrid.getBinningTime());
+        }
+
+        std::cout << "    " << lightCount << " lights : " << timeTotal / frameCount << " ms average, " << timeMin << " ms min, "
+                  << clusterGrid.getBinningThreads() << " threads, " << clusterGrid.clusterLightIndices.size() << " indices" << std::endl;
+
+        if (verifyMode)
+            benchSucceeded &= verifyReference(clusterGrid, lightData, lightCount);
+    }
+
+    return benchSucceeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+
+void printUsage()
+{
+    std::cout << "Usage : ClusterBench [-lights <count>] [-threads <count>] [-frames <count>] [-no-verify]" << std::endl;
+    std::cout << "    Times the CPU light binning of ClusterGrid (1024, 10000 and 50000 lights by default), then checks every" << std::endl;
+    std::cout << "    cluster against a brute-force sphere / AABB test of all the lights, and the depth slices against the shader lookup" << std::endl;
+}
+
+
+// Spheres spread over the view frustum (and a little past its sides), with the radii of the scene lights
+void generateLights(std::vector<float>& lightData, unsigned int lightCount, unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> unitDistribution(0.0f, 1.0f);
+    std::uniform_real_distribution<float> radiusDistribution(0.5f, 5.0f);
+
+    float tanHalfFOV = std::tan(viewFOV * 0.5f);
+    float aspect = float(viewWidth) / float(viewHeight);
+
+    lightData.assign(lightCount * lightStride, 1.0f);
+
+    for (unsigned int i = 0; i < lightCount; ++i)
+    {
+        float depth = viewNear + (viewFar - viewNear) * unitDistribution(generator);
+        float* light = &lightData[i * lightStride];
+
+        light[0] = (unitDistribution(generator) * 2.4f - 1.2f) * depth * tanHalfFOV * aspect;
+        light[1] = (unitDistribution(generator) * 2.4f - 1.2f) * depth * tanHalfFOV;
+        light[2] = -depth;
+        light[3] = radiusDistribution(generator);
+    }
+}
+
+
+// Every cluster must list exactly the lights whose sphere touches its box, the order within a cluster being free
+bool verifyReference(ClusterGrid& clusterGrid, const std::vector<float>& lightData, unsigned int lightCount)
+{
+    unsigned int clusterMismatches = 0;
+    size_t referenceTotal = 0;
+
+    std::vector<unsigned int> referenceIndices, binnedIndices;
+
+    for (unsigned int cluster = 0; cluster < clusterGrid.getClusterCount(); ++cluster)
+    {
+        float boxMin[3], boxMax[3];
+        clusterGrid.getClusterBounds(cluster, boxMin, boxMax);
+
+        referenceIndices.clear();
+
+        for (unsigned int i = 0; i < lightCount; ++i)
+        {
+            const float* light = &lightData[i * lightStride];
+
+            float dx = std::max(0.0f, boxMin[0] - light[0]) + std::max(0.0f, light[0] - boxMax[0]);
+            float dy = std::max(0.0f, boxMin[1] - light[1]) + std::max(0.0f, light[1] - boxMax[1]);
+            float dz = std::max(0.0f, boxMin[2] - light[2]) + std::max(0.0f, light[2] - boxMax[2]);
+
+            if (dx * dx + dy * dy + dz * dz <= light[3] * light[3])
+                referenceIndices.push_back(i);
+        }
+
+        unsigned int clusterOffset = clusterGrid.clusterOffsetCount[2 * cluster];
+        unsigned int clusterCount = clusterGrid.clusterOffsetCount[2 * cluster + 1];
+
+        binnedIndices.assign(clusterGrid.clusterLightIndices.begin() + clusterOffset, clusterGrid.clusterLightIndices.begin() + clusterOffset + clusterCount);
+        std::sort(binnedIndices.begin(), binnedIndices.end());
+
+        if (binnedIndices != referenceIndices)
+            clusterMismatches++;
+
+        referenceTotal += referenceIndices.size();
+    }
+
+    if (clusterMismatches)
+        std::cerr << "CLUSTER BENCH - REFERENCE MISMATCH : " << clusterMismatches << " clusters out of " << clusterGrid.getClusterCount() << " (" << lightCount << " lights)" << std::endl;
+    else
+        std::cout << "        Reference : " << referenceTotal << " indices, all clusters match" << std::endl;
+
+    return clusterMismatches == 0;
+}
+
+
+// The shaders pick the slice of a fragment with log(z / near) * slices / log(far / near) (clusteredForward.frag), from the
+// clusterDepth uniform of glengine.cpp : depths spread over every slice must land in the one whose bounds contain them
+bool verifySlices(ClusterGrid& clusterGrid)
+{
+    const unsigned int sliceSamples = 64;
+
+    float depthScale = clusterGrid.getSlices() / std::log(clusterGrid.getZFar() / clusterGrid.getZNear());
+    unsigned int depthCount = clusterGrid.getSlices() * sliceSamples;
+    unsigned int depthMismatches = 0;
+
+    std::vector<unsigned int> sliceHits(clusterGrid.getSlices(), 0);
+
+    for (unsigned int i = 0; i < depthCount; ++i)
+    {
+        float depth = clusterGrid.getZNear() * std::pow(clusterGrid.getZFar() / clusterGrid.getZNear(), (i + 0.5f) / depthCount);
+        unsigned int slice = unsigned(glm::clamp(std::log(depth / clusterGrid.getZNear()) * depthScale, 0.0f, float(clusterGrid.getSlices() - 1)));
+
+        float sliceNear, sliceFar;
+        clusterGrid.getSliceBounds(slice, &sliceNear, &sliceFar);
+
+        // Relative slack for the float rounding of both sides, the samples sitting well within the slices
+        if (depth < sliceNear * (1.0f - 1e-5f) || depth > sliceFar * (1.0f + 1e-5f))
+            depthMismatches++;
+
+        sliceHits[slice]++;
+    }
+
+    unsigned int sliceMisses = unsigned(std::count(sliceHits.begin(), sliceHits.end(), 0u));
+
+    if (depthMismatches || sliceMisses)
+        std::cerr << "CLUSTER BENCH - SLICE MISMATCH : " << depthMismatches << " depths out of " << depthCount << " outside their slice, "
+                  << sliceMisses << " slices never selected" << std::endl;
+    else
+        std::cout << "    Slices : " << depthCount << " depths, all within the bounds of the slice the shaders select" << std::endl;
+
+    return depthMismatches == 0 && sliceMisses == 0;
+}
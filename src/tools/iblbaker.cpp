@@ -0,0 +1,769 @@
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IBLBAKER_SSE
+#endif
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "iblbaker.h"
+
+
+const float bakePI = 3.14159265359f;
+
+
+// Same bit reversal, Hammersley set, GGX importance sampling and distribution as the shaders
+static float radicalInverse_VdC(unsigned int bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+
+    return float(bits) * 2.3283064365386963e-10f;
+}
+
+
+static glm::vec2 computeHammersley(unsigned int i, unsigned int N)
+{
+    return glm::vec2(float(i) / float(N), radicalInverse_VdC(i));
+}
+
+
+// Half-vector in the tangent frame of N, before the rotation done by computeImportanceSampleGGX()
+static glm::vec3 computeTangentSampleGGX(glm::vec2 Xi, float roughness)
+{
+    float alpha = roughness * roughness;
+
+    float anglePhi = 2.0f * bakePI * Xi.x;
+    float cosTheta = std::sqrt((1.0f - Xi.y) / (1.0f + (alpha * alpha - 1.0f) * Xi.y));
+    float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+    return glm::vec3(sinTheta * std::cos(anglePhi), sinTheta * std::sin(anglePhi), cosTheta);
+}
+
+
+static void computeTangentFrame(glm::vec3 N, glm::vec3& tanX, glm::vec3& tanY)
+{
+    glm::vec3 upDir = std::abs(N.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+
+    tanX = glm::normalize(glm::cross(upDir, N));
+    tanY = glm::cross(N, tanX);
+}
+
+
+static glm::vec3 computeImportanceSampleGGX(glm::vec2 Xi, float roughness, glm::vec3 N)
+{
+    glm::vec3 H = computeTangentSampleGGX(Xi, roughness);
+    glm::vec3 tanX, tanY;
+    computeTangentFrame(N, tanX, tanY);
+
+    return glm::normalize(tanX * H.x + tanY * H.y + N * H.z);
+}
+
+
+static float computeDistributionGGX(float NdotH, float roughness)
+{
+    float alpha = roughness * roughness;
+    float alpha2 = alpha * alpha;
+    float NdotH2 = NdotH * NdotH;
+
+    return (alpha2) / (bakePI * (NdotH2 * (alpha2 - 1.0f) + 1.0f) * (NdotH2 * (alpha2 - 1.0f) + 1.0f));
+}
+
+
+static float computeGeometryAttenuationGGXSmith(float NdotL, float NdotV, float roughness)
+{
+    float NdotL2 = NdotL * NdotL;
+    float NdotV2 = NdotV * NdotV;
+    float kRough2 = roughness * roughness + 0.0001f;
+
+    float ggxL = (2.0f * NdotL) / (NdotL + std::sqrt(NdotL2 + kRough2 * (1.0f - NdotL2)));
+    float ggxV = (2.0f * NdotV) / (NdotV + std::sqrt(NdotV2 + kRough2 * (1.0f - NdotV2)));
+
+    return ggxL * ggxV;
+}
+
+
+// Mip level picked by prefilterIBL.frag for a sample (Chetan Jags' trick), the shader using the prefilter resolution for the texel solid angle
+static float computeSampleLod(float roughness, float NdotH, float HdotV, unsigned int prefilterSize, unsigned int sampleCount)
+{
+    if (roughness == 0.0f)
+        return 0.0f;
+
+    float probaDistribFunction = computeDistributionGGX(NdotH, roughness) * NdotH / (4.0f * HdotV) + 0.0001f;
+    float saTexel = 4.0f * bakePI / (6.0f * prefilterSize * prefilterSize);
+    float saSample = 1.0f / (float(sampleCount) * probaDistribFunction + 0.0001f);
+
+    return 0.5f * std::log2(saSample / saTexel);
+}
+
+
+// Major axis selection of the GL cube-map lookup, s and t in [0, 1]
+static void computeCubeCoords(glm::vec3 direction, unsigned int& face, float& s, float& t)
+{
+    glm::vec3 absDirection = glm::abs(direction);
+    float sc, tc, ma;
+
+    if (absDirection.x >= absDirection.y && absDirection.x >= absDirection.z)
+    {
+        face = direction.x >= 0.0f ? 0 : 1;
+        sc = direction.x >= 0.0f ? -direction.z : direction.z;
+        tc = -direction.y;
+        ma = absDirection.x;
+    }
+
+    else if (absDirection.y >= absDirection.z)
+    {
+        face = direction.y >= 0.0f ? 2 : 3;
+        sc = direction.x;
+        tc = direction.y >= 0.0f ? direction.z : -direction.z;
+        ma = absDirection.y;
+    }
+
+    else
+    {
+        face = direction.z >= 0.0f ? 4 : 5;
+        sc = direction.z >= 0.0f ? direction.x : -direction.x;
+        tc = -direction.y;
+        ma = absDirection.z;
+    }
+
+    s = 0.5f * (sc / ma + 1.0f);
+    t = 0.5f * (tc / ma + 1.0f);
+}
+
+
+static float roundToHalf(float value)
+{
+    return glm::unpackHalf1x16(glm::packHalf1x16(value));
+}
+
+
+IBLBaker::IBLBaker()
+{
+
+}
+
+
+IBLBaker::~IBLBaker()
+{
+
+}
+
+
+void IBLBaker::setThreadCount(unsigned int threadCount)
+{
+    this->threadCount = threadCount;
+}
+
+
+// Latlong texels as loaded by Texture::setTextureHDR() (flipped, row 0 at v = 0), kept by pointer for the whole bake
+void IBLBaker::setEnvironment(const float* texData, unsigned int width, unsigned int height, unsigned int components)
+{
+    this->envData = texData;
+    this->envWidth = width;
+    this->envHeight = height;
+    this->envComponents = components;
+}
+
+
+void IBLBaker::bakeCube(unsigned int size)
+{
+    std::chrono::high_resolution_clock::time_point bakeStart = std::chrono::high_resolution_clock::now();
+
+    unsigned int mipCount = 1;
+
+    while ((size >> mipCount) > 0)
+        ++mipCount;
+
+    this->cubeSize = size;
+    this->cubeMips.assign(mipCount, std::vector<float>());
+    this->cubeMips[0].resize(size_t(size) * size * 6 * 3);
+
+    this->runParallel(6 * size, [this, size](unsigned int task)
+    {
+        unsigned int face = task / size;
+        unsigned int row = task % size;
+        float* output = this->cubeMips[0].data() + (size_t(face) * size + row) * size * 3;
+
+        for (unsigned int x = 0; x < size; ++x)
+        {
+            glm::vec3 color = this->sampleLatlong(glm::normalize(computeCubeDirection(face, (x + 0.5f) / size, (row + 0.5f) / size)));
+
+            for (unsigned int channel = 0; channel < 3; ++channel)
+                output[x * 3 + channel] = roundToHalf(color[channel]);
+        }
+    });
+
+    // 2x2 box filter, like the glGenerateMipmap() call that follows the GPU conversion
+    for (unsigned int mip = 1; mip < mipCount; ++mip)
+    {
+        unsigned int mipSize = size >> mip;
+        unsigned int parentSize = mipSize * 2;
+
+        this->cubeMips[mip].resize(size_t(mipSize) * mipSize * 6 * 3);
+
+        this->runParallel(6 * mipSize, [this, mip, mipSize, parentSize](unsigned int task)
+        {
+            unsigned int face = task / mipSize;
+            unsigned int row = task % mipSize;
+            const float* parent = this->cubeMips[mip - 1].data() + size_t(face) * parentSize * parentSize * 3;
+            float* output = this->cubeMips[mip].data() + (size_t(face) * mipSize + row) * mipSize * 3;
+
+            for (unsigned int x = 0; x < mipSize; ++x)
+            {
+                for (unsigned int channel = 0; channel < 3; ++channel)
+                {
+                    float sum = parent[((2 * row) * parentSize + 2 * x) * 3 + channel] + parent[((2 * row) * parentSize + 2 * x + 1) * 3 + channel]
+                              + parent[((2 * row + 1) * parentSize + 2 * x) * 3 + channel] + parent[((2 * row + 1) * parentSize + 2 * x + 1) * 3 + channel];
+
+                    output[x * 3 + channel] = roundToHalf(0.25f * sum);
+                }
+            }
+        });
+    }
+
+    this->cubeTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - bakeStart).count();
+}
+
+
+// The sample set only depends on the roughness : with V = N, the tangent-space L, its weight and its mip level are computed once per mip,
+// stored as padded SoA arrays (x, y, z, weight, lod) so that the texel loop only has to rotate them into the frame of N
+void IBLBaker::bakePrefilter(unsigned int size, unsigned int mips, unsigned int sampleCount)
+{
+    std::chrono::high_resolution_clock::time_point bakeStart = std::chrono::high_resolution_clock::now();
+
+    size_t texelCount = 0;
+
+    for (unsigned int mip = 0; mip < mips; ++mip)
+        texelCount += size_t(size >> mip) * (size >> mip) * 6 * 3;
+
+    this->prefilterTexels.resize(texelCount);
+
+    size_t mipOffset = 0;
+
+    for (unsigned int mip = 0; mip < mips; ++mip)
+    {
+        unsigned int mipSize = size >> mip;
+        float roughness = mips > 1 ? float(mip) / float(mips - 1) : 0.0f;
+
+        std::vector<glm::vec3> sampleDirections;
+        std::vector<float> sampleWeights, sampleLods;
+
+        for (unsigned int i = 0; i < sampleCount; ++i)
+        {
+            glm::vec3 H = computeTangentSampleGGX(computeHammersley(i, sampleCount), roughness);
+            glm::vec3 L = 2.0f * H.z * H - glm::vec3(0.0f, 0.0f, 1.0f);
+
+            if (L.z > 0.0f)
+            {
+                sampleDirections.push_back(L);
+                sampleWeights.push_back(L.z);
+                sampleLods.push_back(computeSampleLod(roughness, H.z, H.z, size, sampleCount));
+            }
+        }
+
+        size_t sampleStride = (sampleDirections.size() + 3) & ~size_t(3);
+        std::vector<float> samples(sampleStride * 5, 0.0f);
+
+        for (size_t i = 0; i < sampleDirections.size(); ++i)
+        {
+            samples[i] = sampleDirections[i].x;
+            samples[sampleStride + i] = sampleDirections[i].y;
+            samples[2 * sampleStride + i] = sampleDirections[i].z;
+            samples[3 * sampleStride + i] = sampleWeights[i];
+            samples[4 * sampleStride + i] = sampleLods[i];
+        }
+
+        float* output = this->prefilterTexels.data() + mipOffset;
+
+        this->runParallel(6 * mipSize, [this, mipSize, roughness, &samples, output](unsigned int task)
+        {
+            unsigned int face = task / mipSize;
+            unsigned int row = task % mipSize;
+
+            if (roughness == 0.0f)
+            {
+                // Every sample is N itself at mip 0, the average is the lookup
+                for (unsigned int x = 0; x < mipSize; ++x)
+                {
+                    glm::vec3 color = this->sampleCube(face, (x + 0.5f) / mipSize, (row + 0.5f) / mipSize, 0.0f);
+                    std::copy(glm::value_ptr(color), glm::value_ptr(color) + 3, output + ((size_t(face) * mipSize + row) * mipSize + x) * 3);
+                }
+            }
+
+            else
+                this->prefilterRow(face, row, mipSize, samples, output + (size_t(face) * mipSize + row) * mipSize * 3);
+        });
+
+        mipOffset += size_t(mipSize) * mipSize * 6 * 3;
+    }
+
+    this->prefilterTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - bakeStart).count();
+}
+
+
+void IBLBaker::prefilterRow(unsigned int face, unsigned int row, unsigned int mipSize, const std::vector<float>& samples, float* output)
+{
+    const size_t sampleStride = samples.size() / 5;
+    const float* sampleX = samples.data();
+    const float* sampleY = sampleX + sampleStride;
+    const float* sampleZ = sampleY + sampleStride;
+    const float* sampleWeight = sampleZ + sampleStride;
+    const float* sampleLod = sampleWeight + sampleStride;
+
+    for (unsigned int x = 0; x < mipSize; ++x)
+    {
+        glm::vec3 N = glm::normalize(computeCubeDirection(face, (x + 0.5f) / mipSize, (row + 0.5f) / mipSize));
+        glm::vec3 tanX, tanY;
+        computeTangentFrame(N, tanX, tanY);
+
+        glm::vec3 prefilteredAccumulation = glm::vec3(0.0f);
+        float totalSampleWeight = 0.0f;
+        size_t i = 0;
+
+#ifdef IBLBAKER_SSE
+        // 4 samples per iteration : rotation into the frame of N and GL face selection, the filtered fetches staying scalar
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        const __m128 zero4 = _mm_setzero_ps();
+        const __m128 half4 = _mm_set1_ps(0.5f);
+        const __m128 one4 = _mm_set1_ps(1.0f);
+
+        for (; i < sampleStride; i += 4)
+        {
+            __m128 lx = _mm_loadu_ps(sampleX + i);
+            __m128 ly = _mm_loadu_ps(sampleY + i);
+            __m128 lz = _mm_loadu_ps(sampleZ + i);
+
+            __m128 dirX = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tanX.x), lx), _mm_mul_ps(_mm_set1_ps(tanY.x), ly)), _mm_mul_ps(_mm_set1_ps(N.x), lz));
+            __m128 dirY = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tanX.y), lx), _mm_mul_ps(_mm_set1_ps(tanY.y), ly)), _mm_mul_ps(_mm_set1_ps(N.y), lz));
+            __m128 dirZ = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tanX.z), lx), _mm_mul_ps(_mm_set1_ps(tanY.z), ly)), _mm_mul_ps(_mm_set1_ps(N.z), lz));
+
+            __m128 absX = _mm_andnot_ps(signMask, dirX);
+            __m128 absY = _mm_andnot_ps(signMask, dirY);
+            __m128 absZ = _mm_andnot_ps(signMask, dirZ);
+
+            __m128 majorX = _mm_and_ps(_mm_cmpge_ps(absX, absY), _mm_cmpge_ps(absX, absZ));
+            __m128 majorY = _mm_andnot_ps(majorX, _mm_cmpge_ps(absY, absZ));
+            __m128 majorZ = _mm_andnot_ps(_mm_or_ps(majorX, majorY), _mm_cmpeq_ps(zero4, zero4));
+
+            __m128 positiveX = _mm_cmpge_ps(dirX, zero4);
+            __m128 positiveY = _mm_cmpge_ps(dirY, zero4);
+            __m128 positiveZ = _mm_cmpge_ps(dirZ, zero4);
+
+            // sc : -z / +z on the X faces, x on the Y faces, x / -x on the Z faces ; tc : -y, z / -z, -y
+            __m128 scX = _mm_xor_ps(dirZ, _mm_and_ps(positiveX, signMask));
+            __m128 scZ = _mm_xor_ps(dirX, _mm_andnot_ps(positiveZ, signMask));
+            __m128 tcY = _mm_xor_ps(dirZ, _mm_andnot_ps(positiveY, signMask));
+            __m128 tcXZ = _mm_xor_ps(dirY, signMask);
+
+            __m128 sc = _mm_or_ps(_mm_or_ps(_mm_and_ps(majorX, scX), _mm_and_ps(majorY, dirX)), _mm_and_ps(majorZ, scZ));
+            __m128 tc = _mm_or_ps(_mm_and_ps(majorY, tcY), _mm_andnot_ps(majorY, tcXZ));
+            __m128 ma = _mm_or_ps(_mm_or_ps(_mm_and_ps(majorX, absX), _mm_and_ps(majorY, absY)), _mm_and_ps(majorZ, absZ));
+            __m128 positive = _mm_or_ps(_mm_or_ps(_mm_and_ps(majorX, positiveX), _mm_and_ps(majorY, positiveY)), _mm_and_ps(majorZ, positiveZ));
+
+            __m128 inverseMa = _mm_div_ps(one4, ma);
+            float s[4], t[4];
+            _mm_storeu_ps(s, _mm_mul_ps(half4, _mm_add_ps(_mm_mul_ps(sc, inverseMa), one4)));
+            _mm_storeu_ps(t, _mm_mul_ps(half4, _mm_add_ps(_mm_mul_ps(tc, inverseMa), one4)));
+
+            int majorXBits = _mm_movemask_ps(majorX);
+            int majorYBits = _mm_movemask_ps(majorY);
+            int positiveBits = _mm_movemask_ps(positive);
+
+            for (unsigned int lane = 0; lane < 4; ++lane)
+            {
+                float weight = sampleWeight[i + lane];
+
+                if (weight <= 0.0f)
+                    continue;
+
+                unsigned int sampleFace = ((majorXBits >> lane) & 1) ? 0 : ((majorYBits >> lane) & 1) ? 2 : 4;
+                sampleFace += ((positiveBits >> lane) & 1) ? 0 : 1;
+
+                prefilteredAccumulation += this->sampleCube(sampleFace, s[lane], t[lane], sampleLod[i + lane]) * weight;
+                totalSampleWeight += weight;
+            }
+        }
+#endif
+
+        for (; i < sampleStride; ++i)
+        {
+            if (sampleWeight[i] <= 0.0f)
+                continue;
+
+            glm::vec3 L = tanX * sampleX[i] + tanY * sampleY[i] + N * sampleZ[i];
+            unsigned int sampleFace;
+            float s, t;
+            computeCubeCoords(L, sampleFace, s, t);
+
+            prefilteredAccumulation += this->sampleCube(sampleFace, s, t, sampleLod[i]) * sampleWeight[i];
+            totalSampleWeight += sampleWeight[i];
+        }
+
+        prefilteredAccumulation = prefilteredAccumulation / totalSampleWeight;
+        std::copy(glm::value_ptr(prefilteredAccumulation), glm::value_ptr(prefilteredAccumulation) + 3, output + x * 3);
+    }
+}
+
+
+// Rows are roughness and columns NdotV, at the texel centers the quad of the GPU pass interpolates to. With N = Z and V in the XZ plane,
+// only the x and z components of the half-vectors are needed, computed once per row
+void IBLBaker::bakeLUT(unsigned int size, unsigned int sampleCount)
+{
+    std::chrono::high_resolution_clock::time_point bakeStart = std::chrono::high_resolution_clock::now();
+
+    this->lutTexels.resize(size_t(size) * size * 2);
+
+    this->runParallel(size, [this, size, sampleCount](unsigned int row)
+    {
+        float roughness = (row + 0.5f) / size;
+        size_t sampleStride = (sampleCount + 3) & ~3u;
+        std::vector<float> samples(sampleStride * 3, 0.0f);
+
+        for (unsigned int i = 0; i < sampleCount; ++i)
+        {
+            glm::vec3 H = computeImportanceSampleGGX(computeHammersley(i, sampleCount), roughness, glm::vec3(0.0f, 0.0f, 1.0f));
+
+            samples[i] = H.x;
+            samples[sampleStride + i] = H.z;
+            samples[2 * sampleStride + i] = 1.0f;
+        }
+
+        this->integrateRow(row, size, sampleCount, samples, this->lutTexels.data() + size_t(row) * size * 2);
+    });
+
+    this->lutTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - bakeStart).count();
+}
+
+
+void IBLBaker::integrateRow(unsigned int row, unsigned int size, unsigned int sampleCount, const std::vector<float>& samples, float* output)
+{
+    const size_t sampleStride = samples.size() / 3;
+    const float* sampleHX = samples.data();
+    const float* sampleHZ = sampleHX + sampleStride;
+    const float* sampleValid = sampleHZ + sampleStride;
+    const float roughness = (row + 0.5f) / size;
+    const float kRough2 = roughness * roughness + 0.0001f;
+
+    for (unsigned int x = 0; x < size; ++x)
+    {
+        float NdotV = (x + 0.5f) / size;
+        float VX = std::sqrt(1.0f - NdotV * NdotV);
+        float VZ = NdotV;
+        float ggxV = (2.0f * NdotV) / (NdotV + std::sqrt(NdotV * NdotV + kRough2 * (1.0f - NdotV * NdotV)));
+
+        float scaleSum = 0.0f;
+        float biasSum = 0.0f;
+        size_t i = 0;
+
+#ifdef IBLBAKER_SSE
+        // 4 samples per iteration, the NdotL > 0 test becoming a lane mask
+        const __m128 zero4 = _mm_setzero_ps();
+        const __m128 one4 = _mm_set1_ps(1.0f);
+        const __m128 two4 = _mm_set1_ps(2.0f);
+        const __m128 VX4 = _mm_set1_ps(VX);
+        const __m128 VZ4 = _mm_set1_ps(VZ);
+        const __m128 NdotV4 = _mm_set1_ps(NdotV);
+        const __m128 ggxV4 = _mm_set1_ps(ggxV);
+        const __m128 kRough24 = _mm_set1_ps(kRough2);
+
+        __m128 scale4 = zero4;
+        __m128 bias4 = zero4;
+
+        for (; i + 4 <= sampleStride; i += 4)
+        {
+            __m128 HX = _mm_loadu_ps(sampleHX + i);
+            __m128 HZ = _mm_loadu_ps(sampleHZ + i);
+            __m128 valid = _mm_cmpgt_ps(_mm_loadu_ps(sampleValid + i), zero4);
+
+            __m128 VdotHRaw = _mm_add_ps(_mm_mul_ps(VX4, HX), _mm_mul_ps(VZ4, HZ));
+            __m128 LZ = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(two4, VdotHRaw), HZ), VZ4);
+
+            __m128 NdotL = _mm_min_ps(_mm_max_ps(LZ, zero4), one4);
+            __m128 NdotH = _mm_min_ps(_mm_max_ps(HZ, zero4), one4);
+            __m128 VdotH = _mm_min_ps(_mm_max_ps(VdotHRaw, zero4), one4);
+            __m128 mask = _mm_and_ps(valid, _mm_cmpgt_ps(NdotL, zero4));
+
+            __m128 NdotL2 = _mm_mul_ps(NdotL, NdotL);
+            __m128 ggxL = _mm_div_ps(_mm_mul_ps(two4, NdotL), _mm_add_ps(NdotL, _mm_sqrt_ps(_mm_add_ps(NdotL2, _mm_mul_ps(kRough24, _mm_sub_ps(one4, NdotL2))))));
+            __m128 G_Vis = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(ggxL, ggxV4), VdotH), _mm_mul_ps(NdotH, NdotV4));
+
+            __m128 fresnelBase = _mm_sub_ps(one4, VdotH);
+            __m128 fresnelBase2 = _mm_mul_ps(fresnelBase, fresnelBase);
+            __m128 Fc = _mm_mul_ps(_mm_mul_ps(fresnelBase2, fresnelBase2), fresnelBase);
+
+            G_Vis = _mm_and_ps(mask, G_Vis);
+            scale4 = _mm_add_ps(scale4, _mm_mul_ps(_mm_sub_ps(one4, Fc), G_Vis));
+            bias4 = _mm_add_ps(bias4, _mm_mul_ps(Fc, G_Vis));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, scale4);
+        scaleSum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        _mm_storeu_ps(lanes, bias4);
+        biasSum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#endif
+
+        for (; i < sampleStride; ++i)
+        {
+            if (sampleValid[i] <= 0.0f)
+                continue;
+
+            float VdotHRaw = VX * sampleHX[i] + VZ * sampleHZ[i];
+            float NdotL = glm::clamp(2.0f * VdotHRaw * sampleHZ[i] - VZ, 0.0f, 1.0f);
+            float NdotH = glm::clamp(sampleHZ[i], 0.0f, 1.0f);
+            float VdotH = glm::clamp(VdotHRaw, 0.0f, 1.0f);
+
+            if (NdotL > 0.0f)
+            {
+                float G_Vis = computeGeometryAttenuationGGXSmith(NdotL, NdotV, roughness) * VdotH / (NdotH * NdotV);
+                float Fc = std::pow(1.0f - VdotH, 5.0f);
+
+                scaleSum += (1.0f - Fc) * G_Vis;
+                biasSum += Fc * G_Vis;
+            }
+        }
+
+        output[x * 2] = scaleSum / float(sampleCount);
+        output[x * 2 + 1] = biasSum / float(sampleCount);
+    }
+}
+
+
+const std::vector<float>& IBLBaker::getCube()
+{
+    return this->cubeMips[0];
+}
+
+
+const std::vector<float>& IBLBaker::getPrefilter()
+{
+    return this->prefilterTexels;
+}
+
+
+const std::vector<float>& IBLBaker::getLUT()
+{
+    return this->lutTexels;
+}
+
+
+unsigned int IBLBaker::getThreadCount()
+{
+    return this->threadCount ? this->threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+
+float IBLBaker::getCubeTime()
+{
+    return this->cubeTime;
+}
+
+
+float IBLBaker::getPrefilterTime()
+{
+    return this->prefilterTime;
+}
+
+
+float IBLBaker::getLUTTime()
+{
+    return this->lutTime;
+}
+
+
+glm::vec3 IBLBaker::computeReferencePrefilter(glm::vec3 N, float roughness, unsigned int prefilterSize, unsigned int sampleCount)
+{
+    glm::vec3 R = N;
+    glm::vec3 V = R;
+
+    glm::vec3 prefilteredAccumulation = glm::vec3(0.0f);
+    float totalSampleWeight = 0.0f;
+
+    for (unsigned int i = 0; i < sampleCount; ++i)
+    {
+        glm::vec2 Xi = computeHammersley(i, sampleCount);
+        glm::vec3 H = computeImportanceSampleGGX(Xi, roughness, N);
+        glm::vec3 L = glm::normalize(2.0f * glm::dot(V, H) * H - V);
+
+        float NdotL = std::max(glm::dot(N, L), 0.0f);
+
+        if (NdotL > 0.0f)
+        {
+            float NdotH = std::max(glm::dot(N, H), 0.0f);
+            float HdotV = std::max(glm::dot(H, V), 0.0f);
+
+            unsigned int sampleFace;
+            float s, t;
+            computeCubeCoords(L, sampleFace, s, t);
+
+            prefilteredAccumulation += this->sampleCube(sampleFace, s, t, computeSampleLod(roughness, glm::clamp(NdotH, 0.0f, 1.0f), HdotV, prefilterSize, sampleCount)) * NdotL;
+            totalSampleWeight += NdotL;
+        }
+    }
+
+    return prefilteredAccumulation / totalSampleWeight;
+}
+
+
+glm::vec2 IBLBaker::computeReferenceBRDF(float NdotV, float roughness, unsigned int sampleCount)
+{
+    glm::vec3 V = glm::vec3(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV);
+    glm::vec3 N = glm::vec3(0.0f, 0.0f, 1.0f);
+    glm::vec2 brdfLUT = glm::vec2(0.0f);
+
+    for (unsigned int i = 0; i < sampleCount; ++i)
+    {
+        glm::vec2 Xi = computeHammersley(i, sampleCount);
+        glm::vec3 H = computeImportanceSampleGGX(Xi, roughness, N);
+        glm::vec3 L = glm::normalize(2.0f * glm::dot(V, H) * H - V);
+
+        float NdotL = glm::clamp(L.z, 0.0f, 1.0f);
+        float NdotH = glm::clamp(H.z, 0.0f, 1.0f);
+        float VdotH = glm::clamp(glm::dot(V, H), 0.0f, 1.0f);
+
+        if (NdotL > 0.0f)
+        {
+            float G = computeGeometryAttenuationGGXSmith(NdotL, NdotV, roughness);
+            float G_Vis = (G * VdotH) / (NdotH * NdotV);
+            float Fc = std::pow(1.0f - VdotH, 5.0f);
+
+            brdfLUT.x += (1.0f - Fc) * G_Vis;
+            brdfLUT.y += Fc * G_Vis;
+        }
+    }
+
+    return brdfLUT / float(sampleCount);
+}
+
+
+// Inverse of the GL cube-map lookup, s and t in [0, 1]
+glm::vec3 IBLBaker::computeCubeDirection(unsigned int face, float s, float t)
+{
+    float sc = 2.0f * s - 1.0f;
+    float tc = 2.0f * t - 1.0f;
+
+    switch (face)
+    {
+        case 0: return glm::vec3(1.0f, -tc, -sc);
+        case 1: return glm::vec3(-1.0f, -tc, sc);
+        case 2: return glm::vec3(sc, 1.0f, tc);
+        case 3: return glm::vec3(sc, -1.0f, -tc);
+        case 4: return glm::vec3(sc, -tc, 1.0f);
+        default: return glm::vec3(-sc, -tc, -1.0f);
+    }
+}
+
+
+// Work items handed out through an atomic counter, like the SH projection
+void IBLBaker::runParallel(unsigned int taskCount, const std::function<void(unsigned int)>& task)
+{
+    unsigned int workerCount = std::max(1u, std::min(this->getThreadCount(), taskCount));
+    std::atomic<unsigned int> nextTask(0);
+
+    auto bakeWorker = [&nextTask, &task, taskCount]()
+    {
+        for (unsigned int i = nextTask++; i < taskCount; i = nextTask++)
+            task(i);
+    };
+
+    std::vector<std::thread> bakeThreads;
+
+    for (unsigned int i = 1; i < workerCount; ++i)
+        bakeThreads.push_back(std::thread(bakeWorker));
+
+    bakeWorker();
+
+    for (std::thread& bakeThread : bakeThreads)
+        bakeThread.join();
+}
+
+
+// Same lookup as latlongToCube.frag, bilinear with GL_REPEAT on both axes
+glm::vec3 IBLBaker::sampleLatlong(glm::vec3 direction)
+{
+    float u = (std::atan2(direction.x, -direction.z) + bakePI) / (2.0f * bakePI);
+    float v = std::acos(glm::clamp(-direction.y, -1.0f, 1.0f)) / bakePI;
+
+    float texelX = u * this->envWidth - 0.5f;
+    float texelY = v * this->envHeight - 0.5f;
+    float floorX = std::floor(texelX);
+    float floorY = std::floor(texelY);
+    float fractX = texelX - floorX;
+    float fractY = texelY - floorY;
+
+    int x0 = (int(floorX) % int(this->envWidth) + int(this->envWidth)) % int(this->envWidth);
+    int y0 = (int(floorY) % int(this->envHeight) + int(this->envHeight)) % int(this->envHeight);
+    int x1 = (x0 + 1) % int(this->envWidth);
+    int y1 = (y0 + 1) % int(this->envHeight);
+
+    auto fetch = [this](int x, int y)
+    {
+        const float* texel = this->envData + (size_t(y) * this->envWidth + x) * this->envComponents;
+        return glm::vec3(texel[0], texel[1], texel[2]);
+    };
+
+    return glm::mix(glm::mix(fetch(x0, y0), fetch(x1, y0), fractX), glm::mix(fetch(x0, y1), fetch(x1, y1), fractX), fractY);
+}
+
+
+// Bilinear with GL_CLAMP_TO_EDGE inside a face (the GPU filters across seams, the difference staying within the verification tolerance)
+glm::vec3 IBLBaker::sampleFace(unsigned int mip, unsigned int face, float s, float t)
+{
+    int size = int(this->cubeSize >> mip);
+    const float* faceData = this->cubeMips[mip].data() + size_t(face) * size * size * 3;
+
+    float texelX = s * size - 0.5f;
+    float texelY = t * size - 0.5f;
+    float floorX = std::floor(texelX);
+    float floorY = std::floor(texelY);
+    float fractX = texelX - floorX;
+    float fractY = texelY - floorY;
+
+    int x0 = glm::clamp(int(floorX), 0, size - 1);
+    int y0 = glm::clamp(int(floorY), 0, size - 1);
+    int x1 = glm::clamp(int(floorX) + 1, 0, size - 1);
+    int y1 = glm::clamp(int(floorY) + 1, 0, size - 1);
+
+    auto fetch = [faceData, size](int x, int y)
+    {
+        const float* texel = faceData + (size_t(y) * size + x) * 3;
+        return glm::vec3(texel[0], texel[1], texel[2]);
+    };
+
+    return glm::mix(glm::mix(fetch(x0, y0), fetch(x1, y0), fractX), glm::mix(fetch(x0, y1), fetch(x1, y1), fractX), fractY);
+}
+
+
+// GL_LINEAR_MIPMAP_LINEAR at an explicit level of detail, like textureLod()
+glm::vec3 IBLBaker::sampleCube(unsigned int face, float s, float t, float lod)
+{
+    lod = glm::clamp(lod, 0.0f, float(this->cubeMips.size() - 1));
+
+    unsigned int lowerMip = unsigned(lod);
+    float mipBlend = lod - float(lowerMip);
+
+    glm::vec3 color = this->sampleFace(lowerMip, face, s, t);
+
+    if (mipBlend > 0.0f)
+        color = glm::mix(color, this->sampleFace(lowerMip + 1, face, s, t), mipBlend);
+
+    return color;
+}
@@ -0,0 +1,70 @@
+#ifndef IBLBAKER_H
+#define IBLBAKER_H
+
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <vector>
+#include <functional>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+
+// CPU port of the IBL bake passes of iblSetup() : latlong to cube conversion (latlongToCube.frag), GGX prefiltered mips
+// (prefilterIBL.frag) and split-sum BRDF LUT (integrateIBL.frag), the irradiance being left to IrradianceSH.
+// Deliberately free of any GL call so that environment assets can be baked on machines without a GPU.
+// Cube texels are stored like the GL faces : +X, -X, +Y, -Y, +Z, -Z, rows from t = 0, RGB floats
+class IBLBaker
+{
+    public:
+        IBLBaker();
+        ~IBLBaker();
+        void setThreadCount(unsigned int threadCount);
+        void setEnvironment(const float* texData, unsigned int width, unsigned int height, unsigned int components);
+        void bakeCube(unsigned int size);
+        void bakePrefilter(unsigned int size, unsigned int mips, unsigned int sampleCount);
+        void bakeLUT(unsigned int size, unsigned int sampleCount);
+        const std::vector<float>& getCube();
+        const std::vector<float>& getPrefilter();
+        const std::vector<float>& getLUT();
+        unsigned int getThreadCount();
+        float getCubeTime();
+        float getPrefilterTime();
+        float getLUTTime();
+
+        // Straight scalar ports of the shaders, one texel at a time, used to check the threaded SIMD paths
+        glm::vec3 computeReferencePrefilter(glm::vec3 N, float roughness, unsigned int prefilterSize, unsigned int sampleCount);
+        glm::vec2 computeReferenceBRDF(float NdotV, float roughness, unsigned int sampleCount);
+        static glm::vec3 computeCubeDirection(unsigned int face, float s, float t);
+
+    private:
+        const float* envData = nullptr;
+        unsigned int envWidth = 0;
+        unsigned int envHeight = 0;
+        unsigned int envComponents = 0;
+        unsigned int threadCount = 0;
+
+        // Environment cube with its full mip chain (box filtered like glGenerateMipmap), rounded to half floats like the RGB16F target
+        unsigned int cubeSize = 0;
+        std::vector<std::vector<float>> cubeMips;
+
+        // Prefiltered mips one after the other, then the RG LUT with rows from roughness 0
+        std::vector<float> prefilterTexels;
+        std::vector<float> lutTexels;
+
+        float cubeTime = 0.0f;
+        float prefilterTime = 0.0f;
+        float lutTime = 0.0f;
+
+        void runParallel(unsigned int taskCount, const std::function<void(unsigned int)>& task);
+        glm::vec3 sampleLatlong(glm::vec3 direction);
+        glm::vec3 sampleFace(unsigned int mip, unsigned int face, float s, float t);
+        glm::vec3 sampleCube(unsigned int face, float s, float t, float lod);
+        void prefilterRow(unsigned int face, unsigned int row, unsigned int mipSize, const std::vector<float>& samples, float* output);
+        void integrateRow(unsigned int row, unsigned int size, unsigned int sampleCount, const std::vector<float>& samples, float* output);
+};
+
+#endif